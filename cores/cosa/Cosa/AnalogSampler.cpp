@@ -0,0 +1,150 @@
+/**
+ * @file Cosa/AnalogSampler.cpp
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/AnalogSampler.hh"
+
+#if !defined(BOARD_ATTINY)
+
+// ADC auto trigger source; Timer/Counter1 Compare Match B
+#define ADTS_MASK (_BV(ADTS2) | _BV(ADTS1) | _BV(ADTS0))
+#define ADTS_TIMER1_COMPB (_BV(ADTS2) | _BV(ADTS0))
+
+bool
+AnalogSampler::begin(uint32_t rate)
+{
+  // Check that the ADC is free and the buffer may hold two frames
+  if (rate == 0 || m_count == 0) return (false);
+  if ((uint16_t) m_mask + 1 < 2 * m_count) return (false);
+  synchronized {
+    if (sampling_pin != NULL) synchronized_return (false);
+    sampling_pin = this;
+  }
+
+  // Reset ring buffer, accumulators and filter state
+  m_head = 0;
+  m_tail = 0;
+  m_next = 0;
+  m_samples = 0;
+  m_primed = false;
+  m_overruns = 0;
+  memset(m_sum, 0, sizeof(m_sum));
+
+  // Calculate timer prescale and top for the given rate
+  static const uint8_t PRESCALE_MAX = 5;
+  static const uint8_t shift[PRESCALE_MAX] = { 0, 3, 6, 8, 10 };
+  uint32_t cycles = F_CPU / rate;
+  uint8_t cs = 0;
+  while ((cycles >> shift[cs]) > 0x10000UL && cs < PRESCALE_MAX - 1) cs++;
+  uint16_t top = (cycles >> shift[cs]) - 1;
+
+  synchronized {
+    // Select the first channel and enable auto trigger
+    loop_until_bit_is_clear(ADCSRA, ADSC);
+    set_channel(get_pin_at(0));
+    bit_field_set(ADCSRB, ADTS_MASK, ADTS_TIMER1_COMPB);
+    bit_mask_set(ADCSRA, _BV(ADEN) | _BV(ADATE) | _BV(ADIE));
+
+    // Timer1 in CTC mode with OCR1A as top; compare B at top
+    TCCR1A = 0;
+    TCCR1B = 0;
+    TCNT1 = 0;
+    OCR1A = top;
+    OCR1B = top;
+    TIFR1 = _BV(OCF1B);
+    TCCR1B = _BV(WGM12) | (cs + 1);
+  }
+  return (true);
+}
+
+void
+AnalogSampler::end()
+{
+  synchronized {
+    TCCR1B = 0;
+    bit_mask_clear(ADCSRA, _BV(ADATE) | _BV(ADIE));
+    if (sampling_pin == this) sampling_pin = NULL;
+  }
+}
+
+bool
+AnalogSampler::read(uint16_t* frame)
+{
+  if (available() == 0) return (false);
+  uint8_t tail = m_tail;
+  for (uint8_t i = 0; i < m_count; i++) {
+    *frame++ = m_buffer[tail];
+    tail = (tail + 1) & m_mask;
+  }
+  m_tail = tail;
+  return (true);
+}
+
+void
+AnalogSampler::set_channel(Board::AnalogPin pin)
+{
+  ADMUX = (m_reference | (pin & 0x1f));
+#if defined(MUX5)
+  bit_write(pin & 0x20, ADCSRB, MUX5);
+#endif
+}
+
+void
+AnalogSampler::on_interrupt(uint16_t value)
+{
+  // Select channel for the next triggered conversion and re-enable
+  // the interrupt. Clear the compare flag to allow the next trigger
+  uint8_t ix = m_next;
+  if (++m_next == m_count) m_next = 0;
+  set_channel(get_pin_at(m_next));
+  TIFR1 = _BV(OCF1B);
+  bit_set(ADCSRA, ADIE);
+
+  // Accumulate sample; check end of round and oversampling
+  m_sum[ix] += value;
+  if (m_next != 0) return;
+  if (++m_samples != (1 << (m_bits << 1))) return;
+  m_samples = 0;
+
+  // Check that there is room for the frame
+  uint8_t head = m_head;
+  uint8_t room = m_mask - ((head - m_tail) & m_mask);
+  if (room < m_count) {
+    m_overruns += 1;
+    memset(m_sum, 0, sizeof(m_sum));
+    return;
+  }
+
+  // Decimate, filter and store the frame
+  for (uint8_t i = 0; i < m_count; i++) {
+    uint16_t res = m_sum[i] >> m_bits;
+    m_sum[i] = 0;
+    if (m_shift != 0) {
+      if (!m_primed) m_state[i] = res << m_shift;
+      m_state[i] += res - (m_state[i] >> m_shift);
+      res = m_state[i] >> m_shift;
+    }
+    m_buffer[head] = res;
+    head = (head + 1) & m_mask;
+  }
+  m_primed = true;
+  m_head = head;
+}
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * @file Cosa/AnalogSampler.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_ANALOG_SAMPLER_HH
+#define COSA_ANALOG_SAMPLER_HH
+
+#include "Cosa/AnalogPin.hh"
+
+/**
+ * Free-running analog pin set sampler. The conversions are started
+ * by Timer1 (compare match B auto trigger) at a given rate and the
+ * pins in the set are sampled in round-robin order. Each channel may
+ * be oversampled and decimated (4^n samples for n additional bits of
+ * resolution) and filtered with a first order IIR filter. The
+ * resulting frames (one value per pin) are stored in a lock-free
+ * ring buffer by the conversion completion interrupt handler.
+ * @code
+ * const Board::AnalogPin pins[] __PROGMEM = {
+ *   Board::A0, Board::A1, Board::A2
+ * };
+ * uint16_t buffer[32];
+ * AnalogSampler sampler(pins, membersof(pins), buffer, membersof(buffer));
+ * ...
+ * sampler.set_oversampling(2);
+ * sampler.begin(10000);
+ * ...
+ * uint16_t frame[3];
+ * if (sampler.read(frame)) ...
+ * @endcode
+ *
+ * @section Limitations
+ * Uses Timer1 and may not be used together with other modules that
+ * use Timer1 (e.g. Servo, Tone and VWI). Not available on ATtiny.
+ * Single sample requests with AnalogPin will fail while the sampler
+ * is active. The ADC conversion time (13 ADC clock cycles, see
+ * AnalogPin::prescale()) and the interrupt handler time limit the
+ * sample rate.
+ */
+class AnalogSampler : private AnalogPin {
+public:
+  /** Max number of pins in set. */
+  static const uint8_t CHANNEL_MAX = 8;
+
+  /** Max number of additional bits with oversampling. */
+  static const uint8_t OVERSAMPLING_MAX = 3;
+
+  /**
+   * Construct analog pin set sampler given vector and number of
+   * pins, ring buffer and size, and reference voltage. The vector of
+   * pins should be defined in program memory using PROGMEM. The ring
+   * buffer size must be a power of two (max 128) and hold at least
+   * two frames.
+   * @param[in] pins vector with analog pins.
+   * @param[in] count number of pins in vector (max CHANNEL_MAX).
+   * @param[in] buffer ring buffer for sample frames.
+   * @param[in] size of ring buffer (power of two).
+   * @param[in] ref reference voltage.
+   */
+  AnalogSampler(const Board::AnalogPin* pins, uint8_t count,
+		uint16_t* buffer, uint8_t size,
+		Board::Reference ref = Board::AVCC_REFERENCE) :
+    AnalogPin((Board::AnalogPin) 255, ref),
+    m_pin_at(pins),
+    m_count(count < CHANNEL_MAX ? count : CHANNEL_MAX),
+    m_buffer(buffer),
+    m_mask(size - 1),
+    m_head(0),
+    m_tail(0),
+    m_next(0),
+    m_samples(0),
+    m_bits(0),
+    m_shift(0),
+    m_primed(false),
+    m_overruns(0)
+  {
+  }
+
+  /**
+   * Set number of additional bits of resolution with oversampling
+   * and decimation; 4^bits samples per value (0..OVERSAMPLING_MAX).
+   * The filter coefficient is limited to the new resolution. Should
+   * be set before begin().
+   * @param[in] bits additional resolution.
+   */
+  void set_oversampling(uint8_t bits)
+  {
+    if (bits > OVERSAMPLING_MAX) bits = OVERSAMPLING_MAX;
+    m_bits = bits;
+    set_filter(m_shift);
+  }
+
+  /**
+   * Set IIR filter coefficient; y += (x - y) / 2^shift. Zero(0) to
+   * disable the filter. The shift is limited so that the filter
+   * state fits in 16-bit. Should be set before begin().
+   * @param[in] shift filter coefficient.
+   */
+  void set_filter(uint8_t shift)
+  {
+    uint8_t max = 16 - 10 - m_bits;
+    m_shift = (shift < max ? shift : max);
+  }
+
+  /**
+   * Start sampling with given rate (conversions per second). The
+   * frame rate is the given rate divided by the number of pins and
+   * the oversampling factor. Returns true(1) if successful otherwise
+   * false(0).
+   * @param[in] rate conversions per second.
+   * @return bool.
+   */
+  bool begin(uint32_t rate);
+
+  /**
+   * Stop sampling.
+   */
+  void end();
+
+  /**
+   * Return number of frames available in the ring buffer.
+   * @return number of frames.
+   */
+  uint8_t available() const
+  {
+    return (((m_head - m_tail) & m_mask) / m_count);
+  }
+
+  /**
+   * Read next frame from the ring buffer; one value per pin. Returns
+   * true(1) if a frame was read otherwise false(0).
+   * @param[in] frame buffer for values (count pins).
+   * @return bool.
+   */
+  bool read(uint16_t* frame);
+
+  /**
+   * Return number of frames dropped due to full ring buffer.
+   * @return number of overruns.
+   */
+  uint16_t get_overruns() const
+  {
+    return (m_overruns);
+  }
+
+  /**
+   * Get number of analog pins in set.
+   * @return set size.
+   */
+  uint8_t get_count() const
+  {
+    return (m_count);
+  }
+
+private:
+  const Board::AnalogPin* m_pin_at; //!< Analog channel vector.
+  const uint8_t m_count;	    //!< Number of channels.
+  uint16_t* m_buffer;		    //!< Frame ring buffer.
+  const uint8_t m_mask;		    //!< Ring buffer index mask.
+  volatile uint8_t m_head;	    //!< Ring buffer head (interrupt).
+  volatile uint8_t m_tail;	    //!< Ring buffer tail (reader).
+  uint8_t m_next;		    //!< Next channel index.
+  uint8_t m_samples;		    //!< Accumulated samples per channel.
+  uint8_t m_bits;		    //!< Oversampling additional bits.
+  uint8_t m_shift;		    //!< IIR filter coefficient.
+  bool m_primed;		    //!< IIR filter state initiated.
+  volatile uint16_t m_overruns;	    //!< Dropped frames.
+  uint16_t m_sum[CHANNEL_MAX];	    //!< Oversampling accumulators.
+  uint16_t m_state[CHANNEL_MAX];    //!< IIR filter state.
+
+  /**
+   * Get analog pin in set.
+   * @param[in] ix index.
+   * @return pin number.
+   */
+  Board::AnalogPin get_pin_at(uint8_t ix) const
+  {
+    return ((Board::AnalogPin) pgm_read_byte(&m_pin_at[ix]));
+  }
+
+  /**
+   * Select channel for the next conversion.
+   * @param[in] pin analog pin.
+   */
+  void set_channel(Board::AnalogPin pin);
+
+  /**
+   * @override Interrupt::Handler
+   * Interrupt service on conversion completion. Accumulate sample,
+   * select the next channel, and decimate, filter and store the
+   * frame when completed.
+   * @param[in] arg sample value.
+   */
+  virtual void on_interrupt(uint16_t arg);
+};
+
+#endif
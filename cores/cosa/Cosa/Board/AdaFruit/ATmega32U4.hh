@@ -362,6 +362,7 @@ public:
 extern "C" {
   void ADC_vect(void) __attribute__ ((signal));
   void ANALOG_COMP_vect(void) __attribute__ ((signal));
+  void EE_READY_vect(void) __attribute__ ((signal));
   void INT0_vect(void) __attribute__ ((signal));
   void INT1_vect(void) __attribute__ ((signal));
   void INT2_vect(void) __attribute__ ((signal));
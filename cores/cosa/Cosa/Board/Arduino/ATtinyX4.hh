@@ -233,6 +233,7 @@ public:
  * Redefinition of symbols to allow generic code.
  */
 #define ANALOG_COMP_vect ANA_COMP_vect
+#define EE_READY_vect EE_RDY_vect
 #define TIMER0_OVF_vect TIM0_OVF_vect
 #define TIMER0_COMPA_vect TIM0_COMPA_vect
 #define TIMER0_COMPB_vect TIM0_COMPB_vect
@@ -246,6 +247,7 @@ public:
 extern "C" {
   void ADC_vect(void) __attribute__ ((signal));
   void ANALOG_COMP_vect(void) __attribute__ ((signal));
+  void EE_RDY_vect(void) __attribute__ ((signal));
   void INT0_vect(void) __attribute__ ((signal));
   void PCINT0_vect(void) __attribute__ ((signal));
   void PCINT1_vect(void) __attribute__ ((signal));
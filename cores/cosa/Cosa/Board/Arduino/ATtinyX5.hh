@@ -223,6 +223,7 @@ public:
  * Redefinition of symbols to allow generic code.
  */
 #define ANALOG_COMP_vect ANA_COMP_vect
+#define EE_READY_vect EE_RDY_vect
 #define PCMSK0 PCMSK
 #define TIMSK0 TIMSK
 #define TIMSK1 TIMSK
@@ -235,6 +236,7 @@ public:
 extern "C" {
   void ADC_vect(void) __attribute__ ((signal));
   void ANALOG_COMP_vect(void) __attribute__ ((signal));
+  void EE_RDY_vect(void) __attribute__ ((signal));
   void INT0_vect(void) __attribute__ ((signal));
   void PCINT0_vect(void) __attribute__ ((signal));
   void TIMER0_COMPA_vect(void) __attribute__ ((signal));
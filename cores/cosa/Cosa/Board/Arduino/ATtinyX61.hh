@@ -250,6 +250,7 @@ public:
  * Redefinition of symbols to allow generic code.
  */
 #define ANALOG_COMP_vect ANA_COMP_vect
+#define EE_READY_vect EE_RDY_vect
 #define PCINT0_vect PCINT_vect
 #define ACSR ACSRB
 #define WGM01 WGM00
@@ -265,6 +266,7 @@ public:
 extern "C" {
   void ADC_vect(void) __attribute__ ((signal));
   void ANALOG_COMP_vect(void) __attribute__ ((signal));
+  void EE_RDY_vect(void) __attribute__ ((signal));
   void INT0_vect(void) __attribute__ ((signal));
   void INT1_vect(void) __attribute__ ((signal));
   void PCINT0_vect(void) __attribute__ ((signal));
@@ -22,6 +22,9 @@
 
 Flash::Device* CFFS::device = NULL;
 uint32_t CFFS::current_dir_addr = 0L;
+BitSet<CFFS::SECTOR_MAP_MAX> CFFS::free_sectors;
+BitSet<CFFS::SECTOR_MAP_MAX> CFFS::deleted_sectors;
+uint16_t CFFS::next_sector = 0;
 
 int
 CFFS::File::open(const char* filename, uint8_t oflag)
@@ -37,6 +40,9 @@ CFFS::File::open(const char* filename, uint8_t oflag)
     m_current_addr = m_entry.ref + sizeof(CFFS::descr_t);
     m_current_pos = 0L;
     m_file_size = 0L;
+    m_extents = 0;
+    m_hint = 0;
+    extent(m_entry.ref);
   }
 
   // Check that the file exists; open file
@@ -44,7 +50,8 @@ CFFS::File::open(const char* filename, uint8_t oflag)
     if ((oflag & O_WRITE) == 0) oflag |= O_READ;
     int res = lookup(filename, m_entry, m_entry_addr);
     if (res < 0) return (res);
-    res = find_end_of_file(m_entry.ref, m_current_addr, m_file_size);
+    m_extents = 0;
+    res = find_end_of_file(this, m_entry.ref, m_current_addr, m_file_size);
     if (res < 0) return (res);
     m_current_pos = m_file_size;
   }
@@ -86,35 +93,58 @@ CFFS::File::seek(uint32_t pos, uint8_t whence)
   // Fix: Should implement all seek variants
   if (whence != SEEK_SET) return (EINVAL);
 
-  // Find sector and position in sector
-  descr_t entry;
-  uint32_t addr = m_entry.ref;
+  // Find sector (extent list) and position in sector
+  const uint32_t SECTOR_DATA_BYTES = sector_data_bytes();
+  uint32_t addr = sector(pos / SECTOR_DATA_BYTES);
+  if (addr == NULL_REF) return (ENXIO);
+
+  // Found the position
+  m_current_addr = addr + sizeof(descr_t) + (pos % SECTOR_DATA_BYTES);
   m_current_pos = pos;
-  while (pos != 0) {
-    // Read sector header and check that it is a file block
-    if (device->read(&entry, addr, sizeof(entry)) != sizeof(entry))
-      return (EIO);
-    if (entry.type != FILE_BLOCK_TYPE)
-      return (ENXIO);
-    // Check if additional sector skip is needed
-    uint32_t size = entry.size - sizeof(descr_t);
-    if (pos >= size) {
-      addr = entry.ref;
-      if (addr == NULL_REF)
-	return (ENXIO);
-      pos -= size;
-      // First byte in next sector
-      if (pos == 0)
-	m_current_addr = addr + sizeof(descr_t);
-    }
-    else {
-      // Byte in current sector
-      m_current_addr = addr + sizeof(descr_t) + pos;
-      pos = 0;
-    }
+  return (0);
+}
+
+uint32_t
+CFFS::File::sector(uint16_t ix)
+{
+  // Check the extent list
+  if (ix < m_extents) return (m_extent[ix] * device->SECTOR_BYTES);
+  if (m_extents == 0) return (NULL_REF);
+
+  // Follow the sector chain from the last cached sector
+  uint16_t i = m_extents - 1;
+  uint32_t addr = m_extent[i] * device->SECTOR_BYTES;
+  descr_t header;
+  while (i < ix) {
+    if (device->read(&header, addr, sizeof(header)) != sizeof(header))
+      return (NULL_REF);
+    if (header.type != FILE_BLOCK_TYPE) return (NULL_REF);
+    if (header.ref == NULL_REF) return (NULL_REF);
+    addr = header.ref;
+    if (++i == m_extents) extent(addr);
   }
+  return (addr);
+}
 
-  // Found the position
+int
+CFFS::File::mark()
+{
+  // Check that the last sector carries a hint and if it should be updated
+  if (m_hint == HINT_NONE) return (0);
+  uint8_t marks = (m_current_addr & device->SECTOR_MASK) / hint_bytes();
+  if (marks <= m_hint) return (0);
+
+  // Clear the fill mark bits; program only the bytes that change
+  uint8_t bits[HINT_MAX / CHARBITS];
+  memset(bits, 0xff, sizeof(bits));
+  for (uint8_t i = 0; i < marks; i++)
+    bits[i / CHARBITS] &= ~_BV(i & (CHARBITS - 1));
+  uint8_t first = m_hint / CHARBITS;
+  int count = ((marks - 1) / CHARBITS) - first + 1;
+  uint32_t addr = (m_current_addr & ~device->SECTOR_MASK)
+    + offsetof(descr_t, name) + 1 + first;
+  if (device->write(addr, &bits[first], count) != count) return (EIO);
+  m_hint = marks;
   return (0);
 }
 
@@ -157,16 +187,11 @@ CFFS::File::read(void* buf, size_t size)
     m_current_pos += res;
     m_current_addr += res;
 
-    // Read next sector header if needed
+    // Step to the next sector if needed
     if ((m_current_addr & device->SECTOR_MASK) == 0) {
-      descr_t header;
-      uint32_t addr = m_current_addr - device->SECTOR_BYTES;
-      if (device->read(&header, addr, sizeof(header)) != sizeof(header))
-	return (EIO);
-      if (header.type != FILE_BLOCK_TYPE) return (ENXIO);
-      if (header.size != device->SECTOR_BYTES) return (ENXIO);
-      if (header.ref == NULL_REF) return (ENXIO);
-      m_current_addr = header.ref + sizeof(header);
+      uint32_t addr = sector(m_current_pos / sector_data_bytes());
+      if (addr == NULL_REF) return (ENXIO);
+      m_current_addr = addr + sizeof(descr_t);
     }
   }
 
@@ -197,8 +222,14 @@ CFFS::File::write(const void* buf, size_t size, bool progmem)
     m_file_size += res;
     size -= res;
 
+    // Update the end of file hint if the sector is not exhausted
+    if ((m_current_addr & device->SECTOR_MASK) != 0) {
+      res = mark();
+      if (res < 0) return (res);
+    }
+
     // Check if sector is exhaused
-    if ((m_current_addr & device->SECTOR_MASK) == 0) {
+    else {
       // Allocate a new sector
       uint32_t sector = next_free_sector();
       if (sector == 0L) return (ENOSPC);
@@ -217,8 +248,10 @@ CFFS::File::write(const void* buf, size_t size, bool progmem)
       if (device->write(addr, &header, sizeof(header)) != sizeof(header))
 	return (EIO);
 
-      // Continue write in new sector
+      // Continue write in new sector; add to extent list
       m_current_addr = sector + sizeof(header);
+      if (m_current_pos / sector_data_bytes() == m_extents) extent(sector);
+      m_hint = 0;
     }
   }
   return (count);
@@ -243,12 +276,92 @@ CFFS::begin(Flash::Device* flash)
       || strcmp_P(entry.name, PSTR("..")))
     return (false);
 
-  // A file system and root directory exists
+  // A file system and root directory exists; build free sector bitmap
   device = flash;
   current_dir_addr = addr;
+  if (build_sector_map() < 0) {
+    device = NULL;
+    return (false);
+  }
   return (true);
 }
 
+int
+CFFS::build_sector_map()
+{
+  // Read the type of the sectors covered by the bitmap
+  uint16_t max = device->SECTOR_MAX;
+  if (max > SECTOR_MAP_MAX) max = SECTOR_MAP_MAX;
+  uint32_t addr = device->SECTOR_BYTES;
+  uint16_t type;
+  free_sectors.empty();
+  deleted_sectors.empty();
+  next_sector = 0;
+  for (uint16_t i = 1; i < max; i++, addr += device->SECTOR_BYTES) {
+    if (device->read(&type, addr, sizeof(type)) != sizeof(type))
+      return (EIO);
+    if (type == FREE_TYPE)
+      free_sectors += i;
+    else if ((type & ALLOC_MASK) == 0)
+      deleted_sectors += i;
+  }
+  return (0);
+}
+
+int
+CFFS::reclaim(uint8_t count)
+{
+  // Check that the file system driver is initiated
+  if (device == NULL) return (ENXIO);
+
+  // Erase deleted sectors and mark as free
+  const uint8_t* bits = deleted_sectors.bits();
+  int res = 0;
+  for (uint16_t i = 0; (i < SECTOR_MAP_MAX / CHARBITS) && (res < count); i++) {
+    uint8_t set = bits[i];
+    if (set == 0) continue;
+    for (uint8_t j = 0; (j < CHARBITS) && (res < count); j++, set >>= 1) {
+      if ((set & 1) == 0) continue;
+      uint16_t ix = i * CHARBITS + j;
+      if (erase(device, ix * device->SECTOR_BYTES) != 0) return (EIO);
+      deleted_sectors -= ix;
+      free_sectors += ix;
+      res += 1;
+    }
+  }
+  return (res);
+}
+
+uint32_t
+CFFS::erase_count(uint16_t ix)
+{
+  if (device == NULL) return (0L);
+  uint32_t addr = ix * device->SECTOR_BYTES
+    + offsetof(descr_t, name) + ERASE_COUNT_POS;
+  uint32_t count;
+  if (device->read(&count, addr, sizeof(count)) != sizeof(count))
+    return (0L);
+  return (count == 0xffffffffL ? 0L : count);
+}
+
+int
+CFFS::erase(Flash::Device* flash, uint32_t addr)
+{
+  // Read the erase count; erased value is zero count
+  uint32_t pos = addr + offsetof(descr_t, name) + ERASE_COUNT_POS;
+  uint32_t count;
+  if (flash->read(&count, pos, sizeof(count)) != sizeof(count))
+    return (EIO);
+  if (count == 0xffffffffL) count = 0L;
+
+  // Erase the sector and write the new erase count
+  if (flash->erase(addr, flash->SECTOR_BYTES / 1024) != 0) return (EIO);
+  count += 1;
+  if (flash->write(pos, &count, sizeof(count)) != sizeof(count))
+    return (EIO);
+  return (0);
+}
+
 int
 CFFS::ls(IOStream& outs)
 {
@@ -335,7 +448,11 @@ CFFS::format(Flash::Device* flash, const char* name)
     if (flash->read(&header, addr, sizeof(header)) != sizeof(header))
       return (EIO);
     if (header.type != FREE_TYPE) {
-      if (flash->erase(addr, SIZE) != 0) return (EIO);
+      // Keep the erase count of all sectors except the master sector
+      if (i == 0) {
+	if (flash->erase(addr, SIZE) != 0) return (EIO);
+      }
+      else if (erase(flash, addr) != 0) return (EIO);
     }
     addr += flash->SECTOR_BYTES;
   }
@@ -461,11 +578,20 @@ CFFS::remove(uint32_t addr, uint16_t type)
   if (device->write(addr, &entry, sizeof(entry)) != sizeof(entry))
     return (EIO);
 
-  // Erase sectors
+  // Mark sectors as deleted; erased by reclaim
   while (ref != NULL_REF) {
     if (device->read(&entry, ref, sizeof(entry)) != sizeof(entry))
       return (EIO);
-    if (device->erase(ref, entry.size / 1024) != 0) return (EIO);
+    uint16_t ix = ref / device->SECTOR_BYTES;
+    if (ix < SECTOR_MAP_MAX) {
+      uint16_t type = entry.type & TYPE_MASK;
+      if (device->write(ref, &type, sizeof(type)) != sizeof(type))
+	return (EIO);
+      deleted_sectors += ix;
+    }
+    else {
+      if (erase(device, ref) != 0) return (EIO);
+    }
     ref = entry.ref;
   }
   return (0);
@@ -498,33 +624,71 @@ CFFS::write_P(uint32_t dest, const void* src, size_t size)
   return (device->write_P(dest, src, size));
 }
 
+uint32_t
+CFFS::alloc_sector()
+{
+  // Search the free sector bitmap from the allocation cursor and
+  // select the least worn of the next free sectors. Reclaim a deleted
+  // sector if there are no free sectors
+  uint16_t max = device->SECTOR_MAX;
+  if (max > SECTOR_MAP_MAX) max = SECTOR_MAP_MAX;
+  for (uint8_t retry = 0; retry < 2; retry++) {
+    uint16_t ix = next_sector;
+    uint16_t sector = 0;
+    uint32_t wear = 0xffffffffL;
+    uint8_t n = 0;
+    for (uint16_t i = 1; (i < max) && (n < WEAR_WINDOW); i++) {
+      if (++ix >= max) ix = 1;
+      if (!free_sectors[ix]) continue;
+      uint32_t count = erase_count(ix);
+      if (count < wear) {
+	wear = count;
+	sector = ix;
+      }
+      n += 1;
+    }
+    if (sector != 0) {
+      free_sectors -= sector;
+      next_sector = sector;
+      return (sector * device->SECTOR_BYTES);
+    }
+    if (reclaim() <= 0) break;
+  }
+
+  // Search for a free sector beyond the bitmap
+  uint32_t addr = SECTOR_MAP_MAX * device->SECTOR_BYTES;
+  uint16_t type;
+  for (uint16_t i = SECTOR_MAP_MAX; i < device->SECTOR_MAX; i++) {
+    if (device->read(&type, addr, sizeof(type)) != sizeof(type))
+      return (0L);
+    if (type == FREE_TYPE) return (addr);
+    addr += device->SECTOR_BYTES;
+  }
+  return (0L);
+}
+
 uint32_t
 CFFS::next_free_sector()
 {
   // Check that the file system driver is initiated
   if (device == NULL) return (0L);
 
-  // Search for a free sector
+  // Allocate a free sector
+  uint32_t addr = alloc_sector();
+  if (addr == 0L) return (0L);
+
+  // Initiate the sector header with an empty end of file hint
   descr_t header;
-  uint32_t addr = device->SECTOR_BYTES;
-  for (uint16_t i = 1; i < device->SECTOR_MAX; i++) {
-    if (device->read(&header, addr, sizeof(header)) != sizeof(header))
-      return (0L);
-    if (header.type != FREE_TYPE) {
-      addr += device->SECTOR_BYTES;
-      continue;
-    }
-    // Initiate the sector header
-    header.type = FILE_BLOCK_TYPE;
-    header.size = device->SECTOR_BYTES;
-    header.ref = NULL_REF;
-    memset(header.name, 0, sizeof(header.name));
-    if (device->write(addr, &header, sizeof(header)) != sizeof(header))
-      return (0L);
-    // Return address of sector
-    return (addr);
-  }
-  return (0L);
+  header.type = FILE_BLOCK_TYPE;
+  header.size = device->SECTOR_BYTES;
+  header.ref = NULL_REF;
+  memset(header.name, 0xff, sizeof(header.name));
+  header.name[0] = HINT_TAG;
+  if (device->write(addr, &header, sizeof(header)) != sizeof(header))
+    return (0L);
+
+  // Return address of sector
+  return (addr);
 }
 
 uint32_t
@@ -537,12 +701,8 @@ CFFS::next_free_directory()
   descr_t header;
   uint32_t addr;
   if (device->SECTOR_BYTES == device->DEFAULT_SECTOR_BYTES) {
-    addr = device->SECTOR_BYTES;
-    for (uint16_t i = 1; i < device->SECTOR_MAX; i++, addr += device->SECTOR_BYTES) {
-      if (device->read(&header, addr, sizeof(header)) != sizeof(header))
-	return (0L);
-      if (header.type == FREE_TYPE) break;
-    }
+    addr = alloc_sector();
+    if (addr == 0L) return (0L);
   }
   else {
     addr = device->DEFAULT_SECTOR_BYTES;
@@ -551,8 +711,8 @@ CFFS::next_free_directory()
 	return (0L);
       if (header.type == FREE_TYPE) break;
     }
+    if (header.type != FREE_TYPE) return (0L);
   }
-  if (header.type != FREE_TYPE) return (0L);
 
   // Initiate the parent directory reference
   memset(&header, 0, sizeof(header));
@@ -560,19 +720,43 @@ CFFS::next_free_directory()
   header.size = device->DEFAULT_SECTOR_BYTES;
   header.ref = current_dir_addr;
   strcpy_P(header.name, PSTR(".."));
+  memset(&header.name[ERASE_COUNT_POS], 0xff, sizeof(uint32_t));
   if (device->write(addr, &header, sizeof(header)) != sizeof(header))
     return (0L);
   // Return the directory address
   return (addr);
 }
 
+uint8_t
+CFFS::hint(const descr_t &header)
+{
+  // Check that the file block header carries a hint
+  if ((uint8_t) header.name[0] != HINT_TAG) return (HINT_NONE);
+
+  // Count the cleared fill mark bits
+  uint8_t marks = 0;
+  for (uint8_t i = 1; i <= HINT_MAX / CHARBITS; i++) {
+    uint8_t bits = header.name[i];
+    if (bits == 0) {
+      marks += CHARBITS;
+      continue;
+    }
+    while ((bits & 1) == 0) {
+      bits >>= 1;
+      marks += 1;
+    }
+    break;
+  }
+  return (marks);
+}
+
 int
-CFFS::find_end_of_file(uint32_t addr, uint32_t &pos, uint32_t &size)
+CFFS::find_end_of_file(File* file, uint32_t addr, uint32_t &pos, uint32_t &size)
 {
   // Check that the file system driver is initiated
   if (device == NULL) return (ENXIO);
 
-  // Locate last sector
+  // Locate last sector and build the extent list
   descr_t header;
   size = 0L;
   while (1) {
@@ -580,28 +764,51 @@ CFFS::find_end_of_file(uint32_t addr, uint32_t &pos, uint32_t &size)
       return (EIO);
     if (header.type != FILE_BLOCK_TYPE) return (ENXIO);
     if (header.size != device->SECTOR_BYTES) return (ENXIO);
+    file->extent(addr);
     if (header.ref == NULL_REF) break;
     addr = header.ref;
     size += (header.size - sizeof(header));
   }
 
-  // Locate end of sector
+  // Use the end of file hint to limit the search. The end of file is
+  // within the marked block, or the next if a write passed the mark
+  // boundary before the hint was updated
+  uint8_t marks = hint(header);
+  uint32_t low = addr + sizeof(header);
+  uint32_t high = addr + device->SECTOR_BYTES;
+  uint32_t end = high;
+  if (marks != HINT_NONE) {
+    uint32_t mark = addr + marks * hint_bytes();
+    if (mark > low) low = mark;
+    mark += 2 * hint_bytes();
+    if (mark < high) end = mark;
+  }
+  file->m_hint = marks;
+
+  // Locate end of sector; search backwards for last non-0xff value
   uint8_t buf[256];
-  addr += device->SECTOR_BYTES;
-  const uint16_t BUF_MAX = device->SECTOR_BYTES / sizeof(buf);
-  for (uint16_t i = 0; i < BUF_MAX; i++) {
-    addr -= sizeof(buf);
-    if (device->read(buf, addr, sizeof(buf)) != sizeof(buf))
-      return (EIO);
-    uint16_t j = sizeof(buf) - 1;
-    while (buf[j] == 0xff) if (j == 0) break; else j--;
-    if (j == 0) continue;
-    addr += j + 1;
-    break;
+  uint32_t last = low;
+  while (1) {
+    uint32_t top = end;
+    while (top > low) {
+      size_t count = (top - low > sizeof(buf) ? sizeof(buf) : top - low);
+      top -= count;
+      if (device->read(buf, top, count) != (int) count)
+	return (EIO);
+      int j = count - 1;
+      while ((j >= 0) && (buf[j] == 0xff)) j--;
+      if (j < 0) continue;
+      last = top + j + 1;
+      break;
+    }
+    // Check if the hint was not up to date; search the full sector
+    if ((last != end) || (end == high)) break;
+    low = end;
+    end = high;
   }
 
   // And return position and size
-  pos = addr;
-  size += (addr & device->SECTOR_MASK) - sizeof(header);
+  pos = last;
+  size += (last & device->SECTOR_MASK) - sizeof(header);
   return (0);
 }
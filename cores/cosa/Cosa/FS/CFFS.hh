@@ -24,13 +24,36 @@
 #include "Cosa/FS.hh"
 #include "Cosa/Flash.hh"
 #include "Cosa/IOStream.hh"
+#include "Cosa/BitSet.hh"
+#include "Cosa/Periodic.hh"
 
 /**
  * Cosa Flash File System for Flash Memory.
  *
+ * @section Performance
+ * The state of the sectors (free or allocated) is read once when the
+ * file system is mounted and kept in a RAM bitmap. Sector allocation
+ * is then a lookup in the bitmap instead of a scan of the flash
+ * sector headers. Open files cache the leading sectors of the sector
+ * chain (extent list) so that seek and read may step between sectors
+ * without reading the sector headers. The last sector of a file
+ * carries an end of file hint (fill mark) in the sector header which
+ * limits the end of file search to a few bytes.
+ *
+ * @section Wear Leveling
+ * Each sector header holds an erase count which is kept over
+ * erase. Sectors are allocated round-robin and the least worn of the
+ * next free sectors (WEAR_WINDOW) is selected. Removed files are not
+ * erased directly; their sectors are marked as deleted and erased
+ * by reclaim() which may be called from a Periodic (Reclaimer) or
+ * when idle. Deleted sectors are reclaimed on demand when there are
+ * no free sectors.
+ *
  * @section Limitations
  * Directory entries are not reclaimed (directory block is not erased
- * and rewritten when full).
+ * and rewritten when full). The sector bitmap covers the first
+ * SECTOR_MAP_MAX sectors; allocation beyond falls back to scanning
+ * the sector headers and these sectors are erased directly on remove.
  */
 class CFFS {
 public:
@@ -60,8 +83,15 @@ protected:
    * the  address of the first file block, name is the name of the file.
    *
    * FILE_BLOCK_TYPE is a file block; size is the block size (typically
-   * sector size), ref is the address of the next block, name is not
-   * used (filled with zero).
+   * sector size), ref is the address of the next block, name holds
+   * the end of file hint; a tag byte (HINT_TAG) followed by the fill
+   * mark bits (HINT_MAX). Older volumes have name filled with zero
+   * and no hint. A deleted file block has the allocation bit
+   * cleared and is erased by reclaim().
+   *
+   * The last bytes of all sector headers (ERASE_COUNT_POS in name)
+   * hold the erase count of the sector. It is programmed after erase
+   * and kept when the sector header is written (erased value).
 
    * DIR_ENTRY_TYPE is a directory reference; size is not used, ref is
    * the address of the directory block, name is the name of the
@@ -87,13 +117,36 @@ protected:
    */
   static const uint32_t NULL_REF = 0xffffffffL;
 
+  /**
+   * CFFS end of file hint tag in file block header name[0].
+   */
+  static const uint8_t HINT_TAG = 0xcf;
+
+  /**
+   * Number of fill mark bits in file block header (name[1..16]). Each
+   * cleared bit marks that 1/HINT_MAX of the sector has been written.
+   */
+  static const uint8_t HINT_MAX = 128;
+
+  /**
+   * CFFS no end of file hint (fill mark) available.
+   */
+  static const uint8_t HINT_NONE = 0xff;
+
+  /**
+   * CFFS erase count position in sector header name.
+   */
+  static const uint8_t ERASE_COUNT_POS = FILENAME_MAX - sizeof(uint32_t);
+
 public:
   /**
    * Flash File access class. Support for directories, hard links,
    * text and binary files. The end of the file is not store in the
    * directory entry, instead it is located when the file is
    * opened. This is done by searching for the first non-0xff value
-   * from the end of the last file sector. Text files may not use the
+   * from the end of the last file sector. The search is limited by
+   * the fill mark (end of file hint) in the last sector header which
+   * is updated while writing. Text files may not use the
    * value (0xff). Binary files must end each entry with non-0xff
    * entry. Write should always be in append mode as the file cannot
    * be rewritten with any value.
@@ -221,13 +274,48 @@ public:
     virtual int read(void* buf, size_t size);
 
   protected:
+    /** Max number of cached sectors (extent list). */
+    static const uint8_t EXTENT_MAX = 8;
+
     uint8_t m_flags;			//!< File open flags.
     uint32_t m_entry_addr;		//!< Entry address.
     CFFS::descr_t m_entry;		//!< Cached directory entry.
-    CFFS::descr_t m_sector;		//!< Cached sector header.
     uint32_t m_file_size;		//!< File size.
     uint32_t m_current_addr;		//!< Current flash address.
     uint32_t m_current_pos;		//!< Current logical position.
+    uint16_t m_extent[EXTENT_MAX];	//!< Leading sectors of the file.
+    uint8_t m_extents;			//!< Number of cached sectors.
+    uint8_t m_hint;			//!< Fill mark of last sector.
+
+    /**
+     * Return address of sector with the given index in the file
+     * sector chain. Cached sectors are returned directly, otherwise
+     * the chain is followed from the last cached sector. Return
+     * sector address or NULL_REF.
+     * @param[in] ix sector index in file.
+     * @return sector address or NULL_REF.
+     */
+    uint32_t sector(uint16_t ix);
+
+    /**
+     * Append sector to the extent list if there is room.
+     * @param[in] addr sector address.
+     */
+    void extent(uint32_t addr)
+    {
+      if (m_extents < EXTENT_MAX)
+	m_extent[m_extents++] = addr / device->SECTOR_BYTES;
+    }
+
+    /**
+     * Update the end of file hint in the last sector header to the
+     * current write address. Return zero(0) if successful otherwise
+     * negative error code.
+     * @return zero or negative error code.
+     */
+    int mark();
+
+    friend class CFFS;
 
     /**
      * @override IOStream::Device
@@ -304,6 +392,44 @@ public:
    */
   static int format(Flash::Device* flash, const char* name);
 
+  /**
+   * Reclaim sectors of removed files; erase at most the given number
+   * of deleted sectors and return them to the free sectors. Returns
+   * number of sectors reclaimed or a negative error code (ENXIO, EIO).
+   * @param[in] count max number of sectors to reclaim (default 1).
+   * @return number of sectors or negative error code.
+   */
+  static int reclaim(uint8_t count = 1);
+
+  /**
+   * Return the erase count of the sector with the given index.
+   * @param[in] ix sector index.
+   * @return erase count.
+   */
+  static uint32_t erase_count(uint16_t ix);
+
+  /**
+   * Periodic reclaim of deleted sectors. One sector is erased per
+   * period.
+   */
+  class Reclaimer : public Periodic {
+  public:
+    /**
+     * Construct periodic reclaim of deleted sectors with given period.
+     * @param[in] ms period of timeout.
+     */
+    Reclaimer(uint16_t ms) : Periodic(ms) {}
+
+    /**
+     * @override Periodic
+     * Reclaim one deleted sector.
+     */
+    virtual void run()
+    {
+      CFFS::reclaim();
+    }
+  };
+
   friend class File;
 
 protected:
@@ -316,6 +442,75 @@ protected:
   /** Current directory address. */
   static uint32_t current_dir_addr;
 
+  /** Max number of sectors in free sector bitmap. */
+  static const uint16_t SECTOR_MAP_MAX = 256;
+
+  /** Number of free sectors to select least worn from. */
+  static const uint8_t WEAR_WINDOW = 4;
+
+  /** Free sector bitmap; built when mounted. */
+  static BitSet<SECTOR_MAP_MAX> free_sectors;
+
+  /** Deleted sector bitmap; built when mounted. */
+  static BitSet<SECTOR_MAP_MAX> deleted_sectors;
+
+  /** Sector allocation cursor (round-robin). */
+  static uint16_t next_sector;
+
+  /**
+   * Build free and deleted sector bitmaps by reading the type of
+   * each sector header. Return zero(0) if successful otherwise
+   * negative error code.
+   * @return zero or negative error code.
+   */
+  static int build_sector_map();
+
+  /**
+   * Return number of bytes of file data in a sector.
+   * @return bytes.
+   */
+  static uint32_t sector_data_bytes()
+  {
+    return (device->SECTOR_BYTES - sizeof(descr_t));
+  }
+
+  /**
+   * Return number of bytes per end of file hint mark bit.
+   * @return bytes.
+   */
+  static uint32_t hint_bytes()
+  {
+    return (device->SECTOR_BYTES / HINT_MAX);
+  }
+
+  /**
+   * Return number of fill marks in the given file block header.
+   * Return HINT_NONE if the header does not carry a hint.
+   * @param[in] header file block header.
+   * @return number of marks or HINT_NONE.
+   */
+  static uint8_t hint(const descr_t &header);
+
+  /**
+   * Allocate a free sector from the free sector bitmap. The least
+   * worn of the next free sectors is selected. Deleted sectors are
+   * reclaimed if there are no free sectors. Sectors beyond the bitmap
+   * are found by scanning the sector headers. Returns sector address
+   * or zero.
+   * @return sector address or zero.
+   */
+  static uint32_t alloc_sector();
+
+  /**
+   * Erase sector with given address on given flash device and keep
+   * the erase count. Returns zero(0) if successful otherwise a
+   * negative error code.
+   * @param[in] flash device.
+   * @param[in] addr sector address.
+   * @return zero or negative error code.
+   */
+  static int erase(Flash::Device* flash, uint32_t addr);
+
   /**
    * Read flash block with the given size into the buffer from the
    * source address. Return number of bytes read or negative error
@@ -375,7 +570,8 @@ protected:
 		    descr_t &entry, uint32_t &addr);
 
   /**
-   * Remove directory entry. Returns zero(0) if successful otherwise a
+   * Remove directory entry. The file sectors are marked as deleted
+   * and erased by reclaim(). Returns zero(0) if successful otherwise a
    * negative error code.
    * @param[in] addr entry address.
    * @param[in] type entry type.
@@ -397,14 +593,17 @@ protected:
 
   /**
    * Find address and size of file that starts with the given
-   * sector. Return zero(0) if successful otherwise a negative error
-   * code.
+   * sector. The sector chain is appended to the given file extent
+   * list, and the fill mark of the last sector is returned. Return
+   * zero(0) if successful otherwise a negative error code.
+   * @param[in] file to cache sector chain in.
    * @param[in] sector address of sector.
    * @param[out] pos address of end of file.
    * @param[out] size of file.
    * @return zero or negative error code.
    */
-  static int find_end_of_file(uint32_t sector, uint32_t &pos, uint32_t &size);
+  static int find_end_of_file(File* file, uint32_t sector,
+			      uint32_t &pos, uint32_t &size);
 };
 
 #endif
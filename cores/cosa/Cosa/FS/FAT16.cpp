@@ -46,7 +46,7 @@ FAT16::make83Name(const char* str, uint8_t* name)
   return (name[0] != ' ');
 }
 
-SD *FAT16::device = NULL;
+IOBlock::Device *FAT16::device = NULL;
 
 bool FAT16::volumeInitialized = 0;
 uint8_t FAT16::fatCount;
@@ -65,11 +65,11 @@ uint32_t FAT16::cacheMirrorBlock = 0;
 void (*FAT16::dateTime)(uint16_t* date, uint16_t* time) = NULL;
 
 bool
-FAT16::begin(SD* sd, uint8_t part)
+FAT16::begin(IOBlock::Device* dev, uint8_t part)
 {
   // Error if invalid partition
   if (part > 4) return (false);
-  device = sd;
+  device = dev;
   uint32_t volumeStartBlock = 0;
 
   // If part == 0 assume super floppy with FAT16 boot sector in block zero
@@ -112,9 +112,9 @@ FAT16::begin(SD* sd, uint8_t part)
 }
 
 bool
-FAT16::begin(SD* sd)
+FAT16::begin(IOBlock::Device* dev)
 {
-  return (begin(sd, 1) || begin(sd, 0));
+  return (begin(dev, 1) || begin(dev, 0));
 }
 
 bool
@@ -23,6 +23,7 @@
 #define COSA_FS_FAT16_HH
 
 #include "Cosa/SPI/Driver/SD.hh"
+#include "Cosa/IOBlock.hh"
 #include "Cosa/IOStream.hh"
 #include "Cosa/FS.hh"
 
@@ -710,7 +711,7 @@ public:
 
   /**
    * Initialize a FAT16 volume.
-   * @param[in] dev SD device where the volume is located.
+   * @param[in] dev block device (SD) where the volume is located.
    * @param[in] part partition to be used. Legal values for \a part
    * are 1-4 to use the corresponding partition on a device formatted
    * with a MBR, Master Boot Record, or zero if the device is
@@ -721,19 +722,19 @@ public:
    * partition, a call to begin() after a volume has been successful
    * initialized or an I/O error.
    */
-  static bool begin(SD* sd, uint8_t partion);
+  static bool begin(IOBlock::Device* dev, uint8_t partion);
 
   /**
    * Initialize a FAT16 volume. First try partition 1 then try super
    * floppy format.
-   * @param[in] dev Sd device where the volume is located.
+   * @param[in] dev block device (SD) where the volume is located.
    * @return The value one, true, is returned for success and the
    * value zero, false, is returned for failure.  reasons for failure
    * include not finding a valid FAT16 file system, a call to begin()
    * after a volume has been successful initialized or an I/O error.
    *
    */
-  static bool begin(SD* sd);
+  static bool begin(IOBlock::Device* dev);
 
   /**
    * List directory contents to given iostream with selected
@@ -765,8 +766,8 @@ public:
   }
 
 protected:
-  // SD device (Fix: Should be an IOBlock::Device)
-  static SD *device;
+  // Block device (SD)
+  static IOBlock::Device *device;
 
   // Volume info
   static bool volumeInitialized; 	// true if volume has been initialized
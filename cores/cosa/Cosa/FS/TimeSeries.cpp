@@ -0,0 +1,219 @@
+/**
+ * @file Cosa/FS/TimeSeries.cpp
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/FS/TimeSeries.hh"
+
+bool
+TimeSeries::read_header(uint16_t block, header_t& header)
+{
+  uint32_t addr = address(block) - sizeof(header_t);
+  return (m_flash->read(&header, addr, sizeof(header)) == sizeof(header));
+}
+
+clock_t
+TimeSeries::timestamp(uint16_t block, uint16_t ix)
+{
+  clock_t res;
+  uint32_t addr = address(block) + ix * m_size;
+  if (m_flash->read(&res, addr, sizeof(res)) != sizeof(res)) return (ERASED);
+  return (res);
+}
+
+int
+TimeSeries::begin()
+{
+  if (m_count < 2 || m_records == 0 || m_size < sizeof(clock_t))
+    return (EINVAL);
+
+  // Locate the oldest and newest block from the sequence numbers
+  uint32_t min = ERASED;
+  uint32_t max = 0;
+  m_head = NONE;
+  m_tail = NONE;
+  for (uint16_t block = 0; block < m_count; block++) {
+    header_t header;
+    if (!read_header(block, header)) return (EIO);
+    if (header.seq == ERASED) continue;
+    if (header.seq <= min) {
+      min = header.seq;
+      m_head = block;
+    }
+    if (header.seq >= max || m_tail == NONE) {
+      max = header.seq;
+      m_tail = block;
+    }
+  }
+  if (m_tail == NONE) {
+    m_head = 0;
+    m_index = 0;
+    m_seq = 0;
+    m_last = 0;
+    return (0);
+  }
+  m_seq = max + 1;
+
+  // Binary search for the first erased record in the newest block
+  uint16_t low = 0;
+  uint16_t high = m_records;
+  while (low < high) {
+    uint16_t mid = (low + high) / 2;
+    if (timestamp(m_tail, mid) == ERASED) high = mid;
+    else low = mid + 1;
+  }
+  m_index = low;
+  if (m_index == 0) {
+    header_t header;
+    if (!read_header(m_tail, header)) return (EIO);
+    m_last = header.first;
+  }
+  else {
+    m_last = timestamp(m_tail, m_index - 1);
+  }
+  return (used());
+}
+
+int
+TimeSeries::erase()
+{
+  uint8_t kbytes = m_flash->SECTOR_BYTES / 1024;
+  for (uint16_t block = 0; block < m_count; block++) {
+    uint32_t addr = address(block) - sizeof(header_t);
+    int res = m_flash->erase(addr, kbytes);
+    if (res != 0) return (res);
+  }
+  m_head = 0;
+  m_tail = NONE;
+  m_index = 0;
+  m_seq = 0;
+  m_last = 0;
+  return (0);
+}
+
+int
+TimeSeries::append(const void* rec)
+{
+  clock_t time = *((const clock_t*) rec);
+  if (time == ERASED) return (EINVAL);
+  if (m_tail != NONE && time < m_last) return (EINVAL);
+
+  // Check if a new block is needed
+  if (m_tail == NONE || m_index == m_records) {
+    uint16_t block;
+    if (m_tail == NONE) {
+      block = m_head;
+    }
+    else {
+      // Close the block; program the max timestamp
+      uint32_t addr = address(m_tail) - sizeof(clock_t);
+      if (m_flash->write(addr, &m_last, sizeof(m_last)) != sizeof(m_last))
+	return (EIO);
+      // Recycle the oldest block if all blocks are used
+      block = next(m_tail);
+      if (block == m_head) m_head = next(m_head);
+    }
+
+    // Erase the block and write the header
+    header_t header;
+    uint32_t addr = address(block) - sizeof(header_t);
+    int res = m_flash->erase(addr, m_flash->SECTOR_BYTES / 1024);
+    if (res != 0) return (res);
+    header.seq = m_seq;
+    header.first = time;
+    header.last = ERASED;
+    if (m_flash->write(addr, &header, sizeof(header)) != sizeof(header))
+      return (EIO);
+    m_seq += 1;
+    m_tail = block;
+    m_index = 0;
+  }
+
+  // Append the record
+  uint32_t addr = address(m_tail) + m_index * m_size;
+  if (m_flash->write(addr, rec, m_size) != m_size) return (EIO);
+  m_index += 1;
+  m_last = time;
+  return (0);
+}
+
+TimeSeries::pos_t
+TimeSeries::find(clock_t time)
+{
+  if (m_tail == NONE) return (end());
+
+  // Binary search for the last block with first timestamp <= time
+  header_t header;
+  if (!read_header(m_head, header)) return (end());
+  if (header.first >= time) return (address(m_head));
+  if (time > m_last) return (end());
+  uint16_t low = 0;
+  uint16_t high = used() - 1;
+  while (low < high) {
+    uint16_t mid = (low + high + 1) / 2;
+    if (!read_header(block(mid), header)) return (end());
+    if (header.first <= time) low = mid;
+    else high = mid - 1;
+  }
+  uint16_t blk = block(low);
+
+  // Check the max timestamp of closed blocks; next block
+  if (blk != m_tail) {
+    if (!read_header(blk, header)) return (end());
+    if (header.last < time) return (address(next(blk)));
+  }
+
+  // Binary search for the first record with timestamp >= time
+  uint16_t n = (blk == m_tail) ? m_index : m_records;
+  uint16_t rl = 0;
+  uint16_t rh = n;
+  while (rl < rh) {
+    uint16_t mid = (rl + rh) / 2;
+    if (timestamp(blk, mid) < time) rl = mid + 1;
+    else rh = mid;
+  }
+  if (rl < n) return (address(blk) + rl * m_size);
+  return (blk == m_tail ? end() : address(next(blk)));
+}
+
+int
+TimeSeries::read(pos_t& pos, void* rec)
+{
+  if (pos == end()) return (0);
+  int res = m_flash->read(rec, pos, m_size);
+  if (res != m_size) return (res < 0 ? res : EIO);
+
+  // Step to the next record; next block when at end of block
+  uint16_t blk = (pos / m_flash->SECTOR_BYTES) - m_sector;
+  uint16_t ix = ((pos & m_flash->SECTOR_MASK) - sizeof(header_t)) / m_size;
+  if (blk == m_tail || ix + 1 < m_records)
+    pos += m_size;
+  else
+    pos = address(next(blk));
+  return (m_size);
+}
+
+int
+TimeSeries::last(void* rec)
+{
+  if (m_tail == NONE || m_index == 0) return (0);
+  uint32_t addr = address(m_tail) + (m_index - 1) * m_size;
+  int res = m_flash->read(rec, addr, m_size);
+  if (res != m_size) return (res < 0 ? res : EIO);
+  return (m_size);
+}
@@ -0,0 +1,245 @@
+/**
+ * @file Cosa/FS/TimeSeries.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_FS_TIMESERIES_HH
+#define COSA_FS_TIMESERIES_HH
+
+#include "Cosa/Flash.hh"
+#include "Cosa/Time.hh"
+
+/**
+ * Circular, append-only time-series store on Flash::Device. Fixed
+ * size records are appended to blocks (one block per flash sector)
+ * in a given range of sectors. Each record must start with a
+ * timestamp (clock_t) and records must be appended in time order.
+ * When all blocks are used the oldest block is erased and recycled.
+ *
+ * Each block starts with a header with sequence number, time of the
+ * first record (min) and time of the last record (max). The max time
+ * is programmed when the block is full. Blocks are found with binary
+ * search on the block headers and records with binary search on the
+ * record timestamps within the block. Range queries and tail reads
+ * cost a few header and timestamp reads.
+ *
+ * @section Limitations
+ * The max value of clock_t (0xffffffff) is the erased state and may
+ * not be used as a timestamp.
+ */
+class TimeSeries {
+public:
+  /** Position in time series; flash address of record. */
+  typedef uint32_t pos_t;
+
+  /**
+   * Construct time series store on given flash device and range of
+   * sectors with given record size.
+   * @param[in] flash device.
+   * @param[in] sector first sector of store.
+   * @param[in] count number of sectors (min 2).
+   * @param[in] size of record in bytes (min sizeof(clock_t)).
+   */
+  TimeSeries(Flash::Device* flash, uint16_t sector, uint16_t count,
+	     uint16_t size) :
+    m_flash(flash),
+    m_sector(sector),
+    m_count(count),
+    m_size(size),
+    m_records((flash->SECTOR_BYTES - sizeof(header_t)) / size),
+    m_head(NONE),
+    m_tail(NONE),
+    m_index(0),
+    m_seq(0),
+    m_last(0)
+  {}
+
+  /**
+   * Scan the block headers and locate the oldest and newest block and
+   * the end of the newest block. Return number of blocks in use or
+   * negative error code.
+   * @return number of blocks or negative error code.
+   */
+  int begin();
+
+  /**
+   * Erase all blocks in the store. Return zero if successful otherwise
+   * negative error code.
+   * @return zero or negative error code.
+   */
+  int erase();
+
+  /**
+   * Append the given record. The record must start with a timestamp
+   * that is not less than the timestamp of the last record. Return
+   * zero if successful otherwise negative error code; EINVAL if the
+   * timestamp is out of order.
+   * @param[in] rec record to append.
+   * @return zero or negative error code.
+   */
+  int append(const void* rec);
+
+  /**
+   * Return position of first record with timestamp greater or equal
+   * to the given time, or end() if there is no such record.
+   * @param[in] time timestamp to search for.
+   * @return position.
+   */
+  pos_t find(clock_t time);
+
+  /**
+   * Return position of the oldest record.
+   * @return position.
+   */
+  pos_t begin_pos() const
+  {
+    if (m_tail == NONE) return (end());
+    return (address(m_head));
+  }
+
+  /**
+   * Return position after the latest record.
+   * @return position.
+   */
+  pos_t end() const
+  {
+    if (m_tail == NONE) return (0);
+    return (address(m_tail) + m_index * m_size);
+  }
+
+  /**
+   * Read record at given position into the given buffer and advance
+   * the position to the next record. Return record size if successful,
+   * zero at end, otherwise negative error code.
+   * @param[in,out] pos position of record.
+   * @param[in] rec buffer for record.
+   * @return record size, zero or negative error code.
+   */
+  int read(pos_t& pos, void* rec);
+
+  /**
+   * Read the latest record into the given buffer. Return record size
+   * if successful, zero if empty, otherwise negative error code.
+   * @param[in] rec buffer for record.
+   * @return record size, zero or negative error code.
+   */
+  int last(void* rec);
+
+  /**
+   * Return timestamp of the latest record.
+   * @return timestamp.
+   */
+  clock_t last_time() const
+  {
+    return (m_last);
+  }
+
+  /**
+   * Return number of records per block.
+   * @return records.
+   */
+  uint16_t records() const
+  {
+    return (m_records);
+  }
+
+protected:
+  /** Block header. */
+  struct header_t {
+    uint32_t seq;		//!< Block sequence number.
+    clock_t first;		//!< Timestamp of first record (min).
+    clock_t last;		//!< Timestamp of last record (max).
+  };
+
+  /** Erased state and no block mark. */
+  static const uint16_t NONE = 0xffff;
+  static const clock_t ERASED = 0xffffffffUL;
+
+  Flash::Device* m_flash;	//!< Flash memory device.
+  const uint16_t m_sector;	//!< First sector.
+  const uint16_t m_count;	//!< Number of blocks (sectors).
+  const uint16_t m_size;	//!< Record size.
+  const uint16_t m_records;	//!< Records per block.
+  uint16_t m_head;		//!< Oldest block.
+  uint16_t m_tail;		//!< Newest block.
+  uint16_t m_index;		//!< Next record index in newest block.
+  uint32_t m_seq;		//!< Next block sequence number.
+  clock_t m_last;		//!< Timestamp of latest record.
+
+  /**
+   * Return flash address of first record in given block.
+   * @param[in] block index.
+   * @return address.
+   */
+  uint32_t address(uint16_t block) const
+  {
+    return ((m_sector + block) * m_flash->SECTOR_BYTES + sizeof(header_t));
+  }
+
+  /**
+   * Return block index of given logical index (0 is oldest block).
+   * @param[in] ix logical index.
+   * @return block index.
+   */
+  uint16_t block(uint16_t ix) const
+  {
+    ix += m_head;
+    return (ix < m_count ? ix : ix - m_count);
+  }
+
+  /**
+   * Return next block index after the given.
+   * @param[in] block index.
+   * @return block index.
+   */
+  uint16_t next(uint16_t block) const
+  {
+    return (block + 1 < m_count ? block + 1 : 0);
+  }
+
+  /**
+   * Return number of blocks in use.
+   * @return blocks.
+   */
+  uint16_t used() const
+  {
+    if (m_tail == NONE) return (0);
+    if (m_tail >= m_head) return (m_tail - m_head + 1);
+    return (m_tail + m_count - m_head + 1);
+  }
+
+  /**
+   * Read header of given block. Return true(1) if successful
+   * otherwise false(0).
+   * @param[in] block index.
+   * @param[out] header block header.
+   * @return bool.
+   */
+  bool read_header(uint16_t block, header_t& header);
+
+  /**
+   * Read timestamp of given record in given block. Return ERASED on
+   * read error or erased record.
+   * @param[in] block index.
+   * @param[in] ix record index.
+   * @return timestamp.
+   */
+  clock_t timestamp(uint16_t block, uint16_t ix);
+};
+
+#endif
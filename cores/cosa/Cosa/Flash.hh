@@ -22,6 +22,8 @@
 #define COSA_FLASH_HH
 
 #include "Cosa/Types.h"
+#include "Cosa/Linkage.hh"
+#include "Cosa/Watchdog.hh"
 
 class Flash {
 public:
@@ -136,6 +138,180 @@ public:
      */
     virtual int write_P(uint32_t dest, const void* scr, size_t size) = 0;
   };
+
+  /**
+   * Cosa Flash memory device wrapper with operation counters. Forwards
+   * all operations to the given device and counts number of read,
+   * program and erase operations and bytes. Used to measure device
+   * operations per file system operation.
+   */
+  class Counter : public Device {
+  public:
+    /**
+     * Construct counting flash memory device for given device.
+     * @param[in] dev flash memory device.
+     */
+    Counter(Device* dev) :
+      Device(dev->SECTOR_BYTES, dev->SECTOR_MAX),
+      m_dev(dev)
+    {
+      reset();
+    }
+
+    /**
+     * Reset counters.
+     */
+    void reset()
+    {
+      reads = 0L;
+      read_bytes = 0L;
+      programs = 0L;
+      program_bytes = 0L;
+      erases = 0L;
+    }
+
+    /**
+     * @override Flash::Device
+     * Forward device initiate.
+     */
+    virtual bool begin()
+    {
+      return (m_dev->begin());
+    }
+
+    /**
+     * @override Flash::Device
+     * Forward device ready status.
+     */
+    virtual bool is_ready()
+    {
+      return (m_dev->is_ready());
+    }
+
+    /**
+     * @override Flash::Device
+     * Count and forward read.
+     */
+    virtual int read(void* dest, uint32_t src, size_t size)
+    {
+      reads += 1;
+      read_bytes += size;
+      return (m_dev->read(dest, src, size));
+    }
+
+    /**
+     * @override Flash::Device
+     * Count and forward erase.
+     */
+    virtual int erase(uint32_t dest, uint8_t size)
+    {
+      erases += 1;
+      return (m_dev->erase(dest, size));
+    }
+
+    /**
+     * @override Flash::Device
+     * Count and forward program.
+     */
+    virtual int write(uint32_t dest, const void* src, size_t size)
+    {
+      programs += 1;
+      program_bytes += size;
+      return (m_dev->write(dest, src, size));
+    }
+
+    /**
+     * @override Flash::Device
+     * Count and forward program from program memory.
+     */
+    virtual int write_P(uint32_t dest, const void* src, size_t size)
+    {
+      programs += 1;
+      program_bytes += size;
+      return (m_dev->write_P(dest, src, size));
+    }
+
+    uint32_t reads;		//!< Number of read operations.
+    uint32_t read_bytes;	//!< Number of bytes read.
+    uint32_t programs;		//!< Number of program operations.
+    uint32_t program_bytes;	//!< Number of bytes programmed.
+    uint32_t erases;		//!< Number of erase operations.
+
+  protected:
+    Device* m_dev;		//!< Flash memory device.
+  };
+
+  /**
+   * Cosa Flash memory device completion poller. Checks the device
+   * ready status on watchdog timeout and pushes a completed event
+   * (Event::WRITE_COMPLETED_TYPE) to the target when the device is
+   * ready. Used by device drivers for asynchronous erase. The
+   * watchdog timeout events are requested while polling (see
+   * Watchdog::acquire()); a running watchdog should have a period
+   * of the polling period or less.
+   */
+  class Poller : public Link {
+  public:
+    /**
+     * Construct completion poller for given flash memory device.
+     * @param[in] dev flash memory device.
+     */
+    Poller(Device* dev) : Link(), m_dev(dev), m_target(NULL) {}
+
+    /**
+     * Start polling the device with the given period and notify the
+     * target on completion.
+     * @param[in] target event handler to notify.
+     * @param[in] ms polling period (default 16 ms).
+     */
+    void begin(Event::Handler* target, uint16_t ms = 16)
+    {
+      if (m_target == NULL) Watchdog::acquire(ms);
+      m_target = target;
+      Watchdog::attach(this, ms);
+    }
+
+    /**
+     * Stop polling.
+     */
+    void end()
+    {
+      detach();
+      if (m_target == NULL) return;
+      m_target = NULL;
+      Watchdog::release();
+    }
+
+    /**
+     * Return true(1) if the poller is active otherwise false(0).
+     * @return bool.
+     */
+    bool is_active() const
+    {
+      return (m_target != NULL);
+    }
+
+  protected:
+    /**
+     * @override Event::Handler
+     * Check device ready status on timeout and notify the target when
+     * ready.
+     * @param[in] type the type of event.
+     * @param[in] value the event value.
+     */
+    virtual void on_event(uint8_t type, uint16_t value)
+    {
+      UNUSED(value);
+      if (type != Event::TIMEOUT_TYPE) return;
+      if (!m_dev->is_ready()) return;
+      Event::Handler* target = m_target;
+      end();
+      Event::push(Event::WRITE_COMPLETED_TYPE, target);
+    }
+
+    Device* m_dev;		//!< Flash memory device.
+    Event::Handler* m_target;	//!< Completion target.
+  };
 };
 
 #endif
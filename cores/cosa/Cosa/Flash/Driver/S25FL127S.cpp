@@ -53,32 +53,54 @@ S25FL127S::is_ready()
     spi.end();
   spi.release();
 
-  // Return Write-In-Progress is off
-  return (!m_status.WIP);
+  // Check for completion of asynchronous erase; not ready while the
+  // erase is suspended
+  if (m_status.WIP || m_suspended) return (false);
+  if (!m_suspended) m_erasing = false;
+  return (true);
 }
 
 int
 S25FL127S::read(void* dest, uint32_t src, size_t size)
 {
+  // Wait for erase of the sector to complete; the contents are
+  // undefined while erasing. Otherwise suspend erase in progress
+  bool suspended = false;
+  if (is_erase_sector(src, size)) {
+    int res = await();
+    if (res < 0) return (res);
+  }
+  else if (m_erasing) {
+    suspended = (erase_suspend() == 0);
+  }
+
   // Use READ with 24-bit address; Big-endian
-  uint8_t* sp = (uint8_t*) &src;
   int res = (int) size;
   spi.acquire(this);
     spi.begin();
-      spi.transfer(READ);
-      spi.transfer(sp[2]);
-      spi.transfer(sp[1]);
-      spi.transfer(sp[0]);
+      command(READ, src);
       spi.read(dest, size);
     spi.end();
   spi.release();
 
+  // Resume suspended erase
+  if (suspended) erase_resume();
+
   // Return number of bytes read
   return (res);
 }
 
 int
 S25FL127S::erase(uint32_t dest, uint8_t size)
+{
+  // Start erase and wait for completion
+  int res = erase_request(dest, size);
+  if (res < 0) return (res);
+  return (await());
+}
+
+int
+S25FL127S::erase_request(uint32_t dest, uint8_t size, Event::Handler* target)
 {
   uint8_t op;
   switch (size) {
@@ -87,125 +109,157 @@ S25FL127S::erase(uint32_t dest, uint8_t size)
   case 255: op = BER; break;
   default: return (EINVAL);
   }
+
+  // Wait for any previous program or erase
+  await();
+
   spi.acquire(this);
     // Write enable before page erase.
     spi.begin();
       spi.transfer(WREN);
     spi.end();
     // Use erase(P4E/SER/BER) with possible 24-bit address; Big-endian
-    uint8_t* dp = (uint8_t*) &dest;
     spi.begin();
-      spi.transfer(op);
-      if (op != BER) {
-	spi.transfer(dp[2]);
-	spi.transfer(dp[1]);
-	spi.transfer(dp[0]);
-      }
+      if (op != BER)
+	command(op, dest);
+      else
+	spi.transfer(op);
     spi.end();
   spi.release();
 
-  // Wait for completion
-  while (!is_ready()) yield();
-
-  // Return error code(-1) if erase error otherwise zero
-  return (m_status.E_ERR ? EFAULT : 0);
+  // Mark erase in progress and poll for completion if requested
+  m_erase_size = (op == P4E ? 4 * 1024L : op == SER ? 64 * 1024L : 0L);
+  m_erase_addr = (m_erase_size == 0 ? 0L : dest & ~(m_erase_size - 1));
+  m_erasing = true;
+  if (target != NULL) m_poller.begin(target);
+  return (0);
 }
 
 int
-S25FL127S::write(uint32_t dest, const void* src, size_t size)
+S25FL127S::erase_suspend()
 {
-  // Check for zero buffer size
-  if (size == 0) return (0);
+  // Check that an erase is in progress
+  if (!m_erasing || m_suspended) return (ENXIO);
 
-  // Set up destination and source pointers
-  uint8_t* dp = (uint8_t*) &dest;
-  uint8_t* sp = (uint8_t*) src;
-  int res = (int) size;
+  // Issue suspend and wait for the device to become ready (tESL)
+  spi.acquire(this);
+    spi.begin();
+      spi.transfer(ERSP);
+    spi.end();
+    spi.begin();
+      spi.transfer(RDSR1);
+      do m_status = spi.transfer(0); while (m_status.WIP);
+    spi.end();
+  spi.release();
 
-  // Calculate block size of first program
-  size_t count = PAGE_MAX - (dest & PAGE_MASK);
-  if (count > size) count = size;
+  // Check if the erase was completed before the suspend
+  status2_t status = read_status2();
+  if (!status.ES) {
+    m_erasing = false;
+    return (ENXIO);
+  }
+  m_suspended = true;
+  return (0);
+}
 
-  while (1) {
-    spi.acquire(this);
-      // Write enable before program
-      spi.begin();
-        spi.transfer(WREN);
-      spi.end();
-      // Use PP with 24-bit address; Big-endian
-      spi.begin();
-        spi.transfer(PP);
-	spi.transfer(dp[2]);
-	spi.transfer(dp[1]);
-	spi.transfer(dp[0]);
-	spi.write(sp, count);
-      spi.end();
-    spi.release();
-
-    // Wait for completion
-    while (!is_ready()) yield();
+int
+S25FL127S::erase_resume()
+{
+  // Check that an erase is suspended
+  if (!m_suspended) return (ENXIO);
 
-    // Check for program error
-    if (m_status.P_ERR) return (EFAULT);
+  // Issue resume
+  spi.acquire(this);
+    spi.begin();
+      spi.transfer(ERRS);
+    spi.end();
+  spi.release();
+  m_suspended = false;
+  return (0);
+}
 
-    // Step to next page
-    size -= count;
-    if (size == 0) break;
-    dest += count;
-    sp += count;
-    count = (size > PAGE_MAX ? PAGE_MAX : size);
+int
+S25FL127S::await()
+{
+  // Erase is long; poll status and yield
+  if (m_erasing) {
+    if (m_suspended) erase_resume();
+    while (!is_ready()) yield();
+    m_erasing = false;
+    m_poller.end();
+    return (m_status.E_ERR ? EFAULT : 0);
   }
 
-  // Return number of bytes programmed
-  return (res);
+  // Page program is short; read status continuously in one transaction
+  spi.acquire(this);
+    spi.begin();
+      spi.transfer(RDSR1);
+      do m_status = spi.transfer(0); while (m_status.WIP);
+    spi.end();
+  spi.release();
+
+  // Return error code if program error otherwise zero
+  return (m_status.P_ERR ? EFAULT : 0);
 }
 
 int
-S25FL127S::write_P(uint32_t dest, const void* src, size_t size)
+S25FL127S::program(uint32_t dest, const void* src, size_t size, bool progmem)
 {
-  // Check for zero buffer size
-  if (size == 0) return (0);
-
-  // Set up destination and source pointers
-  uint8_t* dp = (uint8_t*) &dest;
-  uint8_t* sp = (uint8_t*) src;
-  int res = (int) size;
+  // Wait for previous program and check for errors
+  if (await() < 0) return (EFAULT);
 
-  // Calculate block size of first program
+  // Calculate block size of page program
   size_t count = PAGE_MAX - (dest & PAGE_MASK);
   if (count > size) count = size;
+  if (count == 0) return (0);
 
-  while (1) {
-    spi.acquire(this);
-      // Write enable before program
-      spi.begin();
-        spi.transfer(WREN);
-      spi.end();
-      // Use PP with 24-bit address; Big-endian
-      spi.begin();
-        spi.transfer(PP);
-	spi.transfer(dp[2]);
-	spi.transfer(dp[1]);
-	spi.transfer(dp[0]);
-	spi.write_P(sp, count);
-      spi.end();
-    spi.release();
-
-    // Wait for completion
-    while (!is_ready()) yield();
+  spi.acquire(this);
+    // Write enable before program
+    spi.begin();
+      spi.transfer(WREN);
+    spi.end();
+    // Use PP with 24-bit address; Big-endian
+    spi.begin();
+      command(PP, dest);
+      if (progmem)
+	spi.write_P(src, count);
+      else
+	spi.write(src, count);
+    spi.end();
+  spi.release();
 
-    // Check for program error
-    if (m_status.P_ERR) return (EFAULT);
+  // Return number of bytes in page program
+  return ((int) count);
+}
 
-    // Step to next page
-    size -= count;
-    if (size == 0) break;
+int
+S25FL127S::write(uint32_t dest, const void* src, size_t size)
+{
+  return (write(dest, src, size, false));
+}
+
+int
+S25FL127S::write_P(uint32_t dest, const void* src, size_t size)
+{
+  return (write(dest, src, size, true));
+}
+
+int
+S25FL127S::write(uint32_t dest, const void* src, size_t size, bool progmem)
+{
+  // Pipeline page programs; status is polled before next page
+  const uint8_t* sp = (const uint8_t*) src;
+  int res = (int) size;
+  while (size != 0) {
+    int count = program(dest, sp, size, progmem);
+    if (count < 0) return (count);
     dest += count;
     sp += count;
-    count = (size > PAGE_MAX ? PAGE_MAX : size);
+    size -= count;
   }
 
-  // Return number of bytes programmed
+  // Wait for completion of the last page
+  if (await() < 0) return (EFAULT);
   return (res);
 }
 
@@ -51,12 +51,22 @@ public:
 #if !defined(BOARD_ATTINYX5)
   S25FL127S(Board::DigitalPin csn = Board::D5) :
     Flash::Device(64 * 1024L, 256),
-    SPI::Driver(csn, SPI::ACTIVE_LOW, SPI::DIV2_CLOCK, 0, SPI::MSB_ORDER, NULL)
+    SPI::Driver(csn, SPI::ACTIVE_LOW, SPI::DIV2_CLOCK, 0, SPI::MSB_ORDER, NULL),
+    m_poller(this),
+    m_erasing(false),
+    m_suspended(false),
+    m_erase_addr(0L),
+    m_erase_size(0L)
   {}
 #else
   S25FL127S(Board::DigitalPin csn = Board::D3) :
     Flash::Device(64 * 1024L, 256),
-    SPI::Driver(csn, SPI::ACTIVE_LOW, SPI::DIV2_CLOCK, 0, SPI::MSB_ORDER, NULL)
+    SPI::Driver(csn, SPI::ACTIVE_LOW, SPI::DIV2_CLOCK, 0, SPI::MSB_ORDER, NULL),
+    m_poller(this),
+    m_erasing(false),
+    m_suspended(false),
+    m_erase_addr(0L),
+    m_erase_size(0L)
   {}
 #endif
 
@@ -72,7 +82,7 @@ public:
   /**
    * @override Flash::Device
    * Return true(1) if the device is ready, write cycle is completed,
-   * otherwise false(0).
+   * otherwise false(0). Not ready while an erase is suspended.
    * @return bool
    */
   virtual bool is_ready();
@@ -126,6 +136,76 @@ public:
    */
   virtual int write_P(uint32_t dest, const void* buf, size_t size);
 
+  /**
+   * Start programming the page at given destination address with
+   * the contents of the source buffer in data or program memory. At
+   * most the remaining bytes of the page are programmed. Waits for
+   * any previous program to complete but returns without waiting for
+   * this page. The caller may prepare the next page during the page
+   * program time (tPP). Use await() to wait for completion. Return
+   * number of bytes programmed or negative error code (EFAULT if
+   * previous program not successful).
+   * @param[in] dest address in flash to write to.
+   * @param[in] src buffer to write to flash.
+   * @param[in] size number of bytes to write.
+   * @param[in] progmem source in data(false) or program memory(true).
+   * @return number of bytes or negative error code.
+   */
+  int program(uint32_t dest, const void* src, size_t size,
+	      bool progmem = false);
+
+  /**
+   * Wait for program or erase to complete. The status register is
+   * read continuously in a single transaction while programming and
+   * polled with yield while erasing. Returns zero(0) if successful
+   * otherwise a negative error code (EFAULT on program/erase error).
+   * @return zero or negative error code.
+   */
+  int await();
+
+  /**
+   * Start erase of given flash block for given byte address and
+   * return without waiting for completion. The target is notified
+   * with a completed event (Event::WRITE_COMPLETED_TYPE) when the
+   * erase is completed; polled on watchdog timeout (see
+   * Flash::Poller). A read during an asynchronous erase will suspend
+   * the erase and resume after the read. A read within the sector
+   * being erased waits for the erase to complete. Returns zero(0) if
+   * successful otherwise an negative error code (EINVAL on illegal
+   * sector size).
+   * @param[in] dest destination block byte address to erase.
+   * @param[in] size of sector to erase in Kbyte (Default 4 KByte).
+   * @param[in] target event handler to notify (default none).
+   * @return zero or negative error code.
+   */
+  int erase_request(uint32_t dest, uint8_t size = 4,
+		    Event::Handler* target = NULL);
+
+  /**
+   * Return true(1) if an asynchronous erase is in progress otherwise
+   * false(0).
+   * @return bool.
+   */
+  bool is_erasing() const
+  {
+    return (m_erasing);
+  }
+
+  /**
+   * Suspend erase in progress. Reads are possible while
+   * suspended. Returns zero(0) if an erase was suspended otherwise
+   * a negative error code (ENXIO if no erase in progress).
+   * @return zero or negative error code.
+   */
+  int erase_suspend();
+
+  /**
+   * Resume suspended erase. Returns zero(0) if successful otherwise a
+   * negative error code (ENXIO if no erase suspended).
+   * @return zero or negative error code.
+   */
+  int erase_resume();
+
   /**
    * Configuration Register 1 (CR1) bitfields (Table 8.6, pp. 59).
    */
@@ -320,6 +400,63 @@ protected:
 
   /** Latest status; is_ready() call */
   status1_t m_status;
+  /**
+   * Write flash block at given destination address with the contents
+   * of the source buffer in data or program memory. Page programs are
+   * pipelined. Return number of bytes written or negative error code.
+   * @param[in] dest address in flash to write to.
+   * @param[in] src buffer to write to flash.
+   * @param[in] size number of bytes to write.
+   * @param[in] progmem source in data(false) or program memory(true).
+   * @return number of bytes or negative error code.
+   */
+  int write(uint32_t dest, const void* src, size_t size, bool progmem);
+
+  /** Erase completion poller */
+  Flash::Poller m_poller;
+
+  /** Asynchronous erase in progress */
+  bool m_erasing;
+
+  /** Erase suspended */
+  bool m_suspended;
+
+  /** Address of sector being erased */
+  uint32_t m_erase_addr;
+
+  /** Size of sector being erased; zero(0) for chip erase */
+  uint32_t m_erase_size;
+
+  /**
+   * Return true(1) if the given block is within the sector being
+   * erased otherwise false(0).
+   * @param[in] addr address in flash.
+   * @param[in] size number of bytes.
+   * @return bool.
+   */
+  bool is_erase_sector(uint32_t addr, size_t size) const
+  {
+    if (!m_erasing) return (false);
+    if (m_erase_size == 0) return (true);
+    return ((addr < m_erase_addr + m_erase_size)
+	    && (m_erase_addr < addr + size));
+  }
+
+  /**
+   * Issue command and 24-bit address. Should only be used within a
+   * SPI transaction; begin()-end() block.
+   * @param[in] op command code.
+   * @param[in] addr address.
+   */
+  void command(uint8_t op, uint32_t addr)
+    __attribute__((always_inline))
+  {
+    uint8_t* ap = (uint8_t*) &addr;
+    spi.transfer(op);
+    spi.transfer(ap[2]);
+    spi.transfer(ap[1]);
+    spi.transfer(ap[0]);
+  }
 };
 
 #endif
@@ -53,21 +53,22 @@ W25X40CL::is_ready()
     spi.end();
   spi.release();
 
-  // Return device is true if the device is not busy
-  return (!m_status.BUSY);
+  // Return device is true if the device is not busy; erase completed
+  if (m_status.BUSY) return (false);
+  m_erasing = false;
+  return (true);
 }
 
 int
 W25X40CL::read(void* dest, uint32_t src, size_t size)
 {
+  // No erase suspend; wait for erase in progress
+  if (m_erasing) await();
+
   // Use READ with 24-bit address; Big-endian
-  uint8_t* sp = (uint8_t*) &src;
   spi.acquire(this);
     spi.begin();
-      spi.transfer(READ);
-      spi.transfer(sp[2]);
-      spi.transfer(sp[1]);
-      spi.transfer(sp[0]);
+      command(READ, src);
       spi.read(dest, size);
     spi.end();
   spi.release();
@@ -78,6 +79,15 @@ W25X40CL::read(void* dest, uint32_t src, size_t size)
 
 int
 W25X40CL::erase(uint32_t dest, uint8_t size)
+{
+  // Start erase and wait for completion
+  int res = erase_request(dest, size);
+  if (res < 0) return (res);
+  return (await());
+}
+
+int
+W25X40CL::erase_request(uint32_t dest, uint8_t size, Event::Handler* target)
 {
   uint8_t op;
   switch (size) {
@@ -87,117 +97,109 @@ W25X40CL::erase(uint32_t dest, uint8_t size)
   case 255: op = CER; break;
   default: return (EINVAL);
   }
+
+  // Wait for any previous program or erase
+  await();
+
   spi.acquire(this);
     // Write enable before page erase.
     spi.begin();
       spi.transfer(WREN);
     spi.end();
     // Use erase (SE/B32E/B64E/CER) with possible 24-bit address
-    uint8_t* dp = (uint8_t*) &dest;
     spi.begin();
-      spi.transfer(op);
-      if (op != CER) {
-	spi.transfer(dp[2]);
-	spi.transfer(dp[1]);
-	spi.transfer(dp[0]);
-      }
+      if (op != CER)
+	command(op, dest);
+      else
+	spi.transfer(op);
     spi.end();
   spi.release();
 
-  // Wait for completion and return no error
-  while (!is_ready()) yield();
+  // Mark erase in progress and poll for completion if requested
+  m_erasing = true;
+  if (target != NULL) m_poller.begin(target);
   return (0);
 }
 
 int
-W25X40CL::write(uint32_t dest, const void* src, size_t size)
+W25X40CL::await()
 {
-  // Check for zero buffer size
-  if (size == 0) return (0);
+  // Erase is long; poll status and yield
+  if (m_erasing) {
+    while (!is_ready()) yield();
+    m_erasing = false;
+    m_poller.end();
+    return (0);
+  }
 
-  // Set up destination and source pointers
-  uint8_t* dp = (uint8_t*) &dest;
-  uint8_t* sp = (uint8_t*) src;
-  int res = (int) size;
+  // Page program is short; read status continuously in one transaction
+  spi.acquire(this);
+    spi.begin();
+      spi.transfer(RDSR);
+      do m_status = spi.transfer(0); while (m_status.BUSY);
+    spi.end();
+  spi.release();
+  return (0);
+}
+
+int
+W25X40CL::program(uint32_t dest, const void* src, size_t size, bool progmem)
+{
+  // Wait for previous program
+  await();
 
-  // Calculate block size of first program
+  // Calculate block size of page program
   size_t count = PAGE_MAX - (dest & PAGE_MASK);
   if (count > size) count = size;
+  if (count == 0) return (0);
 
-  while (1) {
-    spi.acquire(this);
-      // Write enable before program
-      spi.begin();
-        spi.transfer(WREN);
-      spi.end();
-      // Use PP with 24-bit address; Big-endian
-      spi.begin();
-        spi.transfer(PP);
-	spi.transfer(dp[2]);
-	spi.transfer(dp[1]);
-	spi.transfer(dp[0]);
-	spi.write(sp, count);
-      spi.end();
-    spi.release();
-
-    // Wait for completion
-    while (!is_ready()) yield();
+  spi.acquire(this);
+    // Write enable before program
+    spi.begin();
+      spi.transfer(WREN);
+    spi.end();
+    // Use PP with 24-bit address; Big-endian
+    spi.begin();
+      command(PP, dest);
+      if (progmem)
+	spi.write_P(src, count);
+      else
+	spi.write(src, count);
+    spi.end();
+  spi.release();
 
-    // Step to next page
-    size -= count;
-    if (size == 0) break;
-    dest += count;
-    sp += count;
-    count = (size > PAGE_MAX ? PAGE_MAX : size);
-  }
+  // Return number of bytes in page program
+  return ((int) count);
+}
 
-  // Return number of bytes programmed
-  return (res);
+int
+W25X40CL::write(uint32_t dest, const void* src, size_t size)
+{
+  return (write(dest, src, size, false));
 }
 
 int
 W25X40CL::write_P(uint32_t dest, const void* src, size_t size)
 {
-  // Check for zero buffer size
-  if (size == 0) return (0);
+  return (write(dest, src, size, true));
+}
 
-  // Set up destination and source pointers
-  uint8_t* dp = (uint8_t*) &dest;
-  uint8_t* sp = (uint8_t*) src;
+int
+W25X40CL::write(uint32_t dest, const void* src, size_t size, bool progmem)
+{
+  // Pipeline page programs; status is polled before next page
+  const uint8_t* sp = (const uint8_t*) src;
   int res = (int) size;
-
-  // Calculate block size of first program
-  size_t count = PAGE_MAX - (dest & PAGE_MASK);
-  if (count > size) count = size;
-
-  while (1) {
-    spi.acquire(this);
-      // Write enable before program
-      spi.begin();
-        spi.transfer(WREN);
-      spi.end();
-      // Use PP with 24-bit address; Big-endian
-      spi.begin();
-        spi.transfer(PP);
-	spi.transfer(dp[2]);
-	spi.transfer(dp[1]);
-	spi.transfer(dp[0]);
-	spi.write_P(sp, count);
-      spi.end();
-    spi.release();
-
-    // Wait for completion
-    while (!is_ready()) yield();
-
-    // Step to next page
-    size -= count;
-    if (size == 0) break;
+  while (size != 0) {
+    int count = program(dest, sp, size, progmem);
+    if (count < 0) return (count);
     dest += count;
     sp += count;
-    count = (size > PAGE_MAX ? PAGE_MAX : size);
+    size -= count;
   }
 
-  // Return number of bytes programmed
+  // Wait for completion of the last page
+  await();
   return (res);
 }
 
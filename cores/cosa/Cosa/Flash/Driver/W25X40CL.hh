@@ -50,12 +50,16 @@ public:
 #if !defined(BOARD_ATTINY)
   W25X40CL(Board::DigitalPin csn = Board::D15) :
     Flash::Device(4 * 1024L, 128),
-    SPI::Driver(csn, SPI::ACTIVE_LOW, SPI::DIV2_CLOCK, 0, SPI::MSB_ORDER, NULL)
+    SPI::Driver(csn, SPI::ACTIVE_LOW, SPI::DIV2_CLOCK, 0, SPI::MSB_ORDER, NULL),
+    m_poller(this),
+    m_erasing(false)
   {}
 #else
   W25X40CL(Board::DigitalPin csn = Board::D3) :
     Flash::Device(4 * 1024L, 128),
-    SPI::Driver(csn, SPI::ACTIVE_LOW, SPI::DIV2_CLOCK, 0, SPI::MSB_ORDER, NULL)
+    SPI::Driver(csn, SPI::ACTIVE_LOW, SPI::DIV2_CLOCK, 0, SPI::MSB_ORDER, NULL),
+    m_poller(this),
+    m_erasing(false)
   {}
 #endif
 
@@ -124,6 +128,59 @@ public:
    */
   virtual int write_P(uint32_t dest, const void* buf, size_t size);
 
+  /**
+   * Start programming the page at given destination address with
+   * the contents of the source buffer in data or program memory. At
+   * most the remaining bytes of the page are programmed. Waits for
+   * any previous program to complete but returns without waiting for
+   * this page. The caller may prepare the next page during the page
+   * program time (tPP). Use await() to wait for completion. Return
+   * number of bytes programmed or negative error code.
+   * @param[in] dest address in flash to write to.
+   * @param[in] src buffer to write to flash.
+   * @param[in] size number of bytes to write.
+   * @param[in] progmem source in data(false) or program memory(true).
+   * @return number of bytes or negative error code.
+   */
+  int program(uint32_t dest, const void* src, size_t size,
+	      bool progmem = false);
+
+  /**
+   * Wait for program or erase to complete. The status register is
+   * read continuously in a single transaction while programming and
+   * polled with yield while erasing. Always returns zero(0); the
+   * device does not report program or erase errors.
+   * @return zero.
+   */
+  int await();
+
+  /**
+   * Start erase of given flash block for given byte address and
+   * return without waiting for completion. The target is notified
+   * with a completed event (Event::WRITE_COMPLETED_TYPE) when the
+   * erase is completed; polled on watchdog timeout (see
+   * Flash::Poller). The device does not support erase suspend; a
+   * read during an asynchronous erase will wait for completion.
+   * Returns zero(0) if successful otherwise an negative error code
+   * (EINVAL on illegal sector size).
+   * @param[in] dest destination block byte address to erase.
+   * @param[in] size of sector to erase in Kbyte (Default 4 KByte).
+   * @param[in] target event handler to notify (default none).
+   * @return zero or negative error code.
+   */
+  int erase_request(uint32_t dest, uint8_t size = 4,
+		    Event::Handler* target = NULL);
+
+  /**
+   * Return true(1) if an asynchronous erase is in progress otherwise
+   * false(0).
+   * @return bool.
+   */
+  bool is_erasing() const
+  {
+    return (m_erasing);
+  }
+
   /**
    * Status Register (S0) bitfields (Chap. 8.1 Status Register, pp. 11-12).
    */
@@ -197,6 +254,39 @@ protected:
 
   /** Latest status; is_ready() call */
   status_t m_status;
+  /**
+   * Write flash block at given destination address with the contents
+   * of the source buffer in data or program memory. Page programs are
+   * pipelined. Return number of bytes written or negative error code.
+   * @param[in] dest address in flash to write to.
+   * @param[in] src buffer to write to flash.
+   * @param[in] size number of bytes to write.
+   * @param[in] progmem source in data(false) or program memory(true).
+   * @return number of bytes or negative error code.
+   */
+  int write(uint32_t dest, const void* src, size_t size, bool progmem);
+
+  /** Erase completion poller */
+  Flash::Poller m_poller;
+
+  /** Asynchronous erase in progress */
+  bool m_erasing;
+
+  /**
+   * Issue command and 24-bit address. Should only be used within a
+   * SPI transaction; begin()-end() block.
+   * @param[in] op command code.
+   * @param[in] addr address.
+   */
+  void command(uint8_t op, uint32_t addr)
+    __attribute__((always_inline))
+  {
+    uint8_t* ap = (uint8_t*) &addr;
+    spi.transfer(op);
+    spi.transfer(ap[2]);
+    spi.transfer(ap[1]);
+    spi.transfer(ap[0]);
+  }
 };
 
 #endif
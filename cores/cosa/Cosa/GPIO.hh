@@ -0,0 +1,401 @@
+/**
+ * @file Cosa/GPIO.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_GPIO_HH
+#define COSA_GPIO_HH
+
+#include "Cosa/Types.h"
+#include "Cosa/Pin.hh"
+
+/**
+ * General Purpose IO pin with the Arduino pin number as template
+ * parameter. The port registers and pin mask are compile-time
+ * constants (the board mapping functions are reduced by the
+ * compiler) and set(), clear(), toggle() and is_set() are reduced
+ * to single instructions (sbi, cbi, out and sbis/sbic). Ports outside
+ * the bit addressable I/O space (e.g. PORTH-PORTL on ATmega2560) are
+ * updated with interrupts disabled. An instance holds no state.
+ * @code
+ * GPIO<Board::LED> led(GPIO<Board::LED>::OUTPUT_MODE);
+ * ...
+ * led.toggle();
+ * @endcode
+ * @param[in] PIN Arduino pin number.
+ */
+template<Board::DigitalPin PIN>
+class GPIO {
+public:
+  /** Pin modes. */
+  enum Mode {
+    OUTPUT_MODE = 0,		//!< Output pin.
+    INPUT_MODE = 1,		//!< Input pin.
+    PULLUP_MODE = 2		//!< Input pin with internal pullup.
+  } __attribute__((packed));
+
+  /**
+   * Construct general purpose pin without changing the pin mode.
+   */
+  GPIO() {}
+
+  /**
+   * Construct general purpose pin with given mode and initial
+   * output value.
+   * @param[in] mode pin mode.
+   * @param[in] initial value (default 0).
+   */
+  GPIO(Mode mode, bool initial = false)
+  {
+    if (mode == OUTPUT_MODE) write(initial);
+    set_mode(mode);
+  }
+
+  /**
+   * Set pin mode.
+   * @param[in] mode pin mode.
+   */
+  static void set_mode(Mode mode)
+    __attribute__((always_inline))
+  {
+    synchronized {
+      if (mode == OUTPUT_MODE) {
+	*Pin::DDR(PIN) |= Pin::MASK(PIN);
+      }
+      else {
+	*Pin::DDR(PIN) &= ~Pin::MASK(PIN);
+	if (mode == PULLUP_MODE)
+	  *Pin::PORT(PIN) |= Pin::MASK(PIN);
+	else
+	  *Pin::PORT(PIN) &= ~Pin::MASK(PIN);
+      }
+    }
+  }
+
+  /**
+   * Get pin mode.
+   * @return mode.
+   */
+  static Mode get_mode()
+    __attribute__((always_inline))
+  {
+    if ((*Pin::DDR(PIN) & Pin::MASK(PIN)) != 0) return (OUTPUT_MODE);
+    if ((*Pin::PORT(PIN) & Pin::MASK(PIN)) != 0) return (PULLUP_MODE);
+    return (INPUT_MODE);
+  }
+
+  /**
+   * Return true(1) if the port register is bit addressable and
+   * updates are atomic (sbi/cbi) otherwise false(0).
+   * @return bool.
+   */
+  static bool is_atomic()
+    __attribute__((always_inline))
+  {
+    return (Pin::PORT(PIN) < (volatile uint8_t*) 0x40);
+  }
+
+  /**
+   * Set the output pin.
+   */
+  static void set()
+    __attribute__((always_inline))
+  {
+    if (is_atomic()) {
+      *Pin::PORT(PIN) |= Pin::MASK(PIN);
+    }
+    else {
+      synchronized *Pin::PORT(PIN) |= Pin::MASK(PIN);
+    }
+  }
+
+  /**
+   * Clear the output pin.
+   */
+  static void clear()
+    __attribute__((always_inline))
+  {
+    if (is_atomic()) {
+      *Pin::PORT(PIN) &= ~Pin::MASK(PIN);
+    }
+    else {
+      synchronized *Pin::PORT(PIN) &= ~Pin::MASK(PIN);
+    }
+  }
+
+  /**
+   * Toggle the output pin. Writing the mask to the PIN register
+   * toggles the pin in a single operation.
+   */
+  static void toggle()
+    __attribute__((always_inline))
+  {
+    *Pin::PIN(PIN) = Pin::MASK(PIN);
+  }
+
+  /**
+   * Set the output pin with the given value. Zero(0) to clear
+   * and non-zero to set.
+   * @param[in] value to write.
+   */
+  static void write(bool value)
+    __attribute__((always_inline))
+  {
+    if (value) set(); else clear();
+  }
+
+  /**
+   * Return true(1) if the pin is set otherwise false(0).
+   * @return bool.
+   */
+  static bool is_set()
+    __attribute__((always_inline))
+  {
+    return ((*Pin::PIN(PIN) & Pin::MASK(PIN)) != 0);
+  }
+
+  /**
+   * Return true(1) if the pin is clear otherwise false(0).
+   * @return bool.
+   */
+  static bool is_clear()
+    __attribute__((always_inline))
+  {
+    return ((*Pin::PIN(PIN) & Pin::MASK(PIN)) == 0);
+  }
+
+  /**
+   * Return pin value; true(1) if set otherwise false(0).
+   * @return bool.
+   */
+  static bool read()
+    __attribute__((always_inline))
+  {
+    return (is_set());
+  }
+
+  /**
+   * Toggle the output pin to form a pulse with given length in
+   * micro-seconds.
+   * @param[in] us pulse width in micro seconds.
+   */
+  static void pulse(uint16_t us)
+    __attribute__((always_inline))
+  {
+    toggle();
+    DELAY(us);
+    toggle();
+  }
+};
+
+/**
+ * Group of pins on the same port with the Arduino pin numbers as
+ * template parameters. The group is written with a single port
+ * read-modify-write; the bits of the value are mapped to the pins in
+ * the given order (bit 0 to the first pin). All pins must belong to
+ * the same port (the port of the first pin is used). An instance
+ * holds no state.
+ * @code
+ * PortGroup<Board::D4, Board::D5, Board::D6, Board::D7> nibble;
+ * nibble.set_mode(nibble.OUTPUT_MODE);
+ * nibble.write(0x0a);
+ * @endcode
+ * @param[in] PINS Arduino pin numbers.
+ */
+template<Board::DigitalPin... PINS>
+class PortGroup;
+
+/**
+ * Empty port group; terminates the pin list.
+ */
+template<>
+class PortGroup<> {
+public:
+  /**
+   * Return port mask for the pins in the group.
+   * @return mask.
+   */
+  static uint8_t MASK()
+    __attribute__((always_inline))
+  {
+    return (0);
+  }
+
+  /**
+   * Map the given value to port bits.
+   * @param[in] value to map.
+   * @return port bits.
+   */
+  static uint8_t bits(uint8_t value)
+    __attribute__((always_inline))
+  {
+    UNUSED(value);
+    return (0);
+  }
+
+  /**
+   * Map the given port bits to value.
+   * @param[in] port bits to map.
+   * @return value.
+   */
+  static uint8_t value(uint8_t port)
+    __attribute__((always_inline))
+  {
+    UNUSED(port);
+    return (0);
+  }
+};
+
+template<Board::DigitalPin PIN, Board::DigitalPin... PINS>
+class PortGroup<PIN, PINS...> {
+public:
+  /** Pin modes. */
+  enum Mode {
+    OUTPUT_MODE = 0,		//!< Output pins.
+    INPUT_MODE = 1,		//!< Input pins.
+    PULLUP_MODE = 2		//!< Input pins with internal pullup.
+  } __attribute__((packed));
+
+  /**
+   * Construct port group without changing the pin mode.
+   */
+  PortGroup() {}
+
+  /**
+   * Construct port group with given mode and initial output value.
+   * @param[in] mode pin mode.
+   * @param[in] initial value (default 0).
+   */
+  PortGroup(Mode mode, uint8_t initial = 0)
+  {
+    if (mode == OUTPUT_MODE) write(initial);
+    set_mode(mode);
+  }
+
+  /**
+   * Return port mask for the pins in the group.
+   * @return mask.
+   */
+  static uint8_t MASK()
+    __attribute__((always_inline))
+  {
+    return (Pin::MASK(PIN) | PortGroup<PINS...>::MASK());
+  }
+
+  /**
+   * Map the given value to port bits; bit 0 to the first pin.
+   * @param[in] value to map.
+   * @return port bits.
+   */
+  static uint8_t bits(uint8_t value)
+    __attribute__((always_inline))
+  {
+    return (((value & 1) ? Pin::MASK(PIN) : 0)
+	    | PortGroup<PINS...>::bits(value >> 1));
+  }
+
+  /**
+   * Map the given port bits to value; first pin to bit 0.
+   * @param[in] port bits to map.
+   * @return value.
+   */
+  static uint8_t value(uint8_t port)
+    __attribute__((always_inline))
+  {
+    return (((port & Pin::MASK(PIN)) ? 1 : 0)
+	    | (PortGroup<PINS...>::value(port) << 1));
+  }
+
+  /**
+   * Set mode of all pins in the group.
+   * @param[in] mode pin mode.
+   */
+  static void set_mode(Mode mode)
+    __attribute__((always_inline))
+  {
+    synchronized {
+      if (mode == OUTPUT_MODE) {
+	*Pin::DDR(PIN) |= MASK();
+      }
+      else {
+	*Pin::DDR(PIN) &= ~MASK();
+	if (mode == PULLUP_MODE)
+	  *Pin::PORT(PIN) |= MASK();
+	else
+	  *Pin::PORT(PIN) &= ~MASK();
+      }
+    }
+  }
+
+  /**
+   * Write the given value to the pins in the group; bit 0 to the
+   * first pin. Single port read-modify-write.
+   * @param[in] value to write.
+   */
+  static void write(uint8_t value)
+    __attribute__((always_inline))
+  {
+    uint8_t port = bits(value);
+    synchronized {
+      *Pin::PORT(PIN) = (*Pin::PORT(PIN) & ~MASK()) | port;
+    }
+  }
+
+  /**
+   * Set all pins in the group.
+   */
+  static void set()
+    __attribute__((always_inline))
+  {
+    synchronized {
+      *Pin::PORT(PIN) |= MASK();
+    }
+  }
+
+  /**
+   * Clear all pins in the group.
+   */
+  static void clear()
+    __attribute__((always_inline))
+  {
+    synchronized {
+      *Pin::PORT(PIN) &= ~MASK();
+    }
+  }
+
+  /**
+   * Toggle all pins in the group. Single write to the PIN register.
+   */
+  static void toggle()
+    __attribute__((always_inline))
+  {
+    *Pin::PIN(PIN) = MASK();
+  }
+
+  /**
+   * Read the pins in the group; first pin to bit 0.
+   * @return value.
+   */
+  static uint8_t read()
+    __attribute__((always_inline))
+  {
+    return (value(*Pin::PIN(PIN)));
+  }
+};
+
+#endif
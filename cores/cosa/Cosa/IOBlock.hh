@@ -0,0 +1,139 @@
+/**
+ * @file Cosa/IOBlock.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_IOBLOCK_HH
+#define COSA_IOBLOCK_HH
+
+#include "Cosa/Types.h"
+
+/**
+ * Block device interface. Fixed size blocks (BLOCK_MAX) addressed
+ * with block number. Used by file systems (FAT16) to access the
+ * storage device (SD).
+ */
+class IOBlock {
+public:
+  /** Size of block in bytes. */
+  static const size_t BLOCK_MAX = 512;
+
+  /**
+   * Cosa block device driver interface.
+   */
+  class Device {
+  public:
+    /**
+     * @override IOBlock::Device
+     * Read given block into given destination buffer. The buffer must
+     * be able to hold BLOCK_MAX bytes. Returns true if successful
+     * otherwise false.
+     * @param[in] block address.
+     * @param[in] dst pointer to destination buffer.
+     * @return bool.
+     */
+    virtual bool read(uint32_t block, uint8_t* dst) = 0;
+
+    /**
+     * @override IOBlock::Device
+     * Write given source buffer with BLOCK_MAX bytes to the given
+     * block. Returns true if successful otherwise false.
+     * @param[in] block address.
+     * @param[in] src pointer to source buffer.
+     * @return bool.
+     */
+    virtual bool write(uint32_t block, const uint8_t* src) = 0;
+
+    /**
+     * @override IOBlock::Device
+     * Erase given block interval from start to end. Returns true if
+     * successful otherwise false.
+     * @param[in] start block address.
+     * @param[in] end block address.
+     * @return bool.
+     */
+    virtual bool erase(uint32_t start, uint32_t end) = 0;
+  };
+
+  /**
+   * Block device wrapper with operation counters. Forwards all
+   * operations to the given device and counts number of operations
+   * and bytes. Used to measure device operations per file system
+   * operation.
+   */
+  class Counter : public Device {
+  public:
+    /**
+     * Construct counting block device for given device.
+     * @param[in] dev block device.
+     */
+    Counter(Device* dev) : m_dev(dev)
+    {
+      reset();
+    }
+
+    /**
+     * Reset counters.
+     */
+    void reset()
+    {
+      reads = 0L;
+      writes = 0L;
+      erases = 0L;
+    }
+
+    /**
+     * @override IOBlock::Device
+     * Count and forward block read.
+     */
+    virtual bool read(uint32_t block, uint8_t* dst)
+    {
+      reads += 1;
+      return (m_dev->read(block, dst));
+    }
+
+    /**
+     * @override IOBlock::Device
+     * Count and forward block write.
+     */
+    virtual bool write(uint32_t block, const uint8_t* src)
+    {
+      writes += 1;
+      return (m_dev->write(block, src));
+    }
+
+    /**
+     * @override IOBlock::Device
+     * Count and forward block erase.
+     */
+    virtual bool erase(uint32_t start, uint32_t end)
+    {
+      erases += (end - start) + 1;
+      return (m_dev->erase(start, end));
+    }
+
+    uint32_t reads;		//!< Number of block reads.
+    uint32_t writes;		//!< Number of block writes.
+    uint32_t erases;		//!< Number of blocks erased.
+
+  protected:
+    Device* m_dev;		//!< Block device.
+  };
+};
+
+#endif
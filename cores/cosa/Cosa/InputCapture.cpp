@@ -0,0 +1,122 @@
+/**
+ * @file Cosa/InputCapture.cpp
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/InputCapture.hh"
+
+#if !defined(BOARD_ATTINY)
+
+InputCapture* InputCapture::s_capture = NULL;
+
+bool
+InputCapture::begin()
+{
+  synchronized {
+    if (s_capture != NULL) synchronized_return (false);
+    s_capture = this;
+
+    // Reset ring buffer and timestamp high word
+    m_head = 0;
+    m_tail = 0;
+    m_overflow = 0;
+    m_overruns = 0;
+
+    // Timer1 in normal mode; capture and overflow interrupts
+    TCCR1A = 0;
+    TCCR1B = 0;
+    TCNT1 = 0;
+    TIFR1 = _BV(ICF1) | _BV(TOV1);
+    TIMSK1 = _BV(ICIE1) | _BV(TOIE1);
+    TCCR1B = (m_filter ? _BV(ICNC1) : 0)
+      | (m_mode == ON_FALLING_MODE ? 0 : _BV(ICES1))
+      | m_prescale;
+  }
+  return (true);
+}
+
+void
+InputCapture::end()
+{
+  synchronized {
+    TCCR1B = 0;
+    TIMSK1 = 0;
+    if (s_capture == this) s_capture = NULL;
+  }
+}
+
+bool
+InputCapture::read(edge_t& edge)
+{
+  uint8_t tail = m_tail;
+  if (tail == m_head) return (false);
+  edge = m_buffer[tail];
+  m_tail = (tail + 1) & m_mask;
+  return (true);
+}
+
+uint32_t
+InputCapture::time() const
+{
+  uint16_t low;
+  uint16_t high;
+  synchronized {
+    low = TCNT1;
+    high = m_overflow;
+    if ((TIFR1 & _BV(TOV1)) && (low < 0x8000)) high += 1;
+  }
+  return (((uint32_t) high << 16) | low);
+}
+
+ISR(TIMER1_CAPT_vect)
+{
+  // Latched timer value and edge; check for pending overflow
+  uint16_t low = ICR1;
+  uint8_t rising = TCCR1B & _BV(ICES1);
+  InputCapture* capture = InputCapture::s_capture;
+  if (UNLIKELY(capture == NULL)) return;
+  uint16_t high = capture->m_overflow;
+  if ((TIFR1 & _BV(TOV1)) && (low < 0x8000)) high += 1;
+
+  // Capture the other edge next; clear the capture flag after change
+  if (capture->m_mode == InputCapture::ON_CHANGE_MODE) {
+    TCCR1B ^= _BV(ICES1);
+    TIFR1 = _BV(ICF1);
+  }
+
+  // Store the edge if there is room in the ring buffer
+  uint8_t head = capture->m_head;
+  uint8_t next = (head + 1) & capture->m_mask;
+  if (UNLIKELY(next == capture->m_tail)) {
+    capture->m_overruns += 1;
+    return;
+  }
+  InputCapture::edge_t* edge = &capture->m_buffer[head];
+  edge->time = ((uint32_t) high << 16) | low;
+  edge->level = (rising != 0);
+  capture->m_head = next;
+}
+
+ISR(TIMER1_OVF_vect)
+{
+  InputCapture* capture = InputCapture::s_capture;
+  if (UNLIKELY(capture == NULL)) return;
+  capture->m_overflow += 1;
+}
+
+#endif
@@ -0,0 +1,178 @@
+/**
+ * @file Cosa/InputCapture.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_INPUT_CAPTURE_HH
+#define COSA_INPUT_CAPTURE_HH
+
+#include "Cosa/Types.h"
+#include "Cosa/Board.hh"
+
+/**
+ * Timestamped edge capture with Timer1 input capture unit (ICP1).
+ * The timer counter value is latched by hardware on the edge and
+ * extended to 32-bit with the timer overflow count. Edges are stored
+ * as (time, level) pairs in a ring buffer by the interrupt handler
+ * and consumed by decoders from the main loop. The timestamp
+ * resolution is the timer clock; 62.5 ns with 16 MHz and prescale 1.
+ * @code
+ * InputCapture::edge_t buffer[16];
+ * InputCapture capture(buffer, membersof(buffer));
+ * ...
+ * capture.begin();
+ * ...
+ * InputCapture::edge_t edge;
+ * while (capture.read(edge)) ...
+ * @endcode
+ *
+ * @section Circuit
+ * The signal should be connected to the ICP1 pin; Arduino Uno/Nano/
+ * Pro Mini D8 (PB0), Arduino Leonardo/Micro D4 (PD4). The ICP1 pin
+ * (PD4) is not available on the Arduino Mega headers.
+ *
+ * @section Limitations
+ * Uses Timer1 and may not be used together with other modules that
+ * use Timer1 (e.g. Servo, Tone, VWI and AnalogSampler). Not available
+ * on ATtiny. Pulses shorter than the interrupt handler time cannot
+ * be captured on both edges.
+ */
+class InputCapture {
+public:
+  /** Captured edge. */
+  struct edge_t {
+    uint32_t time;		//!< Timestamp (timer ticks).
+    bool level;			//!< Pin level after the edge.
+  } __attribute__((packed));
+
+  /** Edges to capture. */
+  enum Mode {
+    ON_FALLING_MODE = 0,	//!< Falling edges.
+    ON_RISING_MODE = 1,		//!< Rising edges.
+    ON_CHANGE_MODE = 2		//!< Both edges.
+  } __attribute__((packed));
+
+  /** Timer clock prescale. */
+  enum Prescale {
+    PRESCALE_1 = 1,		//!< 62.5 ns per tick (16 MHz).
+    PRESCALE_8 = 2,		//!< 0.5 us per tick (16 MHz).
+    PRESCALE_64 = 3,		//!< 4 us per tick (16 MHz).
+    PRESCALE_256 = 4,		//!< 16 us per tick (16 MHz).
+    PRESCALE_1024 = 5		//!< 64 us per tick (16 MHz).
+  } __attribute__((packed));
+
+  /**
+   * Construct input capture with given ring buffer and size, edge
+   * mode, timer prescale and noise canceler. The ring buffer size
+   * must be a power of two (max 128).
+   * @param[in] buffer ring buffer for edges.
+   * @param[in] size of ring buffer (power of two).
+   * @param[in] mode edges to capture (default ON_CHANGE_MODE).
+   * @param[in] prescale timer clock prescale (default PRESCALE_1).
+   * @param[in] filter enable noise canceler (default false).
+   */
+  InputCapture(edge_t* buffer, uint8_t size,
+	       Mode mode = ON_CHANGE_MODE,
+	       Prescale prescale = PRESCALE_1,
+	       bool filter = false) :
+    m_buffer(buffer),
+    m_mask(size - 1),
+    m_head(0),
+    m_tail(0),
+    m_mode(mode),
+    m_prescale(prescale),
+    m_filter(filter),
+    m_overflow(0),
+    m_overruns(0)
+  {
+  }
+
+  /**
+   * Start capture. Resets the ring buffer and timer. Returns
+   * true(1) if successful otherwise false(0); another instance is
+   * active.
+   * @return bool.
+   */
+  bool begin();
+
+  /**
+   * Stop capture.
+   */
+  void end();
+
+  /**
+   * Return number of edges available in the ring buffer.
+   * @return number of edges.
+   */
+  uint8_t available() const
+  {
+    return ((m_head - m_tail) & m_mask);
+  }
+
+  /**
+   * Read next edge from the ring buffer. Returns true(1) if an edge
+   * was read otherwise false(0).
+   * @param[out] edge captured edge.
+   * @return bool.
+   */
+  bool read(edge_t& edge);
+
+  /**
+   * Return number of edges dropped due to full ring buffer.
+   * @return number of overruns.
+   */
+  uint16_t get_overruns() const
+  {
+    return (m_overruns);
+  }
+
+  /**
+   * Return current timestamp (timer ticks).
+   * @return ticks.
+   */
+  uint32_t time() const;
+
+  /**
+   * Convert given number of timer ticks to micro-seconds.
+   * @param[in] ticks number of timer ticks.
+   * @return micro-seconds.
+   */
+  uint32_t us(uint32_t ticks) const
+  {
+    static const uint8_t shift[] = { 0, 0, 3, 6, 8, 10 };
+    return ((ticks << shift[m_prescale]) / I_CPU);
+  }
+
+private:
+  static InputCapture* s_capture; //!< Active input capture.
+  edge_t* m_buffer;		//!< Edge ring buffer.
+  const uint8_t m_mask;		//!< Ring buffer index mask.
+  volatile uint8_t m_head;	//!< Ring buffer head (interrupt).
+  volatile uint8_t m_tail;	//!< Ring buffer tail (reader).
+  const Mode m_mode;		//!< Edges to capture.
+  const Prescale m_prescale;	//!< Timer clock prescale.
+  const bool m_filter;		//!< Noise canceler.
+  volatile uint16_t m_overflow;	//!< Timer overflow count (high word).
+  volatile uint16_t m_overruns;	//!< Dropped edges.
+
+  /** Interrupt Service Routines are friends. */
+  friend void TIMER1_CAPT_vect(void);
+  friend void TIMER1_OVF_vect(void);
+};
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * @file Cosa/InterruptButton.cpp
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/InterruptButton.hh"
+
+void
+InterruptButton::begin()
+{
+  synchronized {
+    m_state = is_set();
+    m_armed = true;
+    enable();
+  }
+}
+
+void
+InterruptButton::end()
+{
+  bool active;
+  synchronized {
+    active = m_sampling;
+    m_sampling = false;
+    m_armed = false;
+    disable();
+    detach();
+  }
+  if (active) Watchdog::release();
+}
+
+void
+InterruptButton::on_interrupt(uint16_t arg)
+{
+  UNUSED(arg);
+
+  // Disarm and start sampling with watchdog timeout events
+  if (!m_armed) return;
+  m_armed = false;
+  m_sampling = true;
+  disable();
+  m_stable = 0;
+  Watchdog::acquire(SAMPLE_MS);
+  Watchdog::attach(this, SAMPLE_MS);
+}
+
+void
+InterruptButton::on_event(uint8_t type, uint16_t value)
+{
+  UNUSED(value);
+
+  // Skip all but timeout events
+  if (type != Event::TIMEOUT_TYPE) return;
+
+  // Update the button state
+  uint8_t old_state = m_state;
+  m_state = is_set();
+  uint8_t new_state = m_state;
+
+  // If changed according to mode call the pin change handler
+  if (old_state != new_state) {
+    m_stable = 0;
+    if ((MODE == ON_CHANGE_MODE) || (new_state == MODE))
+      on_change(Event::FALLING_TYPE + MODE);
+    return;
+  }
+
+  // Arm the pin change interrupt when stable. The pin is checked
+  // with interrupts disabled so that no change is lost
+  if (++m_stable < STABLE_COUNT) return;
+  bool armed = false;
+  synchronized {
+    if (is_set() == m_state) {
+      detach();
+      m_sampling = false;
+      m_armed = true;
+      enable();
+      armed = true;
+    }
+  }
+  if (armed) Watchdog::release();
+}
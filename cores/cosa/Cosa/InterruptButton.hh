@@ -0,0 +1,149 @@
+/**
+ * @file Cosa/InterruptButton.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_INTERRUPT_BUTTON_HH
+#define COSA_INTERRUPT_BUTTON_HH
+
+#include "Cosa/Types.h"
+#include "Cosa/PinChangeInterrupt.hh"
+#include "Cosa/Linkage.hh"
+#include "Cosa/Watchdog.hh"
+
+/**
+ * Debounced interrupt driven Button. While idle the button is armed
+ * with a pin change interrupt and does not require any periodic
+ * sampling; the processor may sleep until the button is pressed.
+ * On a change the interrupt is disarmed and the button is sampled
+ * with watchdog timeout events (SAMPLE_MS) until the state has been
+ * stable for STABLE_COUNT samples. The watchdog is started on demand
+ * (Watchdog::acquire()) if not running and stopped after the burst.
+ * Subclass and implement the virtual on_change() method; same as
+ * Button. Connect button/switch from pin to ground. Internal pull-up
+ * resistor is activated.
+ *
+ * @section Limitations
+ * Requires PinChangeInterrupt::begin(). If the watchdog is already
+ * running it should have a period of SAMPLE_MS or less and either
+ * no interrupt handler (timeout events are then installed) or
+ * timeout events.
+ *
+ * @section See Also
+ * Button for the periodically sampled version. The button event
+ * handler requires the usage of an event dispatch. See Event.hh.
+ */
+class InterruptButton : public PinChangeInterrupt, private Link {
+public:
+  /**
+   * Button change detection modes; falling (high to low), rising (low
+   * to high) and change (falling or rising).
+   */
+  enum Mode {
+    ON_FALLING_MODE = 0,	//!< High to low transition.
+    ON_RISING_MODE = 1,		//!< Low to high transition.
+    ON_CHANGE_MODE = 2		//!< Any transition.
+  } __attribute__((packed));
+
+  /**
+   * Construct an interrupt driven button connected to the given pin
+   * and with the given change detection mode.
+   * @param[in] pin number.
+   * @param[in] mode change detection mode.
+   */
+  InterruptButton(Board::InterruptPin pin, Mode mode = ON_CHANGE_MODE) :
+    PinChangeInterrupt(pin, true),
+    Link(),
+    MODE(mode),
+    m_state(is_set()),
+    m_armed(false),
+    m_sampling(false),
+    m_stable(0)
+  {}
+
+  /**
+   * Start the button handler; arm the pin change interrupt.
+   */
+  void begin();
+
+  /**
+   * Stop the button handler.
+   */
+  void end();
+
+  /**
+   * Return true(1) if the button is idle and armed otherwise false(0).
+   * @return bool.
+   */
+  bool is_idle() const
+  {
+    return (m_armed);
+  }
+
+  /**
+   * @override InterruptButton
+   * The button change event handler. Called when a change
+   * corresponding to the mode has been detected. Event types are;
+   * Event::FALLING_TYPE, Event::RISING_TYPE, and Event::CHANGE_TYPE.
+   * Sub-class must override this method.
+   * @param[in] type event type.
+   */
+  virtual void on_change(uint8_t type) = 0;
+
+protected:
+  /** Button sampling period in milli-seconds (during activity). */
+  static const uint16_t SAMPLE_MS = 16;
+
+  /** Number of stable samples before the button is armed. */
+  static const uint8_t STABLE_COUNT = 4;
+
+  /** Change detection mode. */
+  const Mode MODE;
+
+  /** Current state. */
+  uint8_t m_state;
+
+  /** Pin change interrupt armed. */
+  volatile bool m_armed;
+
+  /** Sampling with watchdog timeout events. */
+  volatile bool m_sampling;
+
+  /** Number of stable samples. */
+  uint8_t m_stable;
+
+  /**
+   * @override Interrupt::Handler
+   * Pin change interrupt handler. Disarm the interrupt and start
+   * sampling.
+   * @param[in] arg argument from interrupt service routine.
+   */
+  virtual void on_interrupt(uint16_t arg);
+
+  /**
+   * @override Event::Handler
+   * Button event handler. Called by event dispatch. Samples the pin
+   * and calls the pin change handler, on_change(). Arms the pin
+   * change interrupt when stable.
+   * @param[in] type the type of event (timeout).
+   * @param[in] value the event value.
+   */
+  virtual void on_event(uint8_t type, uint16_t value);
+};
+
+#endif
@@ -0,0 +1,205 @@
+/**
+ * @file Cosa/KVS.cpp
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/KVS.hh"
+#include <util/crc16.h>
+
+KVS* KVS::s_eeprom = NULL;
+
+uint8_t
+KVS::crc(const record_t* rec)
+{
+  const uint8_t* bp = (const uint8_t*) rec;
+  uint8_t res = 0;
+  for (uint8_t i = 0; i < sizeof(record_t) - 1; i++)
+    res = _crc_ibutton_update(res, *bp++);
+  return (res);
+}
+
+bool
+KVS::load(uint8_t slot, record_t* rec)
+{
+  int res;
+
+  // Block the interrupt handler while reading the internal eeprom
+  if (m_dev == &EEPROM::Device::eeprom) {
+    synchronized bit_clear(EECR, EERIE);
+    while (!m_dev->is_ready()) yield();
+    res = m_dev->read(rec, address(slot), sizeof(record_t));
+    synchronized if (m_count != 0) bit_set(EECR, EERIE);
+  }
+  else {
+    res = m_dev->read(rec, address(slot), sizeof(record_t));
+  }
+  if (res != sizeof(record_t)) return (false);
+
+  // Check that the record is valid
+  if (rec->key >= KEY_MAX || rec->size > VALUE_MAX) return (false);
+  return (rec->crc == crc(rec));
+}
+
+int
+KVS::begin()
+{
+  if (m_slots <= KEY_MAX) return (EINVAL);
+  if (m_dev == &EEPROM::Device::eeprom) {
+    if (s_eeprom != NULL && s_eeprom != this) return (EBUSY);
+    s_eeprom = this;
+  }
+
+  // Scan slots for latest record per key and latest sequence number
+  uint32_t seq[KEY_MAX];
+  memset(m_index, NONE, sizeof(m_index));
+  m_tail = 0;
+  m_seq = 0;
+  int res = 0;
+  for (uint8_t slot = 0; slot < m_slots; slot++) {
+    record_t rec;
+    if (!load(slot, &rec)) continue;
+    uint8_t key = rec.key;
+    if (m_index[key] == NONE) res += 1;
+    else if (rec.seq < seq[key]) continue;
+    m_index[key] = slot;
+    seq[key] = rec.seq;
+    if (rec.seq < m_seq) continue;
+    m_seq = rec.seq + 1;
+    m_tail = (slot + 1 == m_slots ? 0 : slot + 1);
+  }
+  return (res);
+}
+
+uint8_t
+KVS::next_slot()
+{
+  for (uint8_t i = 0; i < m_slots; i++) {
+    uint8_t slot = m_tail;
+    if (++m_tail == m_slots) m_tail = 0;
+    uint8_t key = 0;
+    while (key < KEY_MAX && m_index[key] != slot) key++;
+    if (key == KEY_MAX) return (slot);
+  }
+  return (NONE);
+}
+
+int
+KVS::read(uint8_t key, void* buf, size_t size)
+{
+  if (key >= KEY_MAX) return (EINVAL);
+
+  // Check the queue for a record not yet committed; latest first
+  synchronized {
+    uint8_t ix = m_put;
+    for (uint8_t n = m_count; n != 0; n--) {
+      ix = (ix - 1) & QUEUE_MASK;
+      record_t* rec = &m_queue[ix];
+      if (rec->key != key) continue;
+      if (size > rec->size) size = rec->size;
+      memcpy(buf, rec->value, size);
+      synchronized_return (size);
+    }
+  }
+
+  // Read the latest record from eeprom
+  uint8_t slot = m_index[key];
+  if (slot == NONE) return (ENOENT);
+  record_t rec;
+  if (!load(slot, &rec)) return (EIO);
+  if (size > rec.size) size = rec.size;
+  memcpy(buf, rec.value, size);
+  return (size);
+}
+
+int
+KVS::write(uint8_t key, const void* buf, size_t size)
+{
+  if (key >= KEY_MAX || size > VALUE_MAX) return (EINVAL);
+
+  // Skip the write if the value is unchanged
+  uint8_t value[VALUE_MAX];
+  if ((read(key, value, sizeof(value)) == (int) size)
+      && !memcmp(value, buf, size))
+    return (size);
+
+  // Wait for room in the queue
+  while (m_count == QUEUE_MAX) yield();
+
+  // Allocate a slot and build the record
+  uint8_t slot = next_slot();
+  if (slot == NONE) return (ENOSPC);
+  record_t* rec = &m_queue[m_put];
+  rec->key = key;
+  rec->size = size;
+  rec->seq = m_seq++;
+  memset(rec->value, 0xff, sizeof(rec->value));
+  memcpy(rec->value, buf, size);
+  rec->crc = crc(rec);
+
+  // Write directly to external devices
+  if (m_dev != &EEPROM::Device::eeprom) {
+    int res = m_dev->write(address(slot), rec, sizeof(record_t));
+    if (res != sizeof(record_t)) return (res < 0 ? res : EIO);
+    m_index[key] = slot;
+    return (size);
+  }
+
+  // Queue the record and enable the eeprom ready interrupt handler
+  m_index[key] = slot;
+  m_target[m_put] = slot;
+  m_put = (m_put + 1) & QUEUE_MASK;
+  synchronized {
+    m_count += 1;
+    bit_set(EECR, EERIE);
+  }
+  return (size);
+}
+
+void
+KVS::on_ready()
+{
+  // Disable the interrupt when the queue is empty
+  if (m_count == 0) {
+    bit_clear(EECR, EERIE);
+    return;
+  }
+
+  // Write the next byte of the record if changed
+  uint8_t ix = m_get;
+  uint16_t addr = (uint16_t) address(m_target[ix]) + m_offset;
+  uint8_t data = ((const uint8_t*) &m_queue[ix])[m_offset];
+  EEAR = addr;
+  bit_set(EECR, EERE);
+  if (EEDR != data) {
+    EEDR = data;
+    bit_set(EECR, EEMPE);
+    bit_set(EECR, EEPE);
+  }
+
+  // Step to the next record when completed
+  if (++m_offset < sizeof(record_t)) return;
+  m_offset = 0;
+  m_get = (ix + 1) & QUEUE_MASK;
+  m_count -= 1;
+}
+
+ISR(EE_READY_vect)
+{
+  if (KVS::s_eeprom != NULL) KVS::s_eeprom->on_ready();
+  else bit_clear(EECR, EERIE);
+}
@@ -0,0 +1,268 @@
+/**
+ * @file Cosa/KVS.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_KVS_HH
+#define COSA_KVS_HH
+
+#include "Cosa/Types.h"
+#include "Cosa/EEPROM.hh"
+
+/**
+ * Log-structured Key/Value Store on EEPROM::Device. Values are
+ * appended as records to a region of EEPROM slots in round-robin
+ * order instead of being written to fixed addresses. Each record
+ * contains key, value size, sequence number, value and CRC. The
+ * latest value of each key is found through a RAM index that is
+ * built by begin(). Slots holding the latest value of a key are
+ * skipped when appending so that a value is never overwritten
+ * before a newer record has been committed.
+ *
+ * On the internal EEPROM records are queued and committed byte by
+ * byte by the EEPROM ready interrupt handler; write() returns
+ * directly. Other devices, such as AT24CXX, are written directly.
+ *
+ * @section Limitations
+ * Only one store instance may use the internal EEPROM. Other access
+ * to the internal EEPROM must not be performed while records are
+ * being committed; use await() or is_committed().
+ */
+class KVS {
+public:
+  /** Max number of keys (0..KEY_MAX-1). */
+  static const uint8_t KEY_MAX = 16;
+
+  /** Max number of bytes in value. */
+  static const uint8_t VALUE_MAX = 9;
+
+  /** Max number of queued records. Must be power of 2. */
+  static const uint8_t QUEUE_MAX = 4;
+
+  /**
+   * Construct key/value store on given device and region. The
+   * region must hold more slots than keys used.
+   * @param[in] dev eeprom device.
+   * @param[in] addr start address of region in eeprom.
+   * @param[in] size number of bytes in region.
+   */
+  KVS(EEPROM::Device* dev, void* addr, size_t size) :
+    m_dev(dev),
+    m_addr((uint8_t*) addr),
+    m_slots(size / sizeof(record_t) < NONE ?
+	    size / sizeof(record_t) :
+	    NONE),
+    m_tail(0),
+    m_seq(0),
+    m_put(0),
+    m_get(0),
+    m_count(0),
+    m_offset(0)
+  {}
+
+  /**
+   * Scan the region and build the RAM index. Return number of keys
+   * found or negative error code.
+   * @return number of keys or negative error code.
+   */
+  int begin();
+
+  /**
+   * Read latest value of given key into given buffer. Return number
+   * of bytes read or negative error code; ENOENT if the key is not
+   * found.
+   * @param[in] key to read.
+   * @param[in] buf buffer for value.
+   * @param[in] size of buffer.
+   * @return number of bytes or negative error code.
+   */
+  int read(uint8_t key, void* buf, size_t size);
+
+  /**
+   * Write given value for given key. The record is queued and
+   * committed asynchronously on the internal EEPROM. Waits for room
+   * if the queue is full. Unchanged values are not written. Return
+   * number of bytes or negative error code; EINVAL if the key or size
+   * is out of range and ENOSPC if there is no free slot.
+   * @param[in] key to write.
+   * @param[in] buf value to write.
+   * @param[in] size of value.
+   * @return number of bytes or negative error code.
+   */
+  int write(uint8_t key, const void* buf, size_t size);
+
+  /**
+   * Template function to read value of given key to given variable.
+   * Returns true(1) if successful otherwise false(0).
+   * @param[in] key to read.
+   * @param[out] value variable.
+   * @return bool.
+   */
+  template<class T> bool read(uint8_t key, T* value)
+  {
+    return (read(key, value, sizeof(T)) == sizeof(T));
+  }
+
+  /**
+   * Template function to write value of given key from given variable.
+   * Returns true(1) if successful otherwise false(0).
+   * @param[in] key to write.
+   * @param[in] value variable.
+   * @return bool.
+   */
+  template<class T> bool write(uint8_t key, const T* value)
+  {
+    return (write(key, value, sizeof(T)) == sizeof(T));
+  }
+
+  /**
+   * Return true(1) if all queued records have been committed
+   * otherwise false(0).
+   * @return bool.
+   */
+  bool is_committed() const
+  {
+    return (m_count == 0);
+  }
+
+  /**
+   * Wait for queued records to be committed.
+   */
+  void await()
+  {
+    while (!is_committed()) yield();
+  }
+
+  /**
+   * Return number of slots in region.
+   * @return slots.
+   */
+  uint8_t slots() const
+  {
+    return (m_slots);
+  }
+
+  /**
+   * Return next record sequence number; total number of records
+   * written to the region.
+   * @return sequence number.
+   */
+  uint32_t sequence() const
+  {
+    return (m_seq);
+  }
+
+protected:
+  /** Record in slot. */
+  struct record_t {
+    uint8_t key;		//!< Key (0..KEY_MAX-1).
+    uint8_t size;		//!< Value size (0..VALUE_MAX).
+    uint32_t seq;		//!< Sequence number.
+    uint8_t value[VALUE_MAX];	//!< Value.
+    uint8_t crc;		//!< CRC-8 of above.
+  };
+
+  /** No slot mark for index. */
+  static const uint8_t NONE = 0xff;
+
+  /** Queue index mask. */
+  static const uint8_t QUEUE_MASK = QUEUE_MAX - 1;
+
+  /** Store using the internal EEPROM (interrupt handler). */
+  static KVS* s_eeprom;
+
+  /** EEPROM device. */
+  EEPROM::Device* m_dev;
+
+  /** Start address of region. */
+  uint8_t* m_addr;
+
+  /** Number of slots in region. */
+  uint8_t m_slots;
+
+  /** Next slot to append to. */
+  uint8_t m_tail;
+
+  /** Next sequence number. */
+  uint32_t m_seq;
+
+  /** Slot of latest record per key. */
+  uint8_t m_index[KEY_MAX];
+
+  /** Queue of records to commit. */
+  record_t m_queue[QUEUE_MAX];
+
+  /** Slot of queued records. */
+  uint8_t m_target[QUEUE_MAX];
+
+  /** Queue put index. */
+  uint8_t m_put;
+
+  /** Queue get index. */
+  volatile uint8_t m_get;
+
+  /** Number of queued records. */
+  volatile uint8_t m_count;
+
+  /** Byte offset in record being committed. */
+  uint8_t m_offset;
+
+  /**
+   * Return eeprom address of given slot.
+   * @param[in] slot index.
+   * @return address.
+   */
+  uint8_t* address(uint8_t slot) const
+  {
+    return (m_addr + slot * sizeof(record_t));
+  }
+
+  /**
+   * Return CRC-8 of given record.
+   * @param[in] rec record.
+   * @return crc.
+   */
+  static uint8_t crc(const record_t* rec);
+
+  /**
+   * Read record in given slot. Return true(1) if successful and
+   * the record is valid otherwise false(0).
+   * @param[in] slot index.
+   * @param[out] rec record.
+   * @return bool.
+   */
+  bool load(uint8_t slot, record_t* rec);
+
+  /**
+   * Return next free slot in round-robin order or NONE if all slots
+   * are in use.
+   * @return slot index.
+   */
+  uint8_t next_slot();
+
+  /**
+   * Commit next byte of queued records. Called by EEPROM ready
+   * interrupt handler.
+   */
+  void on_ready();
+
+  /** Interrupt handler is friend. */
+  friend void EE_READY_vect(void);
+};
+
+#endif
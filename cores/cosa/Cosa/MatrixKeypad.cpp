@@ -0,0 +1,179 @@
+/**
+ * @file Cosa/MatrixKeypad.cpp
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/MatrixKeypad.hh"
+
+MatrixKeypad::MatrixKeypad(const Board::DigitalPin* rows,
+			   uint8_t row_count,
+			   const Board::InterruptPin* columns,
+			   uint8_t column_count) :
+  PinChangeInterrupt::Port((Board::InterruptPin) pgm_read_byte(columns),
+			   column_mask(columns, column_count)),
+  Link(),
+  m_rows(rows),
+  m_columns(columns),
+  m_row_count(row_count < ROW_MAX ? row_count : ROW_MAX),
+  m_column_count(column_count < CHARBITS ? column_count : CHARBITS),
+  m_latest(0),
+  m_armed(false),
+  m_sampling(false),
+  m_stable(0)
+{
+}
+
+uint8_t
+MatrixKeypad::column_mask(const Board::InterruptPin* columns,
+			  uint8_t count)
+{
+  uint8_t mask = 0;
+  for (uint8_t i = 0; i < count; i++)
+    mask |= Pin::MASK(pgm_read_byte(&columns[i]));
+  return (mask);
+}
+
+void
+MatrixKeypad::begin()
+{
+  // Columns are inputs with pullup
+  for (uint8_t i = 0; i < m_column_count; i++) {
+    Board::InterruptPin pin = get_column(i);
+    synchronized {
+      *Pin::DDR(pin) &= ~Pin::MASK(pin);
+      *Pin::PORT(pin) |= Pin::MASK(pin);
+    }
+  }
+
+  // Drive all rows low and arm the column interrupts
+  set_rows(true);
+  synchronized {
+    m_latest = 0;
+    m_armed = true;
+    enable();
+  }
+}
+
+void
+MatrixKeypad::end()
+{
+  bool active;
+  synchronized {
+    active = m_sampling;
+    m_sampling = false;
+    m_armed = false;
+    disable();
+    detach();
+  }
+  if (active) Watchdog::release();
+  set_rows(false);
+}
+
+void
+MatrixKeypad::set_rows(bool active)
+{
+  // Open-drain rows; port bit low and output when active
+  for (uint8_t i = 0; i < m_row_count; i++) {
+    Board::DigitalPin pin = get_row(i);
+    synchronized {
+      *Pin::PORT(pin) &= ~Pin::MASK(pin);
+      if (active)
+	*Pin::DDR(pin) |= Pin::MASK(pin);
+      else
+	*Pin::DDR(pin) &= ~Pin::MASK(pin);
+    }
+  }
+}
+
+uint8_t
+MatrixKeypad::scan()
+{
+  uint8_t nr = 0;
+  set_rows(false);
+  for (uint8_t r = 0; r < m_row_count && nr == 0; r++) {
+    // Drive the row low and allow the column lines to settle
+    Board::DigitalPin row = get_row(r);
+    synchronized *Pin::DDR(row) |= Pin::MASK(row);
+    DELAY(10);
+    uint8_t pressed = ~*m_sfr & m_mask;
+    synchronized *Pin::DDR(row) &= ~Pin::MASK(row);
+    if (pressed == 0) continue;
+    for (uint8_t c = 0; c < m_column_count; c++) {
+      if ((pressed & Pin::MASK(get_column(c))) == 0) continue;
+      nr = r * m_column_count + c + 1;
+      break;
+    }
+  }
+  set_rows(true);
+  return (nr);
+}
+
+void
+MatrixKeypad::on_change(uint8_t previous, uint8_t current,
+			uint8_t changed)
+{
+  UNUSED(previous);
+  UNUSED(current);
+  UNUSED(changed);
+
+  // Disarm and start scanning with watchdog timeout events
+  if (!m_armed) return;
+  m_armed = false;
+  m_sampling = true;
+  disable();
+  m_stable = 0;
+  Watchdog::acquire(SAMPLE_MS);
+  Watchdog::attach(this, SAMPLE_MS);
+}
+
+void
+MatrixKeypad::on_event(uint8_t type, uint16_t value)
+{
+  UNUSED(value);
+
+  // Skip all but timeout events
+  if (type != Event::TIMEOUT_TYPE) return;
+
+  // Scan the matrix and call the key callbacks on change
+  uint8_t nr = scan();
+  if (nr != m_latest) {
+    if (m_latest != 0) on_key_up(m_latest);
+    if (nr != 0) on_key_down(nr);
+    m_latest = nr;
+  }
+
+  // Arm the column interrupts when no key has been pressed for a
+  // number of scans. Check the columns with interrupts disabled so
+  // that no key press is lost
+  if (nr != 0) {
+    m_stable = 0;
+    return;
+  }
+  if (++m_stable < STABLE_COUNT) return;
+  bool armed = false;
+  synchronized {
+    if ((*m_sfr & m_mask) == m_mask) {
+      detach();
+      m_sampling = false;
+      m_armed = true;
+      enable();
+      armed = true;
+    }
+  }
+  if (armed) Watchdog::release();
+}
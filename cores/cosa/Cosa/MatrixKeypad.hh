@@ -0,0 +1,203 @@
+/**
+ * @file Cosa/MatrixKeypad.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_MATRIX_KEYPAD_HH
+#define COSA_MATRIX_KEYPAD_HH
+
+#include "Cosa/Types.h"
+#include "Cosa/PinChangeInterrupt.hh"
+#include "Cosa/Linkage.hh"
+#include "Cosa/Watchdog.hh"
+
+/**
+ * Interrupt driven matrix keypad. While idle all rows are driven low
+ * and the columns (input with pullup) are armed with a port pin
+ * change interrupt handler; any key press wakes the processor. On a
+ * change the interrupt is disarmed and the matrix is scanned with
+ * watchdog timeout events (SAMPLE_MS) until no key has been pressed
+ * for STABLE_COUNT scans. The watchdog is started on demand
+ * (Watchdog::acquire()) if not running and stopped after the burst.
+ * Callbacks on_key_down() and on_key_up() are called with the key
+ * number; row * columns + column + 1 (zero for no key). A single
+ * key is detected at a time.
+ * @code
+ * const Board::DigitalPin rows[] __PROGMEM = {
+ *   Board::D4, Board::D5, Board::D6, Board::D7
+ * };
+ * const Board::InterruptPin columns[] __PROGMEM = {
+ *   Board::PCI8, Board::PCI9, Board::PCI10
+ * };
+ * class Keys : public MatrixKeypad {
+ * public:
+ *   Keys() : MatrixKeypad(rows, 4, columns, 3) {}
+ *   virtual void on_key_down(uint8_t nr) { ... }
+ * };
+ * @endcode
+ *
+ * @section Circuit
+ * Keypad row lines to digital pins and column lines to pin change
+ * interrupt pins on the same port. The rows are open-drain (low or
+ * high impedance) so several key presses do not short the outputs.
+ *
+ * @section Limitations
+ * Requires PinChangeInterrupt::begin(). If the watchdog is already
+ * running it should have a period of SAMPLE_MS or less and either
+ * no interrupt handler (timeout events are then installed) or
+ * timeout events. Max 8 rows and columns.
+ */
+class MatrixKeypad : public PinChangeInterrupt::Port, private Link {
+public:
+  /** Max number of rows. */
+  static const uint8_t ROW_MAX = 8;
+
+  /**
+   * Construct matrix keypad with given row and column pin vectors in
+   * program memory. The column pins must be on the same port.
+   * @param[in] rows vector with row pins (program memory).
+   * @param[in] row_count number of rows (max ROW_MAX).
+   * @param[in] columns vector with column pins (program memory).
+   * @param[in] column_count number of columns (max 8).
+   */
+  MatrixKeypad(const Board::DigitalPin* rows, uint8_t row_count,
+	       const Board::InterruptPin* columns, uint8_t column_count);
+
+  /**
+   * Start the keypad handler; drive rows low and arm the column pin
+   * change interrupts.
+   */
+  void begin();
+
+  /**
+   * Stop the keypad handler.
+   */
+  void end();
+
+  /**
+   * Return true(1) if the keypad is idle and armed otherwise false(0).
+   * @return bool.
+   */
+  bool is_idle() const
+  {
+    return (m_armed);
+  }
+
+  /**
+   * @override MatrixKeypad
+   * Callback method when a key down is detected. Default is null
+   * function.
+   * @param[in] nr key number.
+   */
+  virtual void on_key_down(uint8_t nr)
+  {
+    UNUSED(nr);
+  }
+
+  /**
+   * @override MatrixKeypad
+   * Callback method when a key up is detected. Default is null
+   * function.
+   * @param[in] nr key number.
+   */
+  virtual void on_key_up(uint8_t nr)
+  {
+    UNUSED(nr);
+  }
+
+protected:
+  /** Keypad scan period in milli-seconds (during activity). */
+  static const uint16_t SAMPLE_MS = 16;
+
+  /** Number of scans without key before the keypad is armed. */
+  static const uint8_t STABLE_COUNT = 4;
+
+  const Board::DigitalPin* m_rows;	//!< Row pins (program memory).
+  const Board::InterruptPin* m_columns;	//!< Column pins (program memory).
+  uint8_t m_row_count;			//!< Number of rows.
+  uint8_t m_column_count;		//!< Number of columns.
+  uint8_t m_latest;			//!< Latest key number.
+  volatile bool m_armed;		//!< Pin change interrupt armed.
+  volatile bool m_sampling;		//!< Sampling with timeout events.
+  uint8_t m_stable;			//!< Number of scans without key.
+
+  /**
+   * Get row pin.
+   * @param[in] ix row index.
+   * @return pin number.
+   */
+  Board::DigitalPin get_row(uint8_t ix) const
+  {
+    return ((Board::DigitalPin) pgm_read_byte(&m_rows[ix]));
+  }
+
+  /**
+   * Get column pin.
+   * @param[in] ix column index.
+   * @return pin number.
+   */
+  Board::InterruptPin get_column(uint8_t ix) const
+  {
+    return ((Board::InterruptPin) pgm_read_byte(&m_columns[ix]));
+  }
+
+  /**
+   * Return port mask for the given column pins.
+   * @param[in] columns vector with column pins (program memory).
+   * @param[in] count number of columns.
+   * @return port mask.
+   */
+  static uint8_t column_mask(const Board::InterruptPin* columns,
+			     uint8_t count);
+
+  /**
+   * Drive all rows low (active) or release to high impedance.
+   * @param[in] active drive low.
+   */
+  void set_rows(bool active);
+
+  /**
+   * Scan the matrix and return key number of the first pressed key,
+   * zero(0) if no key is pressed.
+   * @return key number.
+   */
+  uint8_t scan();
+
+  /**
+   * @override PinChangeInterrupt::Port
+   * Column change interrupt handler. Disarm the interrupt and start
+   * scanning.
+   * @param[in] previous port value.
+   * @param[in] current port value.
+   * @param[in] changed pins.
+   */
+  virtual void on_change(uint8_t previous, uint8_t current,
+			 uint8_t changed);
+
+  /**
+   * @override Event::Handler
+   * Keypad event handler. Called by event dispatch. Scans the matrix
+   * and calls the key callbacks. Arms the interrupt when no key has
+   * been pressed for a number of scans.
+   * @param[in] type the type of event (timeout).
+   * @param[in] value the event value.
+   */
+  virtual void on_event(uint8_t type, uint16_t value);
+};
+
+#endif
@@ -25,6 +25,43 @@
 
 #include "Cosa/OWI.hh"
 
+// Timer0 prescale (RTC); timer cycles for given micro-seconds
+#define TIMER_PRESCALE 64
+#define TIMER_CYCLES(us) (((us) * I_CPU + TIMER_PRESCALE - 1) / TIMER_PRESCALE)
+
+// Bus with active asynchronous transaction
+OWI* OWI::s_bus = NULL;
+
+/**
+ * Start Timer0 output compare B to trigger after given number of
+ * micro-seconds. The timer (RTC) is free running and the compare
+ * value is relative to the current counter value; the phase within
+ * the current timer cycle is unknown and the match may be up to one
+ * cycle early. One cycle is added when the given time is a minimum
+ * (low and slot times). At least two timer cycles to avoid missing
+ * the compare match.
+ * @param[in] us micro-seconds.
+ * @param[in] min time is a minimum (default true).
+ */
+static inline void
+timer_start(uint16_t us, bool min = true)
+{
+  uint8_t cycles = TIMER_CYCLES(us) + (min ? 1 : 0);
+  if (cycles < 2) cycles = 2;
+  OCR0B = TCNT0 + cycles;
+  TIFR0 = _BV(OCF0B);
+  TIMSK0 |= _BV(OCIE0B);
+}
+
+/**
+ * Stop Timer0 output compare B interrupt.
+ */
+static inline void
+timer_stop()
+{
+  TIMSK0 &= ~_BV(OCIE0B);
+}
+
 bool
 OWI::reset()
 {
@@ -123,6 +160,178 @@ OWI::write(uint8_t value, void* buf, uint8_t size)
   while (size--) write(*bp++);
 }
 
+bool
+OWI::request(Event::Handler* target, bool reset,
+	     const void* src, uint8_t scount,
+	     void* dst, uint8_t dcount)
+{
+  // Check that there is no active transaction
+  synchronized {
+    if (s_bus != NULL) synchronized_return (false);
+    s_bus = this;
+  }
+
+  // Setup the transaction
+  m_target = target;
+  m_src = (const uint8_t*) src;
+  m_dst = (dcount != 0) ? (uint8_t*) dst : NULL;
+  m_scount = scount;
+  m_dcount = dcount;
+  m_bits = 0;
+  m_count = 0;
+  if (scount == 0) m_crc = 0;
+
+  // Start with reset pulse or the first bit slot
+  synchronized {
+    if (reset) {
+      set_mode(OUTPUT_MODE);
+      set();
+      clear();
+      m_state = RESET_LOW;
+      timer_start(480);
+    }
+    else {
+      m_state = SLOT_START;
+      timer_start(0, false);
+    }
+  }
+  return (true);
+}
+
+int
+OWI::await_completed()
+{
+  while (m_state != IDLE) yield();
+  return (m_count);
+}
+
+void
+OWI::isr_slot()
+{
+  // Load next byte to write or read; complete when done
+  if (m_bits == 0) {
+    if (m_scount != 0) {
+      m_data = *m_src++;
+    }
+    else if (m_dcount != 0) {
+      m_data = 0;
+    }
+    else {
+      isr_completed(m_dst != NULL ?
+		    Event::READ_COMPLETED_TYPE :
+		    Event::WRITE_COMPLETED_TYPE);
+      return;
+    }
+    m_bits = CHARBITS;
+  }
+
+  // Write bit slot; short pulse for one, long pulse for zero
+  uint8_t mix;
+  if (m_scount != 0) {
+    uint8_t bit = m_data & 1;
+    m_data >>= 1;
+    set_mode(OUTPUT_MODE);
+    set();
+    clear();
+    if (bit) {
+      DELAY(6);
+      set();
+      m_state = SLOT_START;
+      timer_start(64);
+    }
+    else {
+      m_state = SLOT_RELEASE;
+      timer_start(60);
+    }
+    mix = (m_crc ^ bit);
+  }
+
+  // Read bit slot; short pulse and sample
+  else {
+    set_mode(OUTPUT_MODE);
+    set();
+    clear();
+    DELAY(6);
+    set_mode(INPUT_MODE);
+    DELAY(9);
+    m_data >>= 1;
+    if (is_set()) {
+      m_data |= 0x80;
+      mix = (m_crc ^ 1);
+    }
+    else {
+      mix = (m_crc ^ 0);
+    }
+    m_state = SLOT_START;
+    timer_start(55);
+  }
+  m_crc >>= 1;
+  if (mix & 1) m_crc ^= 0x8C;
+
+  // Check for end of byte; store read byte
+  if (--m_bits != 0) return;
+  if (m_scount != 0) {
+    m_scount -= 1;
+    if (m_scount == 0) m_crc = 0;
+  }
+  else {
+    *m_dst++ = m_data;
+    m_dcount -= 1;
+  }
+  m_count += 1;
+}
+
+void
+OWI::isr_completed(uint8_t type)
+{
+  timer_stop();
+  power_off();
+  s_bus = NULL;
+  m_state = IDLE;
+  if (m_target != NULL) Event::push(type, m_target);
+}
+
+void
+OWI::isr_next()
+{
+  switch (m_state) {
+  case RESET_LOW:
+    // Release the bus and wait for the presence pulse
+    set();
+    set_mode(INPUT_MODE);
+    m_state = RESET_SAMPLE;
+    timer_start(70, false);
+    break;
+  case RESET_SAMPLE:
+    // Check presence pulse and wait for end of reset time slot
+    if (is_set()) {
+      m_count = EIO;
+      isr_completed(Event::ERROR_TYPE);
+      break;
+    }
+    m_state = SLOT_START;
+    timer_start(410);
+    break;
+  case SLOT_RELEASE:
+    // Release the bus after zero bit; recovery time
+    set();
+    m_state = SLOT_START;
+    timer_start(10, false);
+    break;
+  case SLOT_START:
+    isr_slot();
+    break;
+  default:
+    timer_stop();
+  }
+}
+
+ISR(TIMER0_COMPB_vect)
+{
+  if (OWI::s_bus != NULL) OWI::s_bus->isr_next();
+  else timer_stop();
+}
+
 OWI::Driver*
 OWI::lookup(uint8_t* rom)
 {
@@ -24,6 +24,7 @@
 #include "Cosa/Types.h"
 #include "Cosa/IOPin.hh"
 #include "Cosa/IOStream.hh"
+#include "Cosa/Event.hh"
 
 /**
  * 1-wire device driver support class. Allows device rom search
@@ -31,7 +32,11 @@
  *
  * @section Limitations
  * The driver will turn off interrupt handling during data read
- * from the device.
+ * from the device. The asynchronous transaction engine, request(),
+ * uses Timer0 output compare B for the slot timing and requires the
+ * RTC (Timer0). Output compare B and PWM on OC0B may not be used by
+ * other modules. Interrupts are turned off for at most a read slot
+ * (15 us). Parasite power is not supported by the engine.
  */
 class OWI : private IOPin {
 public:
@@ -222,7 +227,16 @@ public:
     IOPin(pin),
     m_devices(0),
     m_device(NULL),
-    m_crc(0)
+    m_crc(0),
+    m_state(IDLE),
+    m_target(NULL),
+    m_src(NULL),
+    m_dst(NULL),
+    m_scount(0),
+    m_dcount(0),
+    m_data(0),
+    m_bits(0),
+    m_count(0)
   {}
 
   /**
@@ -278,6 +292,57 @@ public:
     clear();
   }
 
+  /**
+   * Start an asynchronous transaction on the one wire bus; optional
+   * reset and presence check, write the given number of bytes from
+   * the source buffer and read the given number of bytes to the
+   * destination buffer. Return false(0) if there is already an
+   * active transaction otherwise true(1). An Event::READ_COMPLETED_TYPE
+   * (Event::WRITE_COMPLETED_TYPE when there are no bytes to read) or
+   * ERROR_TYPE (no presence) is pushed to the target on completion.
+   * The slot timing and the bit state machine are handled by the
+   * timer compare interrupt handler. The RTC must be started.
+   * @param[in] target event handler (or null).
+   * @param[in] reset bus before write.
+   * @param[in] src source buffer.
+   * @param[in] scount number of bytes to write.
+   * @param[in] dst destination buffer (default null).
+   * @param[in] dcount number of bytes to read (default zero).
+   * @return bool.
+   */
+  bool request(Event::Handler* target, bool reset,
+	       const void* src, uint8_t scount,
+	       void* dst = NULL, uint8_t dcount = 0);
+
+  /**
+   * Return true(1) if the asynchronous transaction has completed
+   * otherwise false(0).
+   * @return bool.
+   */
+  bool is_completed() const
+  {
+    return (m_state == IDLE);
+  }
+
+  /**
+   * Await asynchronous transaction to complete. Returns number of
+   * bytes written and read, or negative error code (EIO no presence
+   * pulse).
+   * @return number of bytes or negative error code.
+   */
+  int await_completed();
+
+  /**
+   * Return true(1) if the bytes read with the latest read block
+   * (synchronous or asynchronous) ended with a valid CRC otherwise
+   * false(0).
+   * @return bool.
+   */
+  bool is_crc_valid() const
+  {
+    return (m_crc == 0);
+  }
+
   /**
    * Lookup the driver instance with the given rom address.
    * @return driver pointer or null(0).
@@ -301,6 +366,53 @@ private:
 
   /** Intermediate CRC sum. */
   uint8_t m_crc;
+
+  /**
+   * Asynchronous transaction states.
+   */
+  enum State {
+    IDLE,			//!< No active transaction.
+    RESET_LOW,			//!< Reset pulse; release bus.
+    RESET_SAMPLE,		//!< Sample presence pulse.
+    SLOT_START,			//!< Start next bit slot.
+    SLOT_RELEASE		//!< Release bus after zero bit.
+  } __attribute__((packed));
+
+  volatile State m_state;	//!< Transaction state.
+  Event::Handler* m_target;	//!< Completion event target.
+  const uint8_t* m_src;		//!< Source buffer pointer.
+  uint8_t* m_dst;		//!< Destination buffer pointer.
+  uint8_t m_scount;		//!< Remaining bytes to write.
+  uint8_t m_dcount;		//!< Remaining bytes to read.
+  uint8_t m_data;		//!< Current byte.
+  uint8_t m_bits;		//!< Remaining bits of current byte.
+  volatile int m_count;		//!< Number of bytes or error code.
+
+  /** Bus with active asynchronous transaction. */
+  static OWI* s_bus;
+
+  /**
+   * Load the next byte to write or read and start the next bit slot.
+   * Complete the transaction when there are no more bytes.
+   * Called from interrupt handler.
+   */
+  void isr_slot();
+
+  /**
+   * Complete the transaction and push the completion event.
+   * Called from interrupt handler.
+   * @param[in] type of event.
+   */
+  void isr_completed(uint8_t type);
+
+  /**
+   * Handle the next step of the transaction state machine.
+   * Called from interrupt handler.
+   */
+  void isr_next();
+
+  /** Interrupt handler is a friend. */
+  friend void ::TIMER0_COMPB_vect(void);
 };
 
 /**
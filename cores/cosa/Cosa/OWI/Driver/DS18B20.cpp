@@ -124,6 +124,74 @@ DS18B20::read_power_supply()
   return (m_parasite);
 }
 
+bool
+DS18B20::Group::convert_request()
+{
+  // Conversion time and power mode given by the devices in the group
+  uint8_t resolution = 9;
+  m_parasite = false;
+  for (uint8_t i = 0; i < m_count; i++) {
+    DS18B20* dev = m_dev[i];
+    uint8_t bits = dev->get_resolution();
+    if (bits > resolution) resolution = bits;
+    if (dev->m_parasite) m_parasite = true;
+  }
+  m_conv_time = (MAX_CONVERSION_TIME >> (12 - resolution));
+
+  // Broadcast the conversion; strong pull-up for parasite power
+  if (!m_owi->reset()) return (false);
+  m_owi->write(OWI::SKIP_ROM);
+  m_owi->write(CONVERT_T, CHARBITS, m_parasite);
+  m_start = Watchdog::millis();
+  m_converting = true;
+  return (true);
+}
+
+bool
+DS18B20::Group::await_conversion()
+{
+  if (!m_converting) return (true);
+  m_converting = false;
+
+  // Parasite power; keep the strong pull-up for the conversion time
+  if (m_parasite) {
+    int32_t ms = Watchdog::millis() - m_start;
+    if (ms < m_conv_time) delay(m_conv_time - ms);
+    m_owi->power_off();
+    return (true);
+  }
+
+  // Powered; devices respond with zero while converting
+  while (m_owi->read(1) == 0) {
+    if (Watchdog::since(m_start) > m_conv_time) return (false);
+    yield();
+  }
+  return (true);
+}
+
+uint8_t
+DS18B20::Group::read_scratchpad()
+{
+  uint8_t res = 0;
+  await_conversion();
+  for (uint8_t i = 0; i < m_count; i++) {
+    DS18B20* dev = m_dev[i];
+    dev->m_converting = false;
+    if (dev->read_scratchpad()) res += 1;
+  }
+  return (res);
+}
+
+uint8_t
+DS18B20::Group::read_alarms()
+{
+  uint8_t res = 0;
+  await_conversion();
+  DS18B20::Search iter(m_owi);
+  while (iter.next() != NULL) res += 1;
+  return (res);
+}
+
 void
 DS18B20::print(IOStream& outs, int16_t temp)
 {
@@ -68,6 +68,90 @@ public:
     DS18B20* next();
   };
 
+  /**
+   * Group of thermometers on a 1-Wire bus. Issues a single broadcast
+   * conversion (skip rom) for all devices in the group and reads the
+   * scratchpad of each device, or only of devices with an active
+   * alarm. The conversion wait uses the strong pull-up if any device
+   * requires parasite power otherwise the bus is polled for the end
+   * of the conversion. The devices should be connected before used
+   * in a group.
+   */
+  class Group {
+  public:
+    /**
+     * Construct group of thermometers on the given 1-Wire bus.
+     * @param[in] owi one-wire bus.
+     * @param[in] dev vector of devices.
+     * @param[in] count number of devices.
+     */
+    Group(OWI* owi, DS18B20** dev, uint8_t count) :
+      m_owi(owi),
+      m_dev(dev),
+      m_count(count),
+      m_start(0L),
+      m_conv_time(0),
+      m_parasite(false),
+      m_converting(false)
+    {}
+
+    /**
+     * Initiate temperature conversion for all devices (broadcast).
+     * The conversion time is given by the highest resolution in the
+     * group. Returns true(1) if successful otherwise false(0).
+     * @return bool.
+     */
+    bool convert_request();
+
+    /**
+     * Wait for the conversion to complete. Parasite powered groups
+     * are given the conversion time with the strong pull-up. Powered
+     * groups poll the bus until the devices signal completion or
+     * the conversion time has elapsed. Yields while waiting. Returns
+     * true(1) if the conversion completed otherwise false(0).
+     * @return bool.
+     */
+    bool await_conversion();
+
+    /**
+     * Read the scratchpad of all devices in the group. Waits for a
+     * pending conversion. Returns number of devices read with valid
+     * CRC.
+     * @return number of devices.
+     */
+    uint8_t read_scratchpad();
+
+    /**
+     * Read the scratchpad of the devices with a temperature outside
+     * the alarm thresholds (alarm search). Waits for a pending
+     * conversion. Returns number of devices with alarm.
+     * @return number of devices.
+     */
+    uint8_t read_alarms();
+
+    /**
+     * Refresh the temperature readings; convert request, wait for
+     * completion and read scratchpads, or only devices with alarm.
+     * Returns number of devices read.
+     * @param[in] alarms only devices with alarm (default false).
+     * @return number of devices.
+     */
+    uint8_t refresh(bool alarms = false)
+    {
+      if (!convert_request()) return (0);
+      return (alarms ? read_alarms() : read_scratchpad());
+    }
+
+  protected:
+    OWI* m_owi;			//!< One-wire bus.
+    DS18B20** m_dev;		//!< Vector of devices.
+    uint8_t m_count;		//!< Number of devices.
+    uint32_t m_start;		//!< Watchdog millis on convert_request().
+    uint16_t m_conv_time;	//!< Conversion time for group.
+    bool m_parasite;		//!< Parasite power mode in group.
+    bool m_converting;		//!< Convert request pending.
+  };
+
   /**
    * Construct a DS18B20 device connected to the given 1-Wire bus.
    * Use connect() to lookup, set power supply mode and
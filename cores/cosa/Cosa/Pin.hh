@@ -78,6 +78,17 @@ public:
     return (Board::SFR(pin) + 2);
   }
 
+  /**
+   * Return pointer to pin change interrupt mask register.
+   * @param[in] pin number.
+   * @return pin change mask register pointer.
+   */
+  static volatile uint8_t* PCIMR(uint8_t pin)
+    __attribute__((always_inline))
+  {
+    return (Board::PCIMR(pin));
+  }
+
   /**
    * Serialization directions; most or least significant bit first.
    */
@@ -39,15 +39,57 @@
 
 PinChangeInterrupt* PinChangeInterrupt::s_pin[Board::PCINT_MAX] = { NULL };
 uint8_t PinChangeInterrupt::s_state[Board::PCMSK_MAX] = { 0 };
+PinChangeInterrupt::Port* PinChangeInterrupt::s_port[Board::PCMSK_MAX] = { NULL };
+
+uint8_t
+PinChangeInterrupt::port_index(uint8_t pin)
+{
+#if defined(BOARD_ATMEGA2560)
+  return (pin < 24 ? 0 : 2);
+#else
+  volatile uint8_t* sfr = Pin::PIN(pin);
+  for (uint8_t i = 0; i < Board::PCMSK_MAX; i++)
+    if (Pin::PIN(i << 3) == sfr) return (i);
+  return (0);
+#endif
+}
+
+PinChangeInterrupt::Port::Port(Board::InterruptPin pin, uint8_t mask) :
+  m_sfr(Pin::PIN(pin)),
+  m_pcimr(Pin::PCIMR(pin)),
+  m_mask(mask),
+  m_ix(port_index(pin))
+{
+}
+
+void
+PinChangeInterrupt::Port::enable()
+{
+  synchronized {
+    s_state[m_ix] = (s_state[m_ix] & ~m_mask) | (*m_sfr & m_mask);
+    *m_pcimr |= m_mask;
+    s_port[m_ix] = this;
+  }
+}
+
+void
+PinChangeInterrupt::Port::disable()
+{
+  synchronized {
+    *m_pcimr &= ~m_mask;
+    s_port[m_ix] = NULL;
+  }
+}
 
 void
 PinChangeInterrupt::enable()
 {
+  uint8_t ix = port_index(m_pin);
   synchronized {
+    s_state[ix] = (s_state[ix] & ~m_mask) | (*PIN() & m_mask);
     *PCIMR() |= m_mask;
 #if defined(BOARD_ATMEGA2560)
-    uint8_t ix = m_pin - (m_pin < 24 ? 16 : 48);
-    s_pin[ix] = this;
+    s_pin[m_pin - (m_pin < 24 ? 16 : 48)] = this;
 #else
     s_pin[m_pin] = this;
 #endif
@@ -95,18 +137,31 @@ PinChangeInterrupt::end()
 void
 PinChangeInterrupt::on_interrupt(uint8_t pcint, uint8_t mask, uint8_t base)
 {
-  uint8_t new_state = *Pin::PIN(base);
-  uint8_t changed = (new_state ^ s_state[pcint]) & mask;
-
-
-  for (uint8_t i = 0; changed && (i < CHARBITS); i++) {
-    if ((changed & 1) && (s_pin[base + i] != NULL)) {
-      s_pin[base + i]->on_interrupt();
-    }
-    changed >>= 1;
+  uint8_t previous = s_state[pcint];
+  uint8_t current = *Pin::PIN(base);
+  uint8_t changed = (current ^ previous) & mask;
+  s_state[pcint] = current;
+  if (changed == 0) return;
+
+  // Call port handler with the changed pins in the handler mask
+  Port* port = s_port[pcint];
+  if (port != NULL) {
+    uint8_t pins = changed & port->m_mask;
+    if (pins != 0) port->on_change(previous, current, pins);
   }
 
-  s_state[pcint] = new_state;
+  // Call interrupt pin handlers; walk only the changed pins
+#if defined(BOARD_ATMEGA2560)
+  PinChangeInterrupt** handler = &s_pin[pcint << 3];
+#else
+  PinChangeInterrupt** handler = &s_pin[base];
+#endif
+  do {
+    uint8_t ix = __builtin_ctz(changed);
+    changed &= (changed - 1);
+    PinChangeInterrupt* pin = handler[ix];
+    if (pin != NULL) pin->on_interrupt();
+  } while (changed);
 }
 
 #define PCINT_ISR(vec,pcint,base)				\
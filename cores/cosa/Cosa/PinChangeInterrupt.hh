@@ -28,10 +28,60 @@
 
 /**
  * Abstract interrupt pin. Allows interrupt handling on
- * the pin value changes.
+ * the pin value changes. A port handler may be used to handle
+ * several pins on the same port in a single call.
  */
 class PinChangeInterrupt : public IOPin, public Interrupt::Handler {
 public:
+  /**
+   * Abstract port change handler. Receives the previous, current and
+   * changed port values for the pins in the handler mask in a single
+   * call. The pins should be set to input mode. Interrupt pin
+   * handlers on the same port are called after the port handler.
+   */
+  class Port {
+  public:
+    /**
+     * Construct port change handler for the port of the given pin and
+     * the given port pin mask.
+     * @param[in] pin on the port.
+     * @param[in] mask port pins to handle.
+     */
+    Port(Board::InterruptPin pin, uint8_t mask);
+
+    /**
+     * Enable pin change detection for the pins in the mask and the
+     * port handler. The pin state is updated so that only following
+     * changes are detected.
+     */
+    void enable();
+
+    /**
+     * Disable pin change detection for the pins in the mask and the
+     * port handler.
+     */
+    void disable();
+
+    /**
+     * @override PinChangeInterrupt::Port
+     * Port change interrupt service. Called with the changed pins in
+     * the mask.
+     * @param[in] previous port value.
+     * @param[in] current port value.
+     * @param[in] changed pins.
+     */
+    virtual void on_change(uint8_t previous, uint8_t current,
+			   uint8_t changed) = 0;
+
+  protected:
+    volatile uint8_t* m_sfr;	//!< Port PIN register.
+    volatile uint8_t* m_pcimr;	//!< Pin change mask register.
+    uint8_t m_mask;		//!< Port pins to handle.
+    uint8_t m_ix;		//!< Port index.
+
+    friend class PinChangeInterrupt;
+  };
+
   /**
    * Start handling of pin change interrupt handling.
    */
@@ -54,6 +104,8 @@ public:
   /**
    * @override Interrupt::Handler
    * Enable interrupt pin change detection and interrupt handler.
+   * The pin state is updated so that only following changes are
+   * detected.
    */
   virtual void enable();
 
@@ -73,11 +125,19 @@ public:
 private:
   static PinChangeInterrupt* s_pin[Board::PCINT_MAX];
   static uint8_t s_state[Board::PCMSK_MAX];
+  static Port* s_port[Board::PCMSK_MAX];
+
+  /**
+   * Return port index (state and port handler) for given pin.
+   * @param[in] pin number.
+   * @return port index.
+   */
+  static uint8_t port_index(uint8_t pin);
 
   /**
    * Map interrupt source: Check which pin(s) are the source of the
-   * pin change interrupt and call the corresponding interrupt handler
-   * per pin.
+   * pin change interrupt. Call the port handler with the changed pins
+   * and the interrupt handler per changed pin (lowest first).
    * @param[in] ix port index.
    * @param[in] mask pin mask.
    * @param[in] base pin number from IDE.
@@ -229,3 +229,79 @@ Rotary::Encoder::detect()
   return ((Direction) (m_state & 0xf0));
 }
 
+
+/**
+ * Quadrature count change table; index is previous and current pin
+ * state (DT:CLK). The clock-wise sequence is 00, 01, 11, 10, 00.
+ * Transitions where none or both pins changed are ignored.
+ */
+const int8_t Rotary::Quadrature::table[16] __PROGMEM = {
+//  00  01  10  11	(current)
+     0, +1, -1,  0,	// 00 (previous)
+    -1,  0,  0, +1,	// 01
+    +1,  0,  0, -1,	// 10
+     0, -1, +1,  0	// 11
+};
+
+Rotary::Quadrature::Quadrature(Board::InterruptPin clk,
+			       Board::InterruptPin dt,
+			       Encoder::Mode mode) :
+  PinChangeInterrupt::Port(clk, Pin::MASK(clk) | Pin::MASK(dt)),
+  m_clk(Pin::MASK(clk)),
+  m_dt(Pin::MASK(dt)),
+  m_counts(mode == Encoder::FULL_CYCLE ? 4 : 2),
+  m_state(0),
+  m_count(0),
+  m_pending(false)
+{
+  IOPin::set_mode((Board::DigitalPin) clk, IOPin::INPUT_MODE);
+  IOPin::set_mode((Board::DigitalPin) dt, IOPin::INPUT_MODE);
+  enable();
+}
+
+void
+Rotary::Quadrature::enable()
+{
+  synchronized {
+    m_state = decode(*m_sfr);
+    m_count = 0;
+    Port::enable();
+  }
+}
+
+void
+Rotary::Quadrature::on_change(uint8_t previous, uint8_t current,
+			      uint8_t changed)
+{
+  UNUSED(previous);
+  UNUSED(changed);
+
+  // Lookup count change for the pin state transition
+  uint8_t state = decode(current);
+  int8_t step = (int8_t) pgm_read_byte(&table[(m_state << 2) | state]);
+  m_state = state;
+  if (step == 0) return;
+
+  // Accumulate and push a single event when a detent is reached
+  int16_t count = m_count + step;
+  m_count = count;
+  if (m_pending || (count < m_counts && count > -m_counts)) return;
+  m_pending = Event::push(Event::CHANGE_TYPE, this);
+}
+
+void
+Rotary::Quadrature::on_event(uint8_t type, uint16_t value)
+{
+  UNUSED(type);
+  UNUSED(value);
+
+  // Take the accumulated detents; keep the remaining counts
+  int16_t delta;
+  synchronized {
+    int16_t count = m_count;
+    delta = count / m_counts;
+    m_count = count - delta * m_counts;
+    m_pending = false;
+  }
+  if (delta != 0) on_turn(delta);
+}
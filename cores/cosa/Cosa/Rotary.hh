@@ -27,7 +27,8 @@
 
 /**
  * Rotary Encoder class with support for dials (normal and
- * accelerated).
+ * accelerated). The quadrature decoder and velocity dial handle
+ * fast turns without loss of steps.
  *
  * @section Acknowledgements
  * The Rotary Encoder algorithm is based on an implementation by Ben
@@ -423,5 +424,294 @@ public:
       on_change(m_value);
     }
   };
+
+  /**
+   * Table-driven quadrature decoder for Rotary Encoders. Both signal
+   * pins are read with a single port access (pin change port handler)
+   * and the previous and current pin state (4-bit) is used as index
+   * into a table of count changes (-1, 0, +1). Invalid transitions
+   * (bounce or both pins changed) are ignored. The counts are
+   * accumulated by the interrupt handler and a single
+   * Event::CHANGE_TYPE is pushed when a detent has been reached and
+   * no event is pending. The event handler takes all accumulated
+   * detents and calls on_turn() with the delta. Steps are not lost
+   * when the event queue is full or the event handling is delayed.
+   * @code
+   * class Volume : public Rotary::Quadrature {
+   * public:
+   *   Volume() : Rotary::Quadrature(Board::PCI6, Board::PCI7) {}
+   *   virtual void on_turn(int16_t delta) { ... }
+   * };
+   * @endcode
+   *
+   * @section Circuit
+   * KY-040 Rotary Encoder Module. The signal pins must be on the same
+   * port.
+   * @code
+   *                       Rotary Encoder
+   *                       +------------+
+   * (PCIc)--------------1-|CLK         |
+   * (PCId)--------------2-|DT          |
+   *                     3-|SW   (/)    |
+   * (VCC)---------------4-|VCC         |
+   * (GND)---------------5-|GND         |
+   *                       +------------+
+   * @endcode
+   *
+   * @section Limitations
+   * Uses the port handler of the signal pin port; only one port
+   * handler per port is allowed (see PinChangeInterrupt::Port).
+   */
+  class Quadrature : public PinChangeInterrupt::Port, public Event::Handler {
+  public:
+    /**
+     * Create quadrature decoder with given interrupt pins and cycle
+     * mode; full cycle is four(4) and half cycle two(2) counts per
+     * detent. The pins are set to input mode. Setup must call
+     * PinChangeInterrupt::begin() to initiate handling of pins.
+     * @param[in] clk pin.
+     * @param[in] dt pin (same port as clk).
+     * @param[in] mode cycle (default FULL_CYCLE).
+     */
+    Quadrature(Board::InterruptPin clk, Board::InterruptPin dt,
+	       Encoder::Mode mode = Encoder::FULL_CYCLE);
+
+    /**
+     * Get current cycle mode.
+     * @return mode.
+     */
+    Encoder::Mode get_mode() const
+    {
+      return (m_counts == 4 ? Encoder::FULL_CYCLE : Encoder::HALF_CYCLE);
+    }
+
+    /**
+     * Get number of counts accumulated since the latest detent.
+     * @return counts.
+     */
+    int16_t get_count() const
+    {
+      int16_t res;
+      synchronized res = m_count;
+      return (res);
+    }
+
+    /**
+     * Enable the decoder. The pin state is read and the accumulated
+     * counts are cleared.
+     */
+    void enable();
+
+    /**
+     * Disable the decoder.
+     */
+    void disable()
+      __attribute__((always_inline))
+    {
+      Port::disable();
+    }
+
+    /**
+     * @override Rotary::Quadrature
+     * Called by the event handler with the number of detents turned
+     * since the previous call; positive for clock-wise and negative
+     * for anti-clock-wise direction.
+     * @param[in] delta number of detents.
+     */
+    virtual void on_turn(int16_t delta)
+    {
+      UNUSED(delta);
+    }
+
+  protected:
+    /** Count change for (previous, current) pin state. */
+    static const int8_t table[16] PROGMEM;
+
+    const uint8_t m_clk;	//!< Clock pin port mask.
+    const uint8_t m_dt;		//!< Data pin port mask.
+    const int8_t m_counts;	//!< Counts per detent.
+    uint8_t m_state;		//!< Previous pin state.
+    volatile int16_t m_count;	//!< Accumulated counts.
+    volatile bool m_pending;	//!< Event in queue.
+
+    /**
+     * Map port value to pin state; data pin bit 1 and clock pin bit 0.
+     * @param[in] port value.
+     * @return pin state.
+     */
+    uint8_t decode(uint8_t port) const
+      __attribute__((always_inline))
+    {
+      return (((port & m_dt) ? 2 : 0) | ((port & m_clk) ? 1 : 0));
+    }
+
+    /**
+     * @override PinChangeInterrupt::Port
+     * Signal pin change interrupt handler. Looks up the count change
+     * for the pin state transition and accumulates the count. Pushes
+     * an Event::CHANGE_TYPE when a detent is reached and there is no
+     * pending event.
+     * @param[in] previous port value.
+     * @param[in] current port value.
+     * @param[in] changed pins.
+     */
+    virtual void on_change(uint8_t previous, uint8_t current,
+			   uint8_t changed);
+
+    /**
+     * @override Event::Handler
+     * Take the accumulated detents and call on_turn() with the delta.
+     * @param[in] type the event type.
+     * @param[in] value the event value.
+     */
+    virtual void on_event(uint8_t type, uint16_t value);
+  };
+
+  /**
+   * Use quadrature decoder as a dial (integer value) with velocity
+   * based acceleration. Allows a dial within a given number(T) range
+   * (min, max) and a given initial value. The turn velocity (detents
+   * per second) is calculated from the coalesced delta and the time
+   * since the previous change. The step is multiplied with one plus
+   * the velocity divided by the threshold, limited to the given max
+   * factor. A zero threshold disables the acceleration. Requires RTC.
+   * @param[in] T value type.
+   *
+   * @section Circuit
+   * See Rotary::Quadrature.
+   */
+  template<typename T>
+  class VelocityDial : public Quadrature {
+  public:
+    /**
+     * Construct velocity dial connected to given interrupt pins with
+     * given mode, initial, min, max and step value, acceleration
+     * threshold (detents per second) and max step factor.
+     * @param[in] clk interrupt pin.
+     * @param[in] dt interrupt pin.
+     * @param[in] mode step.
+     * @param[in] initial value.
+     * @param[in] min value.
+     * @param[in] max value.
+     * @param[in] step value.
+     * @param[in] threshold velocity (default 10 detents per second).
+     * @param[in] factor max step factor (default 10).
+     */
+    VelocityDial(Board::InterruptPin clk, Board::InterruptPin dt,
+		 Encoder::Mode mode, T initial, T min, T max, T step,
+		 uint16_t threshold = 10, uint8_t factor = 10) :
+      Quadrature(clk, dt, mode),
+      m_latest(0L),
+      m_value(initial),
+      m_min(min),
+      m_max(max),
+      m_step(step),
+      m_threshold(threshold),
+      m_factor(factor != 0 ? factor : 1)
+    {}
+
+    /**
+     * Return current dial value.
+     * @return value.
+     */
+    T get_value() const
+    {
+      return (m_value);
+    }
+
+    /**
+     * Set dial value. The value is not checked against the range.
+     * @param[in] value.
+     */
+    void set_value(T value)
+    {
+      m_value = value;
+    }
+
+    /**
+     * Get current step (increment/decrement).
+     * @return step.
+     */
+    T get_step() const
+    {
+      return (m_step);
+    }
+
+    /**
+     * Set step (increment/decrement).
+     * @param[in] step value.
+     */
+    void set_step(T step)
+    {
+      m_step = step;
+    }
+
+    /**
+     * Set acceleration threshold (detents per second) and max step
+     * factor. Zero(0) threshold to disable acceleration.
+     * @param[in] threshold velocity.
+     * @param[in] factor max step factor.
+     */
+    void set_acceleration(uint16_t threshold, uint8_t factor)
+    {
+      m_threshold = threshold;
+      m_factor = (factor != 0 ? factor : 1);
+    }
+
+    /**
+     * @override Rotary::VelocityDial
+     * Default on change function.
+     * @param[in] value.
+     */
+    virtual void on_change(T value)
+    {
+      UNUSED(value);
+    }
+
+  protected:
+    uint32_t m_latest;		//!< Time of previous change (ms).
+    T m_value;			//!< Current value.
+    T m_min;			//!< Min value.
+    T m_max;			//!< Max value.
+    T m_step;			//!< Step per detent.
+    uint16_t m_threshold;	//!< Acceleration threshold.
+    uint8_t m_factor;		//!< Max step factor.
+
+    /**
+     * @override Rotary::Quadrature
+     * Update the dial value with the number of detents and the step
+     * factor given by the velocity. The value is limited to the range.
+     * @param[in] delta number of detents.
+     */
+    virtual void on_turn(int16_t delta)
+    {
+      uint32_t now = RTC::millis();
+      uint32_t ms = now - m_latest;
+      m_latest = now;
+      uint16_t detents = (delta < 0 ? -delta : delta);
+      uint8_t factor = 1;
+      if (m_threshold != 0) {
+	uint32_t velocity = (detents * 1000UL) / (ms != 0 ? ms : 1);
+	velocity /= m_threshold;
+	factor = (velocity < m_factor ? velocity + 1 : m_factor);
+      }
+      T inc = m_step * (T) (detents * factor);
+      if (delta > 0) {
+	if (m_value == m_max) return;
+	if (m_max - m_value < inc)
+	  m_value = m_max;
+	else
+	  m_value += inc;
+      }
+      else {
+	if (m_value == m_min) return;
+	if (m_value - m_min < inc)
+	  m_value = m_min;
+	else
+	  m_value -= inc;
+      }
+      on_change(m_value);
+    }
+  };
 };
 #endif
@@ -20,6 +20,7 @@
 
 #include "Cosa/SPI.hh"
 #include "Cosa/Power.hh"
+#include "Cosa/RTC.hh"
 
 // Configuration: Allow SPI transfer interleaving
 #if !defined(BOARD_ATTINY)
@@ -28,13 +29,151 @@
 
 SPI spi  __attribute__ ((weak));
 
-#if defined(SPDR)
+#if defined(USE_SPI_USART)
+
+// Create mapping to USART clock pin (XCKn) data direction register
+#if defined(BOARD_ATMEGA328P)
+#define XCK_DDR DDRD
+#define XCK_BIT 4
+#elif defined(BOARD_ATMEGA1248P)
+#if (USE_SPI_USART == 0)
+#define XCK_DDR DDRB
+#define XCK_BIT 0
+#else
+#define XCK_DDR DDRD
+#define XCK_BIT 4
+#endif
+#elif defined(BOARD_ATMEGA32U4)
+#define XCK_DDR DDRD
+#define XCK_BIT 5
+#elif defined(BOARD_ATMEGA2560)
+#if (USE_SPI_USART == 0)
+#define XCK_DDR DDRE
+#define XCK_BIT 2
+#elif (USE_SPI_USART == 1)
+#define XCK_DDR DDRD
+#define XCK_BIT 5
+#elif (USE_SPI_USART == 2)
+#define XCK_DDR DDRH
+#define XCK_BIT 2
+#else
+#define XCK_DDR DDRJ
+#define XCK_BIT 2
+#endif
+#else
+#error "Cosa/SPI.cpp: USE_SPI_USART not supported on board"
+#endif
+
+/**
+ * USART clock setting (UBRRn) for SPI clock rate; index is the rate
+ * and value is the system clock divisor / 2 - 1.
+ */
+static const uint8_t UBRR[] __PROGMEM = {
+  1, 7, 31, 63, 0, 3, 15, 31
+};
+
+SPI::Driver::Driver(Board::DigitalPin cs, Pulse pulse,
+		    Clock rate, uint8_t mode, Order order,
+		    Interrupt::Handler* irq) :
+  m_next(NULL),
+  m_irq(irq),
+  m_acquires(0),
+  m_bus_time(0),
+  m_cs(cs, ((pulse & 0x01) == 0)),
+  m_pulse(pulse),
+  // USART Control Register for master spi mode; UCPHA and UCPOL are
+  // in reverse order compared to SPCR
+  m_ucsrc(0xc0
+	  | ((order & 0x1) << 2)
+	  | ((mode & 0x1) << 1)
+	  | ((mode & 0x2) >> 1)),
+  m_ubrr(pgm_read_byte(&UBRR[rate & 0x7]))
+{
+}
+
+SPI::SPI() :
+  m_list(NULL),
+  m_dev(NULL),
+  m_busy(false),
+  m_config(NULL),
+  m_irqs(0),
+  m_start(0),
+  m_head(NULL),
+  m_tail(NULL),
+  m_transfer(NULL),
+  m_segment(NULL),
+  m_rx(NULL),
+  m_tx(NULL),
+  m_count(0),
+  m_vec(NULL)
+{
+  // Initiate the USART in master spi mode. The clock pin (XCKn) must
+  // be an output pin. Transmitter and receiver override the data pins
+  synchronized {
+    SPI_UBRR = 0;
+    bit_set(XCK_DDR, XCK_BIT);
+    SPI_UCSRC = 0xc0;
+    SPI_UCSRB = _BV(SPI_RXEN) | _BV(SPI_TXEN);
+    SPI_UBRR = pgm_read_byte(&UBRR[DEFAULT_CLOCK]);
+  }
+  // Other the SPI setup is done by the SPI::Driver::begin()
+}
+
+bool
+SPI::post(Transfer* xfer)
+{
+  // The USART interrupt handlers belong to the UART; run the transfer
+  if (xfer->m_busy) return (false);
+  run(xfer);
+  if (xfer->m_target != NULL)
+    Event::push(Event::WRITE_COMPLETED_TYPE, xfer->m_target, xfer->m_size);
+  return (true);
+}
+
+/*
+ * Write only block transfer member functions for the USART. The
+ * transmit buffer is kept filled and the received data is discarded
+ * when the last byte has been shifted out.
+ */
+void
+SPI::write(const void* buf, size_t count)
+{
+  if (count == 0) return;
+  const uint8_t* sp = (const uint8_t*) buf;
+  SPI_UCSRA = _BV(SPI_TXC);
+  do {
+    uint8_t data = *sp++;
+    loop_until_bit_is_set(SPI_UCSRA, SPI_UDRE);
+    SPI_UDR = data;
+  } while (--count);
+  loop_until_bit_is_set(SPI_UCSRA, SPI_TXC);
+  while (bit_is_set(SPI_UCSRA, SPI_RXC)) SPI_UDR;
+}
+
+void
+SPI::write_P(const void* buf, size_t count)
+{
+  if (count == 0) return;
+  const uint8_t* sp = (const uint8_t*) buf;
+  SPI_UCSRA = _BV(SPI_TXC);
+  do {
+    uint8_t data = pgm_read_byte(sp++);
+    loop_until_bit_is_set(SPI_UCSRA, SPI_UDRE);
+    SPI_UDR = data;
+  } while (--count);
+  loop_until_bit_is_set(SPI_UCSRA, SPI_TXC);
+  while (bit_is_set(SPI_UCSRA, SPI_RXC)) SPI_UDR;
+}
+
+#elif defined(SPDR)
 
 SPI::Driver::Driver(Board::DigitalPin cs, Pulse pulse,
 		    Clock rate, uint8_t mode, Order order,
 		    Interrupt::Handler* irq) :
   m_next(NULL),
   m_irq(irq),
+  m_acquires(0),
+  m_bus_time(0),
   m_cs(cs, ((pulse & 0x01) == 0)),
   m_pulse(pulse),
   // SPI Control Register for master mode
@@ -51,7 +190,18 @@ SPI::Driver::Driver(Board::DigitalPin cs, Pulse pulse,
 SPI::SPI(uint8_t mode, Order order) :
   m_list(NULL),
   m_dev(NULL),
-  m_busy(false)
+  m_busy(false),
+  m_config(NULL),
+  m_irqs(0),
+  m_start(0),
+  m_head(NULL),
+  m_tail(NULL),
+  m_transfer(NULL),
+  m_segment(NULL),
+  m_rx(NULL),
+  m_tx(NULL),
+  m_count(0),
+  m_vec(NULL)
 {
   // Initiate the SPI port and control for slave mode
   synchronized {
@@ -66,7 +216,18 @@ SPI::SPI(uint8_t mode, Order order) :
 SPI::SPI() :
   m_list(NULL),
   m_dev(NULL),
-  m_busy(false)
+  m_busy(false),
+  m_config(NULL),
+  m_irqs(0),
+  m_start(0),
+  m_head(NULL),
+  m_tail(NULL),
+  m_transfer(NULL),
+  m_segment(NULL),
+  m_rx(NULL),
+  m_tx(NULL),
+  m_count(0),
+  m_vec(NULL)
 {
   // Initiate the SPI data direction for master mode
   // The SPI/SS pin must be an output pin in master mode
@@ -95,8 +256,116 @@ SPI::Slave::on_interrupt(uint16_t arg)
 // Current slave device. Should be a singleton
 SPI::Slave* SPI::Slave::s_device = NULL;
 
+bool
+SPI::next()
+{
+  if (m_vec == NULL) return (false);
+  while (m_vec->buf != NULL) {
+    m_tx = (const uint8_t*) m_vec->buf;
+    m_count = m_vec->size;
+    m_vec += 1;
+    if (m_count != 0) return (true);
+  }
+  return (false);
+}
+
+bool
+SPI::load(Transfer* seg)
+{
+  m_segment = seg;
+  m_rx = seg->m_dst;
+  m_tx = seg->m_src;
+  m_count = seg->m_count;
+  m_vec = seg->m_vec;
+  return (m_count != 0 || next());
+}
+
+void
+SPI::start()
+{
+  // Dequeue the next transfer and acquire the bus
+  Transfer* xfer = m_head;
+  m_head = xfer->m_next;
+  if (m_head == NULL) m_tail = NULL;
+  xfer->m_next = NULL;
+  m_transfer = xfer;
+  m_busy = true;
+  m_dev = xfer->m_dev;
+  setup(m_dev);
+
+  // Find the first segment with data
+  Transfer* seg = xfer;
+  while (seg != NULL && !load(seg)) seg = seg->m_link;
+  if (seg == NULL) {
+    m_transfer = NULL;
+    xfer->m_busy = false;
+    if (xfer->m_target != NULL)
+      Event::push(Event::WRITE_COMPLETED_TYPE, xfer->m_target);
+    release();
+    return;
+  }
+
+  // Select the device and start the transfer with the first byte
+  begin();
+  bit_set(SPCR, SPIE);
+  SPDR = (m_tx != NULL) ? *m_tx++ : 0xff;
+}
+
+void
+SPI::on_transfer()
+{
+  Transfer* xfer = m_transfer;
+  uint8_t data = SPDR;
+  if (m_rx != NULL) *m_rx++ = data;
+  xfer->m_size += 1;
+
+  // Transmit the next byte; buffer or next io vector element
+  if (--m_count != 0 || next()) {
+    SPDR = (m_tx != NULL) ? *m_tx++ : 0xff;
+    return;
+  }
+
+  // Segment completed; deselect and continue with the next segment
+  end();
+  for (Transfer* seg = m_segment->m_link; seg != NULL; seg = seg->m_link) {
+    if (!load(seg)) continue;
+    begin();
+    SPDR = (m_tx != NULL) ? *m_tx++ : 0xff;
+    return;
+  }
+
+  // Transfer completed; release the bus and signal completion
+  bit_clear(SPCR, SPIE);
+  m_transfer = NULL;
+  xfer->m_busy = false;
+  if (xfer->m_target != NULL)
+    Event::push(Event::WRITE_COMPLETED_TYPE, xfer->m_target, xfer->m_size);
+  release();
+}
+
+bool
+SPI::post(Transfer* xfer)
+{
+  if (xfer->m_busy) return (false);
+  xfer->m_size = 0;
+  xfer->m_busy = true;
+  xfer->m_next = NULL;
+  synchronized {
+    // Append to queue and start if the bus is idle
+    if (m_tail == NULL) m_head = xfer;
+    else m_tail->m_next = xfer;
+    m_tail = xfer;
+    if (!m_busy) start();
+  }
+  return (true);
+}
+
 ISR(SPI_STC_vect)
 {
+  if (spi.m_transfer != NULL) {
+    spi.on_transfer();
+    return;
+  }
   SPI::Slave* device = SPI::Slave::s_device;
   if (device != NULL) device->on_interrupt(SPDR);
 }
@@ -117,6 +386,8 @@ SPI::Driver::Driver(Board::DigitalPin cs, Pulse pulse,
 		    Interrupt::Handler* irq) :
   m_next(NULL),
   m_irq(irq),
+  m_acquires(0),
+  m_bus_time(0),
   m_cs(cs, ((pulse & 0x01) == 0)),
   m_pulse(pulse),
   m_cpol(mode)
@@ -140,7 +411,18 @@ SPI::Driver::Driver(Board::DigitalPin cs, Pulse pulse,
 SPI::SPI(uint8_t mode, Order order) :
   m_list(NULL),
   m_dev(NULL),
-  m_busy(false)
+  m_busy(false),
+  m_config(NULL),
+  m_irqs(0),
+  m_start(0),
+  m_head(NULL),
+  m_tail(NULL),
+  m_transfer(NULL),
+  m_segment(NULL),
+  m_rx(NULL),
+  m_tx(NULL),
+  m_count(0),
+  m_vec(NULL)
 {
   UNUSED(order);
 
@@ -155,10 +437,32 @@ SPI::SPI(uint8_t mode, Order order) :
   }
 }
 
+bool
+SPI::post(Transfer* xfer)
+{
+  // No transfer complete interrupt handler; run the transfer
+  if (xfer->m_busy) return (false);
+  run(xfer);
+  if (xfer->m_target != NULL)
+    Event::push(Event::WRITE_COMPLETED_TYPE, xfer->m_target, xfer->m_size);
+  return (true);
+}
+
 SPI::SPI() :
   m_list(NULL),
   m_dev(NULL),
-  m_busy(false)
+  m_busy(false),
+  m_config(NULL),
+  m_irqs(0),
+  m_start(0),
+  m_head(NULL),
+  m_tail(NULL),
+  m_transfer(NULL),
+  m_segment(NULL),
+  m_rx(NULL),
+  m_tx(NULL),
+  m_count(0),
+  m_vec(NULL)
 {
   // Set port data direction. Note ATtiny MOSI/MISO are DI/DO.
   // Do not confuse with SPI chip programming pins
@@ -221,6 +525,7 @@ SPI::read(void* buf, size_t count)
   *dp = transfer_await();
 }
 
+#if !defined(USE_SPI_USART)
 void
 SPI::write(const void* buf, size_t count)
 {
@@ -248,6 +553,7 @@ SPI::write_P(const void* buf, size_t count)
   }
   transfer_await();
 }
+#endif
 
 #else
 
@@ -303,6 +609,7 @@ SPI::attach(Driver* dev)
   if (dev->m_next != NULL) return (false);
   dev->m_next = m_list;
   m_list = dev;
+  if (dev->m_irq != NULL) m_irqs += 1;
   return (true);
 }
 
@@ -319,18 +626,38 @@ SPI::acquire(Driver* dev)
   // Set current device and mark as busy
   m_busy = true;
   m_dev = dev;
-#if defined(SPDR)
-  // Initiate SPI hardware with device settings
-  SPCR = dev->m_spcr;
-  SPSR = dev->m_spsr;
+  setup(dev);
+  unlock(key);
+}
+
+void
+SPI::setup(Driver* dev)
+{
+  // Account acquire and start bus time
+  dev->m_acquires += 1;
+  m_start = RTC::micros();
+#if defined(USE_SPI_USART)
+  // Initiate USART with device settings; skip when unchanged
+  if (m_config != dev) {
+    SPI_UCSRC = dev->m_ucsrc;
+    SPI_UBRR = dev->m_ubrr;
+    m_config = dev;
+  }
+#elif defined(SPDR)
+  // Initiate SPI hardware with device settings; skip when unchanged
+  if (m_config != dev || SPCR != dev->m_spcr) {
+    SPCR = dev->m_spcr;
+    SPSR = dev->m_spsr;
+    m_config = dev;
+  }
 #else
   // Set clock polarity
   bit_write(dev->m_cpol & 0x02, PORT, Board::SCK);
 #endif
   // Disable all interrupt sources on SPI bus
+  if (m_irqs == 0) return;
   for (SPI::Driver* dev = m_list; dev != NULL; dev = dev->m_next)
     if (dev->m_irq != NULL) dev->m_irq->disable();
-  unlock(key);
 }
 
 void
@@ -338,21 +665,67 @@ SPI::release()
 {
   // Lock the device driver update
   uint8_t key = lock();
-  // Release the device driver
+  // Account bus time and release the device driver
+  m_dev->m_bus_time += RTC::micros() - m_start;
   m_busy = false;
   m_dev = NULL;
   // Enable all interrupt sources on SPI bus
-  for (SPI::Driver* dev = m_list; dev != NULL; dev = dev->m_next)
-    if (dev->m_irq != NULL) dev->m_irq->enable();
+  if (m_irqs != 0) {
+    for (SPI::Driver* dev = m_list; dev != NULL; dev = dev->m_next)
+      if (dev->m_irq != NULL) dev->m_irq->enable();
+  }
+#if defined(SPDR) && !defined(USE_SPI_USART)
+  // Start the next posted asynchronous transfer
+  if (m_head != NULL) start();
+#endif
   unlock(key);
 }
 
+size_t
+SPI::run(Transfer* batch)
+{
+  size_t res = 0;
+  acquire(batch->m_dev);
+  for (Transfer* seg = batch; seg != NULL; seg = seg->m_link) {
+    // Skip empty segments as the asynchronous transfer
+    size_t count = (seg->m_vec != NULL) ?
+      iovec_size(seg->m_vec) :
+      seg->m_count;
+    if (count == 0) continue;
+    begin();
+    if (seg->m_vec != NULL) {
+      write(seg->m_vec);
+      res += count;
+    }
+    else {
+      // Clock out dummy bytes without storing when no buffers
+      if (seg->m_src == NULL && seg->m_dst == NULL)
+	for (size_t i = 0; i < count; i++) transfer(0xff);
+      else if (seg->m_src == NULL)
+	read(seg->m_dst, seg->m_count);
+      else if (seg->m_dst == NULL)
+	write(seg->m_src, seg->m_count);
+      else
+	transfer(seg->m_dst, seg->m_src, seg->m_count);
+      res += seg->m_count;
+    }
+    end();
+  }
+  release();
+  batch->m_size = res;
+  return (res);
+}
+
 void
 SPI::Driver::set_clock(Clock rate)
 {
-#if defined(SPDR)
+#if defined(USE_SPI_USART)
+  m_ubrr = pgm_read_byte(&UBRR[rate & 0x7]);
+  if (spi.m_config == this) spi.m_config = NULL;
+#elif defined(SPDR)
   m_spcr = (m_spcr & ~(0x3 << SPR0)) | ((rate & 0x3) << SPR0);
   m_spsr = (m_spsr & ~(1 << SPI2X)) | (((rate & 0x04) != 0) << SPI2X);
+  if (spi.m_config == this) spi.m_config = NULL;
 #else
   UNUSED(rate);
 #endif
@@ -28,6 +28,25 @@
 #include "Cosa/Event.hh"
 #include "Cosa/IOStream.hh"
 
+// Configuration: SPI bus on USARTn in Master SPI Mode (MSPIM)
+// #define USE_SPI_USART 1
+
+#if defined(USE_SPI_USART)
+// Mapping of USARTn registers and bits for the SPI bus
+#define SPI_USART_REG(reg,n,sfx) SPI_USART_PASTE(reg,n,sfx)
+#define SPI_USART_PASTE(reg,n,sfx) reg ## n ## sfx
+#define SPI_UCSRA SPI_USART_REG(UCSR,USE_SPI_USART,A)
+#define SPI_UCSRB SPI_USART_REG(UCSR,USE_SPI_USART,B)
+#define SPI_UCSRC SPI_USART_REG(UCSR,USE_SPI_USART,C)
+#define SPI_UBRR SPI_USART_REG(UBRR,USE_SPI_USART,)
+#define SPI_UDR SPI_USART_REG(UDR,USE_SPI_USART,)
+#define SPI_RXC SPI_USART_REG(RXC,USE_SPI_USART,)
+#define SPI_TXC SPI_USART_REG(TXC,USE_SPI_USART,)
+#define SPI_UDRE SPI_USART_REG(UDRE,USE_SPI_USART,)
+#define SPI_RXEN SPI_USART_REG(RXEN,USE_SPI_USART,)
+#define SPI_TXEN SPI_USART_REG(TXEN,USE_SPI_USART,)
+#endif
+
 /**
  * Serial Peripheral Interface (SPI) device class. A device driver
  * should inherit from SPI::Driver and defined SPI commands and higher
@@ -53,6 +72,16 @@
  * (GND)---------------7-|GND         |
  *                       +------------+
  * @endcode
+ *
+ * @section USART
+ * The SPI bus may be moved to USARTn in Master SPI Mode (MSPIM) by
+ * defining USE_SPI_USART to the USART number. The USART transmitter
+ * is double buffered so that bytes are shifted out back to back
+ * without the gap between bytes of the SPI hardware module. MOSI is
+ * TXDn, MISO is RXDn and SCK is XCKn. The device drivers are used
+ * unchanged. Slave mode is not supported and posted transfers are
+ * performed synchronously. Note that the USART is not available as
+ * a serial port (UART) when used for the SPI bus.
  */
 class SPI {
 public:
@@ -160,12 +189,45 @@ public:
       set_clock(clock(freq));
     }
 
+    /**
+     * Return number of bus acquires by the driver.
+     * @return acquires.
+     */
+    uint16_t acquires() const
+    {
+      return (m_acquires);
+    }
+
+    /**
+     * Return accumulated bus time (acquire to release) of the driver
+     * in micro-seconds. Requires RTC.
+     * @return micro-seconds.
+     */
+    uint32_t bus_time() const
+    {
+      return (m_bus_time);
+    }
+
+    /**
+     * Reset acquire count and bus time.
+     */
+    void reset_counters()
+    {
+      m_acquires = 0;
+      m_bus_time = 0;
+    }
+
   protected:
     Driver* m_next;		//!< List of drivers.
     Interrupt::Handler* m_irq;	//!< Interrupt handler.
+    uint16_t m_acquires;	//!< Number of acquires.
+    uint32_t m_bus_time;	//!< Accumulated bus time (us).
     OutputPin m_cs;		//!< Device chip select pin.
     Pulse m_pulse;		//!< Chip select pulse width.
-#if defined(USICR)
+#if defined(USE_SPI_USART)
+    uint8_t m_ucsrc;		//!< USART/UCSRnC MSPIM mode setting.
+    uint8_t m_ubrr;		//!< USART/UBRRn clock setting.
+#elif defined(USICR)
     const uint8_t m_cpol;	//!< Clock polatity (CPOL) setting.
     uint8_t m_usicr;		//!< USI hardware control register setting.
     uint8_t m_data;		//!< Data register for asynchron transfer.
@@ -251,7 +313,61 @@ public:
     if (m_dev->m_pulse > ACTIVE_HIGH) m_dev->m_cs.toggle();
   }
 
-#if defined(USIDR)
+#if defined(USE_SPI_USART)
+  /**
+   * Exchange data with slave. Should only be used within a SPI
+   * transaction; begin()-end() block. Return received value.
+   * @param[in] data to send.
+   * @return value received.
+   */
+  uint8_t transfer(uint8_t data)
+    __attribute__((always_inline))
+  {
+    SPI_UDR = data;
+    loop_until_bit_is_set(SPI_UCSRA, SPI_RXC);
+    return (SPI_UDR);
+  }
+
+  /**
+   * Start exchange data with slave. Should only be used within a SPI
+   * transaction; begin()-end() block.
+   * @param[in] data to send.
+   */
+  void transfer_start(uint8_t data)
+    __attribute__((always_inline))
+  {
+    SPI_UDR = data;
+  }
+
+  /**
+   * Wait for exchange with slave. Should only be used within a SPI
+   * transaction; begin()-end() block. Return received value.
+   * @return value received.
+   */
+  uint8_t transfer_await()
+    __attribute__((always_inline))
+  {
+    loop_until_bit_is_set(SPI_UCSRA, SPI_RXC);
+    return (SPI_UDR);
+  }
+
+  /**
+   * Next data to exchange with slave. Should only be used within a SPI
+   * transaction; begin()-end() block. The next data is written to the
+   * transmit buffer while the previous is shifted out.
+   * @param[in] data to send.
+   * @return value received.
+   */
+  uint8_t transfer_next(uint8_t data)
+    __attribute__((always_inline))
+  {
+    loop_until_bit_is_set(SPI_UCSRA, SPI_UDRE);
+    SPI_UDR = data;
+    loop_until_bit_is_set(SPI_UCSRA, SPI_RXC);
+    return (SPI_UDR);
+  }
+
+#elif defined(USIDR)
   /**
    * Exchange data with slave. Should only be used within a SPI
    * transaction; begin()-end() block. Return received value.
@@ -415,6 +531,151 @@ public:
       write(vp->buf, vp->size);
   }
 
+  /**
+   * Transfer descriptor. A transfer is either a single buffer
+   * transfer (transmit and/or receive) or a write of a null
+   * terminated io buffer vector. The transfer is performed with chip
+   * select asserted (a segment) and with the driver settings.
+   * Descriptors for the same driver may be linked to a batch of
+   * segments that is run back to back under one acquire; see
+   * link(), run() and post(). The descriptor is not modified by the
+   * transfer and may be reused.
+   *
+   * Posted transfers are shifted out from the SPI transfer complete
+   * interrupt handler; the CPU is free during the transfer. An
+   * Event::WRITE_COMPLETED_TYPE with the number of bytes transferred
+   * is pushed to the target (if given) on completion of the batch.
+   * The descriptors and buffers must be valid until the transfer is
+   * completed. The interrupt overhead makes asynchronous transfer
+   * slower than the synchronous block transfer for the highest SPI
+   * clock rates.
+   */
+  class Transfer {
+  public:
+    /**
+     * Construct an empty transfer descriptor.
+     */
+    Transfer() :
+      m_next(NULL),
+      m_link(NULL),
+      m_dev(NULL),
+      m_target(NULL),
+      m_dst(NULL),
+      m_src(NULL),
+      m_count(0),
+      m_vec(NULL),
+      m_size(0),
+      m_busy(false)
+    {}
+
+    /**
+     * Set buffer transfer for given driver. Transmit buffer may be
+     * null(0) for read (0xff is transmitted). Receive buffer may be
+     * null(0) for write. The buffers may be the same.
+     * @param[in] dev device driver.
+     * @param[in] dst receive buffer (or null).
+     * @param[in] src transmit buffer (or null).
+     * @param[in] count number of bytes.
+     * @param[in] target completion event receiver (default null).
+     */
+    void set(Driver* dev, void* dst, const void* src, size_t count,
+	     Event::Handler* target = NULL)
+    {
+      m_dev = dev;
+      m_target = target;
+      m_dst = (uint8_t*) dst;
+      m_src = (const uint8_t*) src;
+      m_count = count;
+      m_vec = NULL;
+    }
+
+    /**
+     * Set io buffer vector write for given driver.
+     * @param[in] dev device driver.
+     * @param[in] vec null terminated io buffer vector.
+     * @param[in] target completion event receiver (default null).
+     */
+    void set(Driver* dev, const iovec_t* vec, Event::Handler* target = NULL)
+    {
+      m_dev = dev;
+      m_target = target;
+      m_dst = NULL;
+      m_src = NULL;
+      m_count = 0;
+      m_vec = vec;
+    }
+
+    /**
+     * Link given descriptor as the next segment in the batch. The
+     * segment is performed with the driver of the first descriptor.
+     * Return the given descriptor for chaining.
+     * @param[in] next segment (or null to terminate the batch).
+     * @return next.
+     */
+    Transfer* link(Transfer* next)
+    {
+      m_link = next;
+      return (next);
+    }
+
+    /**
+     * Return true(1) if the transfer is completed (or not posted)
+     * otherwise false(0).
+     * @return bool.
+     */
+    bool is_completed() const
+    {
+      return (!m_busy);
+    }
+
+    /**
+     * Wait for the transfer to complete. Return number of bytes
+     * transferred.
+     * @return number of bytes.
+     */
+    size_t await()
+    {
+      while (m_busy) yield();
+      return (m_size);
+    }
+
+  protected:
+    Transfer* m_next;		//!< Next transfer in queue.
+    Transfer* m_link;		//!< Next segment in batch.
+    Driver* m_dev;		//!< Device driver.
+    Event::Handler* m_target;	//!< Completion event receiver.
+    uint8_t* m_dst;		//!< Receive buffer.
+    const uint8_t* m_src;	//!< Transmit buffer.
+    size_t m_count;		//!< Number of bytes in buffer.
+    const iovec_t* m_vec;	//!< Io buffer vector.
+    size_t m_size;		//!< Number of bytes transferred.
+    volatile bool m_busy;	//!< Queued or in progress.
+
+    friend class SPI;
+    friend void SPI_STC_vect(void);
+  };
+
+  /**
+   * Run the given transfer (batch of linked segments) synchronously.
+   * The bus is acquired once and each segment is framed by chip
+   * select. Return number of bytes transferred.
+   * @param[in] batch transfer descriptor.
+   * @return number of bytes.
+   */
+  size_t run(Transfer* batch);
+
+  /**
+   * Post given transfer descriptor (batch of linked segments). The
+   * transfer is started directly if the bus is idle otherwise queued
+   * and started when the bus is released. Return true(1) if
+   * successful otherwise false(0) if the descriptor is already
+   * posted. On devices without hardware SPI (USI) and for the USART
+   * bus the transfer is run directly.
+   * @param[in] xfer transfer descriptor.
+   * @return bool.
+   */
+  bool post(Transfer* xfer);
+
   /**
    * SPI slave device support. Allows Arduino/AVR to act as a hardware
    * device on the SPI bus.
@@ -497,6 +758,56 @@ private:
   Driver* m_list;		//!< List of attached device drivers.
   Driver* m_dev;		//!< Current device driver.
   volatile bool m_busy;		//!< Current device state.
+  Driver* m_config;		//!< Driver of current hardware settings.
+  uint8_t m_irqs;		//!< Number of drivers with interrupt.
+  uint32_t m_start;		//!< Start of bus time (us).
+  Transfer* m_head;		//!< Queue of posted transfers.
+  Transfer* m_tail;		//!< Last posted transfer.
+  Transfer* volatile m_transfer;	//!< Transfer in progress.
+  Transfer* m_segment;		//!< Segment in progress.
+  uint8_t* m_rx;		//!< Segment receive pointer.
+  const uint8_t* m_tx;		//!< Segment transmit pointer.
+  size_t m_count;		//!< Segment remaining bytes in buffer.
+  const iovec_t* m_vec;		//!< Segment next io vector element.
+
+  /**
+   * Initiate the SPI hardware with the given driver settings and
+   * disable all interrupt sources on the bus. The hardware setting
+   * is not reloaded when the same driver reacquires the bus. Should
+   * be called with interrupts disabled.
+   * @param[in] dev device driver.
+   */
+  void setup(Driver* dev);
+
+  /**
+   * Start the next posted transfer. Should be called with interrupts
+   * disabled and the bus released.
+   */
+  void start();
+
+  /**
+   * Load the given segment for asynchronous transfer. Return true(1)
+   * if the segment has data to transfer otherwise false(0).
+   * @param[in] seg segment.
+   * @return bool.
+   */
+  bool load(Transfer* seg);
+
+  /**
+   * Step to the next non-empty io buffer vector element of the
+   * segment. Return true(1) if there was an element otherwise
+   * false(0).
+   * @return bool.
+   */
+  bool next();
+
+  /**
+   * Handle transfer complete interrupt for asynchronous transfer.
+   */
+  void on_transfer();
+
+  /** Interrupt Service Routine. */
+  friend void SPI_STC_vect(void);
 };
 
 /**
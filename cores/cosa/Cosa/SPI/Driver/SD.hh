@@ -23,6 +23,7 @@
 
 #include "Cosa/Types.h"
 #include "Cosa/SPI.hh"
+#include "Cosa/IOBlock.hh"
 
 /**
  * Cosa SD low-level device driver class. Implements disk driver
@@ -32,10 +33,10 @@
  * 1. SD Specification, Part 1: Physical Layer, Simplified Specification,
  * Version 4.10, January 22, 2013. https://www.sdcard.org/downloads/pls/simplified_specs/part1_410.pdf
  */
-class SD : private SPI::Driver {
+class SD : public IOBlock::Device, private SPI::Driver {
 public:
   /** Max size of block. */
-  static const size_t BLOCK_MAX = 512;
+  static const size_t BLOCK_MAX = IOBlock::BLOCK_MAX;
 
   /** Supported card types. */
   enum CARD {
@@ -427,15 +428,17 @@ public:
   bool end();
 
   /**
+   * @override IOBlock::Device
    * Erase given block interval from start to end. Returns true if
    * successful otherwise false.
    * @param[in] start block address.
    * @param[in] end block address.
    * @return bool.
    */
-  bool erase(uint32_t start, uint32_t end);
+  virtual bool erase(uint32_t start, uint32_t end);
 
   /**
+   * @override IOBlock::Device
    * Read given block into given destination buffer. The buffer must
    * be able to hold BLOCK_MAX bytes. Returns true if successful
    * otherwise false.
@@ -443,8 +446,7 @@ public:
    * @param[in] dst pointer to destination buffer.
    * @return bool.
    */
-  bool read(uint32_t block, uint8_t* dst)
-    __attribute__((always_inline))
+  virtual bool read(uint32_t block, uint8_t* dst)
   {
     if (m_type != TYPE_SDHC) block <<= 9;
     return (read(READ_SINGLE_BLOCK, block, dst, BLOCK_MAX));
@@ -476,13 +478,14 @@ public:
   }
 
   /**
+   * @override IOBlock::Device
    * Write given source buffer with BLOCK_MAX bytes to the given
    * block. Returns true if successful otherwise false.
    * @param[in] block address.
    * @param[in] src pointer to source buffer.
    * @return bool.
    */
-  bool write(uint32_t block, const uint8_t* src);
+  virtual bool write(uint32_t block, const uint8_t* src);
 };
 
 #endif
@@ -26,7 +26,7 @@
 
 /**
  * Servo motor driver. Uses Timer#1 and the two compare output
- * registers.
+ * registers. See ServoSequencer for more than two servos.
  *
  * @section Limitations
  * Cannot be used together with other classes that use Timer#1.
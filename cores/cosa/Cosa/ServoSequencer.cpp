@@ -0,0 +1,237 @@
+/**
+ * @file Cosa/ServoSequencer.cpp
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/ServoSequencer.hh"
+
+#if !defined(BOARD_ATTINY)
+
+#include "Cosa/Pin.hh"
+
+#define FRAME_TICKS (ServoSequencer::PERIOD * ServoSequencer::TICKS_PER_US)
+#define MARGIN_TICKS (ServoSequencer::MARGIN * ServoSequencer::TICKS_PER_US)
+
+ServoSequencer* ServoSequencer::s_sequencer = NULL;
+
+ServoSequencer::ServoSequencer(const Board::DigitalPin* pins,
+			       uint8_t count) :
+  m_pins(pins),
+  m_count(0),
+  m_ports(0),
+  m_min(MIN_WIDTH),
+  m_max(MAX_WIDTH),
+  m_start(0),
+  m_ix(FRAME_START),
+  m_active(&m_schedule[0]),
+  m_pending(NULL)
+{
+  // Map servos to ports; ignore pins on too many ports
+  if (count > CHANNEL_MAX) count = CHANNEL_MAX;
+  uint16_t init = width(90);
+  for (uint8_t i = 0; i < count; i++) {
+    volatile uint8_t* port = Pin::PORT(get_pin_at(i));
+    uint8_t ix = 0;
+    while (ix < m_ports && m_port[ix] != port) ix++;
+    if (ix == m_ports) {
+      if (m_ports == PORT_MAX) break;
+      m_port[m_ports++] = port;
+    }
+    m_channel_port[i] = ix;
+    m_width[i] = init;
+    m_count += 1;
+  }
+}
+
+bool
+ServoSequencer::begin()
+{
+  if (m_count == 0) return (false);
+  synchronized {
+    if (s_sequencer != NULL) synchronized_return (false);
+    s_sequencer = this;
+  }
+
+  // Clear pins and set output mode
+  for (uint8_t i = 0; i < m_count; i++) {
+    Board::DigitalPin pin = get_pin_at(i);
+    synchronized {
+      *Pin::PORT(pin) &= ~Pin::MASK(pin);
+      *Pin::DDR(pin) |= Pin::MASK(pin);
+    }
+  }
+
+  // Calculate the schedule and start the first frame. Timer1 in
+  // normal mode with prescale 8; keep the timer if already running
+  m_pending = NULL;
+  update();
+  synchronized {
+    m_active = m_pending;
+    m_pending = NULL;
+    m_ix = FRAME_START;
+    if ((TCCR1A & (_BV(WGM11) | _BV(WGM10))) != 0
+	|| (TCCR1B & (_BV(WGM13) | _BV(WGM12) | 0x07)) != _BV(CS11)) {
+      TCCR1A = 0;
+      TCCR1B = _BV(CS11);
+    }
+    m_start = TCNT1 + 2 * MARGIN_TICKS;
+    OCR1A = m_start - MARGIN_TICKS;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 |= _BV(OCIE1A);
+  }
+  return (true);
+}
+
+void
+ServoSequencer::end()
+{
+  if (s_sequencer != this) return;
+  synchronized {
+    TIMSK1 &= ~_BV(OCIE1A);
+    for (uint8_t i = 0; i < m_count; i++) {
+      Board::DigitalPin pin = get_pin_at(i);
+      *Pin::PORT(pin) &= ~Pin::MASK(pin);
+    }
+    s_sequencer = NULL;
+  }
+}
+
+uint16_t
+ServoSequencer::width(uint8_t degree) const
+{
+  if (degree > 180) degree = 180;
+  return (m_min + (((uint32_t) (m_max - m_min)) * degree) / 180);
+}
+
+void
+ServoSequencer::set_width(uint8_t ix, uint16_t us)
+{
+  if (ix >= m_count || m_width[ix] == us) return;
+  if (us > PERIOD / 2) us = PERIOD / 2;
+  m_width[ix] = us;
+  if (s_sequencer == this) update();
+}
+
+void
+ServoSequencer::set_angle(uint8_t ix, uint8_t degree)
+{
+  set_width(ix, width(degree));
+}
+
+void
+ServoSequencer::set_angle(const uint8_t* degree)
+{
+  for (uint8_t i = 0; i < m_count; i++) m_width[i] = width(degree[i]);
+  if (s_sequencer == this) update();
+}
+
+uint8_t
+ServoSequencer::get_angle(uint8_t ix) const
+{
+  uint16_t us = get_width(ix);
+  if (us <= m_min) return (0);
+  if (us >= m_max) return (180);
+  return ((((uint32_t) (us - m_min)) * 180) / (m_max - m_min));
+}
+
+void
+ServoSequencer::update()
+{
+  // Withdraw the pending update; build in the buffer not in use
+  synchronized_store(m_pending, (schedule_t*) NULL);
+  schedule_t* schedule = &m_schedule[m_active == &m_schedule[0]];
+
+  // Insert the pulse end edges in time order; merge edges with the
+  // same time on the same port
+  uint8_t edges = 0;
+  memset(schedule->set, 0, sizeof(schedule->set));
+  for (uint8_t i = 0; i < m_count; i++) {
+    if (m_width[i] == 0) continue;
+    Board::DigitalPin pin = get_pin_at(i);
+    uint8_t mask = Pin::MASK(pin);
+    volatile uint8_t* port = m_port[m_channel_port[i]];
+    uint16_t ticks = m_width[i] * TICKS_PER_US;
+    schedule->set[m_channel_port[i]] |= mask;
+    uint8_t j = 0;
+    while (j < edges && schedule->edge[j].ticks < ticks) j++;
+    if (j < edges
+	&& schedule->edge[j].ticks == ticks
+	&& schedule->edge[j].port == port) {
+      schedule->edge[j].mask |= mask;
+      continue;
+    }
+    memmove(&schedule->edge[j + 1], &schedule->edge[j],
+	    (edges - j) * sizeof(edge_t));
+    schedule->edge[j].ticks = ticks;
+    schedule->edge[j].port = port;
+    schedule->edge[j].mask = mask;
+    edges += 1;
+  }
+  schedule->edges = edges;
+
+  // Hand over to the interrupt handler for the next frame
+  synchronized_store(m_pending, schedule);
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+  ServoSequencer* sequencer = ServoSequencer::s_sequencer;
+  ServoSequencer::schedule_t* schedule;
+  uint16_t start = sequencer->m_start;
+  uint8_t ix = sequencer->m_ix;
+
+  // Start of frame; switch schedule, wait for the exact tick and set
+  // the pins with a pulse
+  if (ix == ServoSequencer::FRAME_START) {
+    if (sequencer->m_pending != NULL) {
+      sequencer->m_active = sequencer->m_pending;
+      sequencer->m_pending = NULL;
+    }
+    schedule = sequencer->m_active;
+    while ((int16_t) (TCNT1 - start) < 0);
+    for (uint8_t i = 0; i < sequencer->m_ports; i++)
+      *sequencer->m_port[i] |= schedule->set[i];
+    ix = 0;
+  }
+  else {
+    schedule = sequencer->m_active;
+  }
+
+  // Clear the pins of the edges that are due; wait for the exact tick
+  // of each edge
+  while (ix < schedule->edges) {
+    ServoSequencer::edge_t* edge = &schedule->edge[ix];
+    uint16_t at = start + edge->ticks;
+    if ((int16_t) (at - TCNT1) > (int16_t) (2 * MARGIN_TICKS)) {
+      OCR1A = at - MARGIN_TICKS;
+      sequencer->m_ix = ix;
+      return;
+    }
+    while ((int16_t) (TCNT1 - at) < 0);
+    *edge->port &= ~edge->mask;
+    ix += 1;
+  }
+
+  // Schedule the next frame
+  start += FRAME_TICKS;
+  sequencer->m_start = start;
+  sequencer->m_ix = ServoSequencer::FRAME_START;
+  OCR1A = start - MARGIN_TICKS;
+}
+
+#endif
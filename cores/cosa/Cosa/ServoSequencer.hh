@@ -0,0 +1,221 @@
+/**
+ * @file Cosa/ServoSequencer.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_SERVO_SEQUENCER_HH
+#define COSA_SERVO_SEQUENCER_HH
+
+#include "Cosa/Types.h"
+#include "Cosa/Board.hh"
+
+/**
+ * Servo sequencer for up to CHANNEL_MAX servos on a single Timer1
+ * compare channel (A). All pulses start at the beginning of the 20 ms
+ * frame and end in pulse width order from a sorted edge schedule.
+ * The edges are scheduled with absolute compare values (no
+ * accumulated error) and the interrupt handler is woken slightly
+ * before each edge and waits for the exact timer tick. The edge
+ * jitter is one timer tick (0.5 us) when the interrupt latency
+ * (other interrupt handlers) is below the wakeup margin. Positions
+ * of several servos are updated atomically; the schedule is double
+ * buffered and activated at the start of the next frame.
+ * @code
+ * const Board::DigitalPin pins[] __PROGMEM = {
+ *   Board::D2, Board::D3, Board::D4, Board::D5
+ * };
+ * ServoSequencer servos(pins, membersof(pins));
+ * ...
+ * servos.begin();
+ * uint8_t angle[] = { 0, 45, 90, 180 };
+ * servos.set_angle(angle);
+ * @endcode
+ *
+ * @section Limitations
+ * Uses Timer1 compare match A and may not be used together with
+ * Servo, Tone, VWI, SoftPWM and AnalogSampler. The timer is run in
+ * normal mode with prescale 8 and may be shared with InputCapture
+ * (PRESCALE_8) when the capture is started first. Not available on
+ * ATtiny.
+ */
+class ServoSequencer {
+public:
+  /** Max number of servos (channels). */
+  static const uint8_t CHANNEL_MAX = 12;
+
+  /** Max number of ports. */
+  static const uint8_t PORT_MAX = 4;
+
+  /** Frame period (us). */
+  static const uint16_t PERIOD = 20000;
+
+  /** Default pulse width limits (us). */
+  static const uint16_t MIN_WIDTH = 650;
+  static const uint16_t MAX_WIDTH = 2300;
+
+  /** Interrupt handler wakeup margin before an edge (us). */
+  static const uint16_t MARGIN = 10;
+
+  /**
+   * Construct servo sequencer for the given vector and number of
+   * pins. The vector of pins should be defined in program memory
+   * using PROGMEM. Pins on more than PORT_MAX ports are ignored. The
+   * servos are initiated to 90 degree.
+   * @param[in] pins vector with digital pins.
+   * @param[in] count number of pins in vector (max CHANNEL_MAX).
+   */
+  ServoSequencer(const Board::DigitalPin* pins, uint8_t count);
+
+  /**
+   * Set pins to output mode and start the pulse generation. Returns
+   * true(1) if successful otherwise false(0).
+   * @return bool.
+   */
+  bool begin();
+
+  /**
+   * Stop the pulse generation.
+   */
+  void end();
+
+  /**
+   * Set pulse limits; min and max number of micro seconds. These
+   * will correspond to angle 0 and 180. Applied to following angle
+   * updates.
+   * @param[in] min number of micro seconds.
+   * @param[in] max number of micro seconds.
+   */
+  void set_pulse(uint16_t min, uint16_t max)
+    __attribute__((always_inline))
+  {
+    m_min = min;
+    m_max = max;
+  }
+
+  /**
+   * Set pulse width for the given servo in micro seconds. Zero(0)
+   * to disable the pulse. The width is limited to half the period.
+   * @param[in] ix servo index.
+   * @param[in] us pulse width.
+   */
+  void set_width(uint8_t ix, uint16_t us);
+
+  /**
+   * Return pulse width for the given servo in micro seconds.
+   * @param[in] ix servo index.
+   * @return pulse width.
+   */
+  uint16_t get_width(uint8_t ix) const
+  {
+    return (ix < m_count ? m_width[ix] : 0);
+  }
+
+  /**
+   * Set given servo to given angle degree.
+   * @param[in] ix servo index.
+   * @param[in] degree angle, 0..180.
+   */
+  void set_angle(uint8_t ix, uint8_t degree);
+
+  /**
+   * Set all servos to the given angles. The new positions are
+   * applied in the same frame.
+   * @param[in] degree vector with count angles, 0..180.
+   */
+  void set_angle(const uint8_t* degree);
+
+  /**
+   * Return angle of given servo.
+   * @param[in] ix servo index.
+   * @return angle in degree, 0..180.
+   */
+  uint8_t get_angle(uint8_t ix) const;
+
+  /**
+   * Get number of servos.
+   * @return servos.
+   */
+  uint8_t get_count() const
+  {
+    return (m_count);
+  }
+
+protected:
+  /** Timer ticks per micro-second (prescale 8). */
+  static const uint8_t TICKS_PER_US = I_CPU / 8;
+
+  /** Next edge index at the frame start. */
+  static const uint8_t FRAME_START = 0xff;
+
+  /** Pulse end edge. */
+  struct edge_t {
+    uint16_t ticks;		//!< Timer ticks from frame start.
+    volatile uint8_t* port;	//!< Port data register.
+    uint8_t mask;		//!< Port pins to clear.
+  };
+
+  /** Edge schedule. */
+  struct schedule_t {
+    uint8_t edges;		//!< Number of edges.
+    uint8_t set[PORT_MAX];	//!< Port bits set at frame start.
+    edge_t edge[CHANNEL_MAX];	//!< Edges in time order.
+  };
+
+  static ServoSequencer* s_sequencer;	//!< Active sequencer.
+  const Board::DigitalPin* m_pins;	//!< Pin vector (program memory).
+  uint8_t m_count;			//!< Number of servos.
+  uint8_t m_ports;			//!< Number of ports.
+  volatile uint8_t* m_port[PORT_MAX];	//!< Port data registers.
+  uint8_t m_channel_port[CHANNEL_MAX];	//!< Servo port index.
+  uint16_t m_width[CHANNEL_MAX];	//!< Servo pulse width (us).
+  uint16_t m_min;			//!< Pulse width at 0 degree.
+  uint16_t m_max;			//!< Pulse width at 180 degree.
+  uint16_t m_start;			//!< Frame start (timer ticks).
+  uint8_t m_ix;				//!< Next edge index (interrupt).
+  schedule_t* m_active;			//!< Active schedule (interrupt).
+  schedule_t* volatile m_pending;	//!< Updated schedule.
+  schedule_t m_schedule[2];		//!< Double buffered schedules.
+
+  /**
+   * Get pin for the given servo.
+   * @param[in] ix servo index.
+   * @return pin number.
+   */
+  Board::DigitalPin get_pin_at(uint8_t ix) const
+  {
+    return ((Board::DigitalPin) pgm_read_byte(&m_pins[ix]));
+  }
+
+  /**
+   * Map angle to pulse width.
+   * @param[in] degree angle, 0..180.
+   * @return pulse width.
+   */
+  uint16_t width(uint8_t degree) const;
+
+  /**
+   * Recalculate the edge schedule from the pulse widths and activate
+   * at the start of the next frame.
+   */
+  void update();
+
+  /** Interrupt Service Routine is a friend. */
+  friend void TIMER1_COMPA_vect(void);
+};
+
+#endif
@@ -0,0 +1,457 @@
+/**
+ * @file Cosa/Soft/FastSPI.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_SOFT_FASTSPI_HH
+#define COSA_SOFT_FASTSPI_HH
+
+#include "Cosa/Types.h"
+#include "Cosa/Pin.hh"
+#include "Cosa/Soft/SPI.hh"
+
+namespace Soft {
+
+  /**
+   * Soft Serial Peripheral Interface (SPI) device class with the bus
+   * pins as template parameters. The pin registers and masks are
+   * compile-time constants and each clock edge and data bit is
+   * reduced to single port instructions (sbi/cbi/sbic). The byte
+   * transfer loops are fully unrolled. The interface is the same as
+   * Soft::SPI but the bus state is shared (static) by all instances
+   * with the same pins. The clock, order and pulse settings are the
+   * Soft::SPI enumerations. Typical usage:
+   * @code
+   * typedef Soft::FastSPI<Board::D5, Board::D6, Board::D7> BUS;
+   * BUS bus;
+   * class Device : public BUS::Driver { ... };
+   * @endcode
+   * @param[in] MOSI Master Output Slave Input pin.
+   * @param[in] MISO Master Input Slave Output pin.
+   * @param[in] SCK Serial Clock pin.
+   */
+  template<Board::DigitalPin MOSI,
+	   Board::DigitalPin MISO,
+	   Board::DigitalPin SCK>
+  class FastSPI {
+  public:
+    /**
+     * SPI device driver class. Holds device chip select, clock mode
+     * and bit order. The driver is attached to the bus on construction.
+     */
+    class Driver {
+      friend class FastSPI;
+    public:
+      /**
+       * Construct SPI Device driver with given chip select pin, pulse,
+       * clock, mode, and bit order. The clock rate is not used; the
+       * bus runs at the maximum bit-bang rate.
+       * @param[in] cs chip select pin.
+       * @param[in] pulse chip select pulse mode (default ACTIVE_LOW).
+       * @param[in] clock SPI hardware setting (default DIV4_CLOCK).
+       * @param[in] mode SPI mode for phase and transition (0..3, default 0).
+       * @param[in] order bit order (default MSB_ORDER).
+       * @param[in] irq interrupt handler (default null).
+       */
+      Driver(Board::DigitalPin cs,
+	     SPI::Pulse pulse = SPI::DEFAULT_PULSE,
+	     SPI::Clock clock = SPI::DEFAULT_CLOCK,
+	     uint8_t mode = 0,
+	     SPI::Order order = SPI::MSB_ORDER,
+	     Interrupt::Handler* irq = NULL) :
+	m_next(s_list),
+	m_irq(irq),
+	m_cs(cs, (pulse == 0)),
+	m_pulse(pulse),
+	m_mode(mode),
+	m_order(order)
+      {
+	UNUSED(clock);
+	s_list = this;
+      }
+
+    protected:
+      Driver* m_next;		//!< List of drivers.
+      Interrupt::Handler* m_irq;//!< Interrupt handler.
+      OutputPin m_cs;		//!< Device chip select pin.
+      SPI::Pulse m_pulse;	//!< Chip select pulse mode.
+      uint8_t m_mode;		//!< Mode for phase and transition.
+      SPI::Order m_order;	//!< Data direction; bit order.
+      uint8_t m_data;		//!< Data to transfer.
+    };
+
+  public:
+    /**
+     * Construct soft serial peripheral interface master. Initiate
+     * the bus pins; MOSI and SCK output (low), MISO input.
+     */
+    FastSPI()
+    {
+      synchronized {
+	*Pin::DDR(MOSI) |= Pin::MASK(MOSI);
+	*Pin::PORT(MOSI) &= ~Pin::MASK(MOSI);
+	*Pin::DDR(SCK) |= Pin::MASK(SCK);
+	*Pin::PORT(SCK) &= ~Pin::MASK(SCK);
+	*Pin::DDR(MISO) &= ~Pin::MASK(MISO);
+      }
+    }
+
+    /**
+     * Acquire the SPI device driver. Set the clock polarity and
+     * disable interrupt sources on the bus. The function will yield
+     * until the device driver has been acquired. See Soft::SPI.
+     * @param[in] dev device driver context.
+     */
+    void acquire(Driver* dev)
+    {
+      // Acquire the device driver. Wait if busy. Synchronized update
+      uint8_t key = lock();
+      while (s_busy) {
+	unlock(key);
+	yield();
+	key = lock();
+      }
+      // Set current device and mark as busy
+      s_busy = true;
+      s_dev = dev;
+      // Set clock polarity
+      if (dev->m_mode & 0x02)
+	*Pin::PORT(SCK) |= Pin::MASK(SCK);
+      else
+	*Pin::PORT(SCK) &= ~Pin::MASK(SCK);
+      // Disable all interrupt sources on SPI bus
+      for (Driver* dp = s_list; dp != NULL; dp = dp->m_next)
+	if (dp->m_irq != NULL) dp->m_irq->disable();
+      unlock(key);
+    }
+
+    /**
+     * Release the SPI device driver. Enable SPI interrupt sources.
+     */
+    void release()
+    {
+      uint8_t key = lock();
+      s_busy = false;
+      s_dev = NULL;
+      for (Driver* dp = s_list; dp != NULL; dp = dp->m_next)
+	if (dp->m_irq != NULL) dp->m_irq->enable();
+      unlock(key);
+    }
+
+    /**
+     * Mark the beginning of a transfer block. Select the device by
+     * asserting the chip select pin according to the pulse pattern.
+     */
+    void begin()
+      __attribute__((always_inline))
+    {
+      if (s_dev->m_pulse < SPI::PULSE_LOW) s_dev->m_cs.toggle();
+    }
+
+    /**
+     * Mark the end of a transfer block. Deselect the device chip
+     * according to the pulse pattern.
+     */
+    void end()
+      __attribute__((always_inline))
+    {
+      s_dev->m_cs.toggle();
+      if (s_dev->m_pulse > SPI::ACTIVE_HIGH) s_dev->m_cs.toggle();
+    }
+
+    /**
+     * Start exchange data with slave. Should only be used within a SPI
+     * transaction; begin()-end() block.
+     * @param[in] data to send.
+     */
+    void transfer_start(uint8_t data)
+      __attribute__((always_inline))
+    {
+      s_dev->m_data = data;
+    }
+
+    /**
+     * Wait for exchange with slave. Should only be used within a SPI
+     * transaction; begin()-end() block. Return received value.
+     * @return value received.
+     */
+    uint8_t transfer_await()
+      __attribute__((always_inline))
+    {
+      return (transfer(s_dev->m_data));
+    }
+
+    /**
+     * Next data to exchange with slave. Should only be used within a SPI
+     * transaction; begin()-end() block.
+     * @param[in] data to send.
+     * @return value received.
+     */
+    uint8_t transfer_next(uint8_t data)
+      __attribute__((always_inline))
+    {
+      uint8_t res = transfer_await();
+      transfer_start(data);
+      return (res);
+    }
+
+    /**
+     * Exchange data with slave. Should only be used within a SPI
+     * transaction; begin()-end() block.
+     * @param[in] data to send.
+     * @return value received.
+     */
+    uint8_t transfer(uint8_t data)
+    {
+      if (s_dev->m_order == SPI::MSB_ORDER) return (exchange_msb(data));
+      return (exchange_lsb(data));
+    }
+
+    /**
+     * Exchange package with slave. Received data from slave is stored
+     * in given buffer. Should only be used within a SPI transfer;
+     * begin()-end() block.
+     * @param[in] buf with data to transfer (send/receive).
+     * @param[in] count size of buffer.
+     */
+    void transfer(void* buf, size_t count)
+    {
+      transfer(buf, buf, count);
+    }
+
+    /**
+     * Exchange package with slave. Received data from slave is stored
+     * in given destination buffer. Should only be used within a SPI
+     * transfer; begin()-end() block.
+     * @param[in] dst destination buffer for received data.
+     * @param[in] src source buffer with data to send.
+     * @param[in] count size of buffers.
+     */
+    void transfer(void* dst, const void* src, size_t count)
+    {
+      if (count == 0) return;
+      uint8_t* dp = (uint8_t*) dst;
+      const uint8_t* sp = (const uint8_t*) src;
+      if (s_dev->m_order == SPI::MSB_ORDER)
+	do *dp++ = exchange_msb(*sp++); while (--count);
+      else
+	do *dp++ = exchange_lsb(*sp++); while (--count);
+    }
+
+    /**
+     * Read package from the device slave. Should only be used within a
+     * SPI transfer; begin()-end() block.
+     * @param[in] buf buffer for read data.
+     * @param[in] count number of bytes to read.
+     */
+    void read(void* buf, size_t count)
+    {
+      if (count == 0) return;
+      uint8_t* bp = (uint8_t*) buf;
+      if (s_dev->m_order == SPI::MSB_ORDER)
+	do *bp++ = exchange_msb(0x00); while (--count);
+      else
+	do *bp++ = exchange_lsb(0x00); while (--count);
+    }
+
+    /**
+     * Write package to the device slave. Should only be used within a
+     * SPI transaction; begin()-end() block. The slave output is not
+     * sampled.
+     * @param[in] buf buffer with data to write.
+     * @param[in] count number of bytes to write.
+     */
+    void write(const void* buf, size_t count)
+    {
+      if (count == 0) return;
+      const uint8_t* bp = (const uint8_t*) buf;
+      if (s_dev->m_order == SPI::MSB_ORDER)
+	do send_msb(*bp++); while (--count);
+      else
+	do send_lsb(*bp++); while (--count);
+    }
+
+    /**
+     * Write package to the device slave. Should only be used within a
+     * SPI transaction; begin()-end() block.
+     * @param[in] buf buffer with data to write.
+     * @param[in] count number of bytes to write.
+     */
+    void write_P(const uint8_t* buf, size_t count)
+    {
+      if (count == 0) return;
+      if (s_dev->m_order == SPI::MSB_ORDER)
+	do send_msb(pgm_read_byte(buf++)); while (--count);
+      else
+	do send_lsb(pgm_read_byte(buf++)); while (--count);
+    }
+
+    /**
+     * Write null terminated io buffer vector to the device slave.
+     * Should only be used  within a SPI transfer; begin()-end() block.
+     * @param[in] vec null terminated io buffer vector pointer.
+     */
+    void write(const iovec_t* vec)
+      __attribute__((always_inline))
+    {
+      for (const iovec_t* vp = vec; vp->buf != NULL; vp++)
+	write(vp->buf, vp->size);
+    }
+
+  private:
+    static Driver* s_list;	//!< Attached devices interrupt disable/enable.
+    static volatile bool s_busy;//!< SPI resource is busy.
+    static Driver* s_dev;	//!< Current device using the SPI pins.
+
+    /**
+     * Clock a single bit; set data output, toggle clock, sample data
+     * input and toggle clock. The data output is written with sbi/cbi
+     * and the clock is toggled by writing to the PIN register.
+     * @param[in] value data to send.
+     * @param[in,out] res data received.
+     * @param[in] mask bit to send and receive.
+     */
+    static void exchange_bit(uint8_t value, uint8_t& res, uint8_t mask)
+      __attribute__((always_inline))
+    {
+      if (value & mask)
+	*Pin::PORT(MOSI) |= Pin::MASK(MOSI);
+      else
+	*Pin::PORT(MOSI) &= ~Pin::MASK(MOSI);
+      *Pin::PIN(SCK) = Pin::MASK(SCK);
+      if (*Pin::PIN(MISO) & Pin::MASK(MISO)) res |= mask;
+      *Pin::PIN(SCK) = Pin::MASK(SCK);
+    }
+
+    /**
+     * Clock a single bit without sampling the data input.
+     * @param[in] value data to send.
+     * @param[in] mask bit to send.
+     */
+    static void send_bit(uint8_t value, uint8_t mask)
+      __attribute__((always_inline))
+    {
+      if (value & mask)
+	*Pin::PORT(MOSI) |= Pin::MASK(MOSI);
+      else
+	*Pin::PORT(MOSI) &= ~Pin::MASK(MOSI);
+      *Pin::PIN(SCK) = Pin::MASK(SCK);
+      *Pin::PIN(SCK) = Pin::MASK(SCK);
+    }
+
+    /**
+     * Exchange byte, most significant bit first. Unrolled.
+     * @param[in] value data to send.
+     * @return value received.
+     */
+    static uint8_t exchange_msb(uint8_t value)
+      __attribute__((always_inline))
+    {
+      uint8_t res = 0;
+      synchronized {
+	exchange_bit(value, res, 0x80);
+	exchange_bit(value, res, 0x40);
+	exchange_bit(value, res, 0x20);
+	exchange_bit(value, res, 0x10);
+	exchange_bit(value, res, 0x08);
+	exchange_bit(value, res, 0x04);
+	exchange_bit(value, res, 0x02);
+	exchange_bit(value, res, 0x01);
+      }
+      return (res);
+    }
+
+    /**
+     * Exchange byte, least significant bit first. Unrolled.
+     * @param[in] value data to send.
+     * @return value received.
+     */
+    static uint8_t exchange_lsb(uint8_t value)
+      __attribute__((always_inline))
+    {
+      uint8_t res = 0;
+      synchronized {
+	exchange_bit(value, res, 0x01);
+	exchange_bit(value, res, 0x02);
+	exchange_bit(value, res, 0x04);
+	exchange_bit(value, res, 0x08);
+	exchange_bit(value, res, 0x10);
+	exchange_bit(value, res, 0x20);
+	exchange_bit(value, res, 0x40);
+	exchange_bit(value, res, 0x80);
+      }
+      return (res);
+    }
+
+    /**
+     * Send byte, most significant bit first. Unrolled.
+     * @param[in] value data to send.
+     */
+    static void send_msb(uint8_t value)
+      __attribute__((always_inline))
+    {
+      synchronized {
+	send_bit(value, 0x80);
+	send_bit(value, 0x40);
+	send_bit(value, 0x20);
+	send_bit(value, 0x10);
+	send_bit(value, 0x08);
+	send_bit(value, 0x04);
+	send_bit(value, 0x02);
+	send_bit(value, 0x01);
+      }
+    }
+
+    /**
+     * Send byte, least significant bit first. Unrolled.
+     * @param[in] value data to send.
+     */
+    static void send_lsb(uint8_t value)
+      __attribute__((always_inline))
+    {
+      synchronized {
+	send_bit(value, 0x01);
+	send_bit(value, 0x02);
+	send_bit(value, 0x04);
+	send_bit(value, 0x08);
+	send_bit(value, 0x10);
+	send_bit(value, 0x20);
+	send_bit(value, 0x40);
+	send_bit(value, 0x80);
+      }
+    }
+  };
+
+  template<Board::DigitalPin MOSI,
+	   Board::DigitalPin MISO,
+	   Board::DigitalPin SCK>
+  typename FastSPI<MOSI, MISO, SCK>::Driver*
+  FastSPI<MOSI, MISO, SCK>::s_list = NULL;
+
+  template<Board::DigitalPin MOSI,
+	   Board::DigitalPin MISO,
+	   Board::DigitalPin SCK>
+  volatile bool FastSPI<MOSI, MISO, SCK>::s_busy = false;
+
+  template<Board::DigitalPin MOSI,
+	   Board::DigitalPin MISO,
+	   Board::DigitalPin SCK>
+  typename FastSPI<MOSI, MISO, SCK>::Driver*
+  FastSPI<MOSI, MISO, SCK>::s_dev = NULL;
+};
+#endif
@@ -0,0 +1,216 @@
+/**
+ * @file Cosa/SoftPWM.cpp
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/SoftPWM.hh"
+
+#if !defined(BOARD_ATTINY)
+
+#include "Cosa/Pin.hh"
+
+SoftPWM* SoftPWM::s_pwm = NULL;
+
+SoftPWM::SoftPWM(const Board::DigitalPin* pins, uint8_t count) :
+  m_pins(pins),
+  m_count(0),
+  m_ports(0),
+  m_ticks(0),
+  m_ix(0),
+  m_active(&m_schedule[0]),
+  m_pending(NULL)
+{
+  // Map channels to ports; ignore pins on too many ports
+  if (count > CHANNEL_MAX) count = CHANNEL_MAX;
+  for (uint8_t i = 0; i < count; i++) {
+    Board::DigitalPin pin = get_pin_at(i);
+    volatile uint8_t* port = Pin::PORT(pin);
+    uint8_t ix = 0;
+    while (ix < m_ports && m_port[ix] != port) ix++;
+    if (ix == m_ports) {
+      if (m_ports == PORT_MAX) break;
+      m_port[ix] = port;
+      m_port_mask[ix] = 0;
+      m_ports += 1;
+    }
+    m_port_mask[ix] |= Pin::MASK(pin);
+    m_channel_port[i] = ix;
+    m_duty[i] = 0;
+    m_count += 1;
+  }
+}
+
+bool
+SoftPWM::begin(uint16_t freq)
+{
+  if (freq == 0 || m_count == 0) return (false);
+
+  // Calculate timer prescale and ticks per duty step; the period
+  // (DUTY_MAX steps) should fit the timer and a duty step should be
+  // longer than the interrupt handler
+  static const uint8_t PRESCALE_MAX = 5;
+  static const uint8_t shift[PRESCALE_MAX] = { 0, 3, 6, 8, 10 };
+  uint32_t cycles = F_CPU / ((uint32_t) freq * DUTY_MAX);
+  uint8_t cs = 0;
+  while (((cycles >> shift[cs]) * DUTY_MAX) > 0xffffUL
+	 && cs < PRESCALE_MAX - 1) cs++;
+  uint16_t ticks = (cycles >> shift[cs]);
+  if (((uint32_t) ticks << shift[cs]) < ISR_CYCLES) return (false);
+
+  synchronized {
+    if (s_pwm != NULL) synchronized_return (false);
+    s_pwm = this;
+    m_ticks = ticks;
+  }
+
+  // Clear pins and set output mode
+  for (uint8_t i = 0; i < m_count; i++) {
+    Board::DigitalPin pin = get_pin_at(i);
+    synchronized {
+      *Pin::PORT(pin) &= ~Pin::MASK(pin);
+      *Pin::DDR(pin) |= Pin::MASK(pin);
+    }
+  }
+
+  // Calculate the schedule and start with the period
+  m_pending = NULL;
+  update();
+  synchronized {
+    m_active = m_pending;
+    m_pending = NULL;
+    m_ix = 0;
+    TCCR1A = 0;
+    TCCR1B = 0;
+    TCNT1 = 0;
+    OCR1A = m_ticks - 1;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 |= _BV(OCIE1A);
+    TCCR1B = _BV(WGM12) | (cs + 1);
+  }
+  return (true);
+}
+
+void
+SoftPWM::end()
+{
+  if (s_pwm != this) return;
+  synchronized {
+    TCCR1B = 0;
+    TIMSK1 &= ~_BV(OCIE1A);
+    for (uint8_t i = 0; i < m_ports; i++)
+      *m_port[i] &= ~m_port_mask[i];
+    s_pwm = NULL;
+  }
+}
+
+void
+SoftPWM::set(uint8_t ix, uint8_t duty)
+{
+  if (ix >= m_count || m_duty[ix] == duty) return;
+  m_duty[ix] = duty;
+  if (s_pwm == this) update();
+}
+
+void
+SoftPWM::set(const uint8_t* duty)
+{
+  for (uint8_t i = 0; i < m_count; i++) m_duty[i] = duty[i];
+  if (s_pwm == this) update();
+}
+
+void
+SoftPWM::update()
+{
+  // Withdraw pending schedule and use the inactive buffer
+  synchronized_store(m_pending, (schedule_t*) NULL);
+  schedule_t* schedule = &m_schedule[m_active == &m_schedule[0]];
+
+  // Sort the channels with clear edges in duty order
+  uint8_t order[CHANNEL_MAX];
+  uint8_t count = 0;
+  memset(schedule->set, 0, sizeof(schedule->set));
+  for (uint8_t i = 0; i < m_count; i++) {
+    uint8_t duty = m_duty[i];
+    if (duty == 0) continue;
+    schedule->set[m_channel_port[i]] |= Pin::MASK(get_pin_at(i));
+    if (duty == DUTY_MAX) continue;
+    uint8_t j = count++;
+    while (j > 0 && m_duty[order[j - 1]] > duty) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = i;
+  }
+
+  // Merge channels with the same duty into a single edge
+  uint8_t edges = 0;
+  uint8_t prev = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t ch = order[i];
+    uint8_t duty = m_duty[ch];
+    if (edges == 0 || duty != prev) {
+      memset(schedule->clear[edges], 0, PORT_MAX);
+      schedule->delta[edges] = (duty - prev) * m_ticks;
+      prev = duty;
+      edges += 1;
+    }
+    uint8_t mask = Pin::MASK(get_pin_at(ch));
+    schedule->clear[edges - 1][m_channel_port[ch]] |= mask;
+  }
+  schedule->delta[edges] = (DUTY_MAX - prev) * m_ticks;
+  schedule->edges = edges;
+
+  // Activate at the start of the next period
+  synchronized_store(m_pending, schedule);
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+  SoftPWM* pwm = SoftPWM::s_pwm;
+  uint8_t ix = pwm->m_ix;
+  SoftPWM::schedule_t* schedule;
+
+  // Start of period; switch schedule and set pins with duty
+  if (ix == 0) {
+    if (pwm->m_pending != NULL) {
+      pwm->m_active = pwm->m_pending;
+      pwm->m_pending = NULL;
+    }
+    schedule = pwm->m_active;
+    for (uint8_t i = 0; i < pwm->m_ports; i++) {
+      volatile uint8_t* port = pwm->m_port[i];
+      *port = (*port & ~pwm->m_port_mask[i]) | schedule->set[i];
+    }
+  }
+
+  // Clear edge; clear pins with the edge duty
+  else {
+    schedule = pwm->m_active;
+    const uint8_t* clear = schedule->clear[ix - 1];
+    for (uint8_t i = 0; i < pwm->m_ports; i++) {
+      uint8_t mask = clear[i];
+      if (mask != 0) *pwm->m_port[i] &= ~mask;
+    }
+  }
+
+  // Time to the next edge (CTC period is top + 1)
+  OCR1A = schedule->delta[ix] - 1;
+  pwm->m_ix = (ix == schedule->edges) ? 0 : ix + 1;
+}
+
+#endif
@@ -0,0 +1,174 @@
+/**
+ * @file Cosa/SoftPWM.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_SOFT_PWM_HH
+#define COSA_SOFT_PWM_HH
+
+#include "Cosa/Types.h"
+#include "Cosa/Board.hh"
+
+/**
+ * Software PWM for up to CHANNEL_MAX pins with 8-bit resolution. The
+ * pins are grouped per port and all pins with a duty are set at the
+ * start of the period. The pins are cleared in duty order from an
+ * edge schedule; one Timer1 compare match interrupt per distinct duty
+ * value and a single port write per port at each edge. The schedule
+ * is recalculated (double buffered) only when a duty is changed and
+ * is activated at the start of the next period.
+ * @code
+ * const Board::DigitalPin pins[] __PROGMEM = {
+ *   Board::D2, Board::D3, Board::D4, Board::D5
+ * };
+ * SoftPWM pwm(pins, membersof(pins));
+ * ...
+ * pwm.begin(200);
+ * pwm.set(0, 128);
+ * @endcode
+ *
+ * @section Limitations
+ * Uses Timer1 and may not be used together with other modules that
+ * use Timer1 (e.g. Servo, Tone, VWI and AnalogSampler). Not available
+ * on ATtiny. The interrupt handler time limits the frequency; the
+ * time between edges (one duty step) is F_CPU / (frequency * 255)
+ * cycles, i.e. 313 cycles at 200 Hz and 16 MHz, and must be at least
+ * ISR_CYCLES. Non-atomic updates
+ * of other pins on the same ports (e.g. ports above the bit
+ * addressable I/O space) should be synchronized.
+ */
+class SoftPWM {
+public:
+  /** Max number of channels (pins). */
+  static const uint8_t CHANNEL_MAX = 16;
+
+  /** Max number of ports. */
+  static const uint8_t PORT_MAX = 4;
+
+  /** Max duty; continuously set. */
+  static const uint8_t DUTY_MAX = 255;
+
+  /**
+   * Max interrupt handler cycles per edge; PORT_MAX ports including
+   * entry and exit. A duty step shorter than this would pass the
+   * compare value and wrap the timer. See CosaBenchmarkSoftPWM.
+   */
+  static const uint16_t ISR_CYCLES = 200;
+
+  /**
+   * Construct software PWM for the given vector and number of
+   * pins. The vector of pins should be defined in program memory
+   * using PROGMEM. Pins on more than PORT_MAX ports are ignored.
+   * @param[in] pins vector with digital pins.
+   * @param[in] count number of pins in vector (max CHANNEL_MAX).
+   */
+  SoftPWM(const Board::DigitalPin* pins, uint8_t count);
+
+  /**
+   * Set pins to output mode and start the pulse generation with the
+   * given frequency. Returns true(1) if successful otherwise false(0);
+   * Timer1 is in use or the duty step is shorter than ISR_CYCLES.
+   * @param[in] freq period frequency in Hz (default 200 Hz).
+   * @return bool.
+   */
+  bool begin(uint16_t freq = 200);
+
+  /**
+   * Stop the pulse generation and clear the pins.
+   */
+  void end();
+
+  /**
+   * Set duty for the given channel (0..DUTY_MAX); zero(0) for off
+   * and DUTY_MAX for on. The schedule is recalculated if the duty is
+   * changed.
+   * @param[in] ix channel index.
+   * @param[in] duty cycle.
+   */
+  void set(uint8_t ix, uint8_t duty);
+
+  /**
+   * Set duty for all channels from the given vector and recalculate
+   * the schedule.
+   * @param[in] duty vector with count duty cycles.
+   */
+  void set(const uint8_t* duty);
+
+  /**
+   * Get duty for the given channel.
+   * @param[in] ix channel index.
+   * @return duty cycle.
+   */
+  uint8_t get(uint8_t ix) const
+  {
+    return (ix < m_count ? m_duty[ix] : 0);
+  }
+
+  /**
+   * Get number of channels.
+   * @return channels.
+   */
+  uint8_t get_count() const
+  {
+    return (m_count);
+  }
+
+protected:
+  /** Edge schedule. */
+  struct schedule_t {
+    uint8_t edges;			//!< Number of clear edges.
+    uint8_t set[PORT_MAX];		//!< Port bits set at period start.
+    uint8_t clear[CHANNEL_MAX][PORT_MAX]; //!< Port bits cleared per edge.
+    uint16_t delta[CHANNEL_MAX + 1];	//!< Timer ticks to next edge.
+  };
+
+  static SoftPWM* s_pwm;		//!< Active software PWM.
+  const Board::DigitalPin* m_pins;	//!< Pin vector (program memory).
+  uint8_t m_count;			//!< Number of channels.
+  uint8_t m_ports;			//!< Number of ports.
+  volatile uint8_t* m_port[PORT_MAX];	//!< Port data registers.
+  uint8_t m_port_mask[PORT_MAX];	//!< Port pins.
+  uint8_t m_channel_port[CHANNEL_MAX];	//!< Channel port index.
+  uint8_t m_duty[CHANNEL_MAX];		//!< Channel duty.
+  uint16_t m_ticks;			//!< Timer ticks per duty step.
+  uint8_t m_ix;				//!< Next edge index (interrupt).
+  schedule_t* m_active;			//!< Active schedule (interrupt).
+  schedule_t* volatile m_pending;	//!< Updated schedule.
+  schedule_t m_schedule[2];		//!< Double buffered schedules.
+
+  /**
+   * Get pin for the given channel.
+   * @param[in] ix channel index.
+   * @return pin number.
+   */
+  Board::DigitalPin get_pin_at(uint8_t ix) const
+  {
+    return ((Board::DigitalPin) pgm_read_byte(&m_pins[ix]));
+  }
+
+  /**
+   * Recalculate the edge schedule from the channel duties and
+   * activate at the start of the next period.
+   */
+  void update();
+
+  /** Interrupt Service Routine is a friend. */
+  friend void TIMER1_COMPA_vect(void);
+};
+
+#endif
@@ -0,0 +1,294 @@
+/**
+ * @file Cosa/Synth.cpp
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/Synth.hh"
+
+#if !defined(BOARD_ATTINY)
+
+#include "Cosa/Note.hh"
+
+// Timer1 compare output pins (see Tone)
+#if defined (__AVR_ATmega32U4__)		\
+  || defined(__AVR_ATmega640__)			\
+  || defined(__AVR_ATmega1280__)		\
+  || defined(__AVR_ATmega1281__)		\
+  || defined(__AVR_ATmega2560__)		\
+  || defined(__AVR_ATmega2561__)
+#define PWM1 DDB5
+#define PWM2 DDB6
+#define DDR DDRB
+#define PORT PORTB
+#elif defined(__AVR_ATmega1284P__)		\
+  || defined(__AVR_ATmega644__)			\
+  || defined(__AVR_ATmega644P__)
+#define PWM1 DDD4
+#define PWM2 DDD5
+#define DDR DDRD
+#define PORT PORTD
+#elif defined(__AVR_ATmega256RFR2__)
+#define PWM1 DDRB5
+#define PWM2 DDRB6
+#define DDR DDRB
+#define PORT PORTB
+#else
+#define PWM1 DDB1
+#define PWM2 DDB2
+#define DDR DDRB
+#define PORT PORTB
+#endif
+
+const int8_t Synth::SINE[] __PROGMEM = {
+  0, 3, 6, 9, 12, 16, 19, 22, 25, 28, 31, 34,
+  37, 40, 43, 46, 49, 51, 54, 57, 60, 63, 65, 68,
+  71, 73, 76, 78, 81, 83, 85, 88, 90, 92, 94, 96,
+  98, 100, 102, 104, 106, 107, 109, 111, 112, 113, 115, 116,
+  117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126, 126,
+  126, 127, 127, 127, 127, 127, 127, 127, 126, 126, 126, 125,
+  125, 124, 123, 122, 122, 121, 120, 118, 117, 116, 115, 113,
+  112, 111, 109, 107, 106, 104, 102, 100, 98, 96, 94, 92,
+  90, 88, 85, 83, 81, 78, 76, 73, 71, 68, 65, 63,
+  60, 57, 54, 51, 49, 46, 43, 40, 37, 34, 31, 28,
+  25, 22, 19, 16, 12, 9, 6, 3, 0, -3, -6, -9,
+  -12, -16, -19, -22, -25, -28, -31, -34, -37, -40, -43, -46,
+  -49, -51, -54, -57, -60, -63, -65, -68, -71, -73, -76, -78,
+  -81, -83, -85, -88, -90, -92, -94, -96, -98, -100, -102, -104,
+  -106, -107, -109, -111, -112, -113, -115, -116, -117, -118, -120, -121,
+  -122, -122, -123, -124, -125, -125, -126, -126, -126, -127, -127, -127,
+  -127, -127, -127, -127, -126, -126, -126, -125, -125, -124, -123, -122,
+  -122, -121, -120, -118, -117, -116, -115, -113, -112, -111, -109, -107,
+  -106, -104, -102, -100, -98, -96, -94, -92, -90, -88, -85, -83,
+  -81, -78, -76, -73, -71, -68, -65, -63, -60, -57, -54, -51,
+  -49, -46, -43, -40, -37, -34, -31, -28, -25, -22, -19, -16,
+  -12, -9, -6, -3
+};
+
+Synth* Synth::s_synth = NULL;
+
+Synth::Synth(const int8_t* wave) :
+  m_wave(wave),
+  m_voices(0),
+  m_tick(CONTROL_DIV),
+  m_mid(0),
+  m_shift(0),
+  m_scale(0),
+  m_control_rate(0),
+  m_attack(0),
+  m_decay(0),
+  m_sustain(255),
+  m_release(0)
+{
+  memset(m_voice, 0, sizeof(m_voice));
+}
+
+bool
+Synth::begin(uint16_t rate, uint8_t voices)
+{
+  // Check sample rate; fast PWM period should be at least 8-bit
+  if (rate < 1000 || rate > (F_CPU / 256)) return (false);
+  if (voices == 0 || voices > VOICE_MAX) return (false);
+  synchronized {
+    if (s_synth != NULL) synchronized_return (false);
+    s_synth = this;
+  }
+
+  // Output level and scale so that all voices fit in the period
+  uint16_t top = (F_CPU / rate) - 1;
+  m_mid = (top + 1) / 2;
+  m_shift = 0;
+  while (((voices * 127U) >> m_shift) >= m_mid) m_shift++;
+  m_scale = (65536UL * 256) / rate;
+  m_control_rate = rate / CONTROL_DIV;
+  m_voices = voices;
+  m_tick = CONTROL_DIV;
+
+  // Timer1 in fast PWM mode with ICR1 as top; push/pull output
+  synchronized {
+    DDR |= (_BV(PWM1) | _BV(PWM2));
+    TCCR1B = 0;
+    TCNT1 = 0;
+    ICR1 = top;
+    OCR1A = m_mid;
+    OCR1B = m_mid;
+    TCCR1A = (_BV(COM1A1) | _BV(COM1B1) | _BV(COM1B0) | _BV(WGM11));
+    TCCR1B = (_BV(WGM13) | _BV(WGM12) | _BV(CS10));
+    TIFR1 = _BV(TOV1);
+    TIMSK1 |= _BV(TOIE1);
+  }
+  return (true);
+}
+
+void
+Synth::end()
+{
+  if (s_synth != this) return;
+  synchronized {
+    TIMSK1 &= ~_BV(TOIE1);
+    TCCR1A = 0;
+    TCCR1B = 0;
+    PORT &= ~(_BV(PWM1) | _BV(PWM2));
+    s_synth = NULL;
+  }
+}
+
+void
+Synth::set_envelope(uint8_t attack, uint8_t decay,
+		    uint8_t sustain, uint8_t release)
+{
+  synchronized {
+    m_attack = attack;
+    m_decay = decay;
+    m_sustain = sustain;
+    m_release = release;
+  }
+}
+
+void
+Synth::note_on(uint8_t voice, uint16_t freq)
+{
+  if (voice >= VOICE_MAX) return;
+  uint16_t inc = step(freq);
+  voice_t* v = &m_voice[voice];
+  synchronized {
+    v->step = inc;
+    v->state = ATTACK;
+  }
+}
+
+void
+Synth::note_off(uint8_t voice)
+{
+  if (voice >= VOICE_MAX) return;
+  voice_t* v = &m_voice[voice];
+  synchronized {
+    v->notes = NULL;
+    if (v->state != IDLE) v->state = RELEASE;
+  }
+}
+
+void
+Synth::play(uint8_t voice, const uint16_t* notes, uint16_t ms)
+{
+  if (voice >= VOICE_MAX) return;
+  uint16_t length = ((uint32_t) ms * m_control_rate) / 1000;
+  if (length == 0) length = 1;
+  voice_t* v = &m_voice[voice];
+  synchronized {
+    v->notes = notes;
+    v->length = length;
+    v->gate = length / 4;
+    v->remaining = 1;
+  }
+}
+
+bool
+Synth::is_active(uint8_t voice) const
+{
+  if (voice >= VOICE_MAX) return (false);
+  const voice_t* v = &m_voice[voice];
+  bool res;
+  synchronized res = (v->notes != NULL || v->state != IDLE);
+  return (res);
+}
+
+void
+Synth::on_control()
+{
+  voice_t* v = m_voice;
+  for (uint8_t i = 0; i < m_voices; i++, v++) {
+    // Step note sequence; release at gate and next note at end
+    if (v->notes != NULL) {
+      uint16_t remaining = --v->remaining;
+      if (remaining == 0) {
+	uint16_t freq = pgm_read_word(v->notes);
+	if (freq == Note::END) {
+	  v->notes = NULL;
+	}
+	else {
+	  v->notes += 1;
+	  v->remaining = v->length;
+	  if (freq != Note::PAUSE) {
+	    v->step = step(freq);
+	    v->state = ATTACK;
+	  }
+	}
+      }
+      else if (remaining == v->gate && v->state != IDLE) {
+	v->state = RELEASE;
+      }
+    }
+
+    // Step envelope
+    uint8_t level = v->level;
+    switch (v->state) {
+    case ATTACK:
+      if (m_attack == 0 || level > 255 - m_attack) {
+	level = 255;
+	v->state = DECAY;
+      }
+      else level += m_attack;
+      break;
+    case DECAY:
+      if (m_decay == 0 || level < m_sustain + m_decay) {
+	level = m_sustain;
+	v->state = SUSTAIN;
+      }
+      else level -= m_decay;
+      break;
+    case RELEASE:
+      if (m_release == 0 || level < m_release) {
+	level = 0;
+	v->state = IDLE;
+      }
+      else level -= m_release;
+      break;
+    default:
+      break;
+    }
+    v->level = level;
+  }
+}
+
+ISR(TIMER1_OVF_vect)
+{
+  // Mix the voices; phase accumulator indexes the wavetable and the
+  // sample is scaled by the envelope level
+  Synth* synth = Synth::s_synth;
+  const int8_t* wave = synth->m_wave;
+  Synth::voice_t* voice = synth->m_voice;
+  int16_t sum = 0;
+  for (uint8_t i = synth->m_voices; i != 0; i--, voice++) {
+    uint16_t phase = voice->phase + voice->step;
+    voice->phase = phase;
+    int8_t sample = pgm_read_byte(&wave[phase >> 8]);
+    sum += (sample * voice->level) >> 8;
+  }
+
+  // Output sample; applied by the timer at the next period
+  uint16_t value = synth->m_mid + (sum >> synth->m_shift);
+  OCR1A = value;
+  OCR1B = value;
+
+  // Update envelopes and note sequences at the control rate
+  if (--synth->m_tick != 0) return;
+  synth->m_tick = Synth::CONTROL_DIV;
+  synth->on_control();
+}
+
+#endif
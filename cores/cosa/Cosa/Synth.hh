@@ -0,0 +1,199 @@
+/**
+ * @file Cosa/Synth.hh
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#ifndef COSA_SYNTH_HH
+#define COSA_SYNTH_HH
+
+#include "Cosa/Types.h"
+
+/**
+ * Wavetable synthesizer with direct digital synthesis (DDS). Each
+ * voice has a 16-bit phase accumulator that indexes a 256 entry
+ * wavetable in program memory. The voices are scaled by an amplitude
+ * envelope (attack, decay, sustain, release) and mixed in the Timer1
+ * overflow interrupt handler; one sample per fast PWM period. The
+ * envelopes and the note sequencer (Note frequencies in program
+ * memory) are updated at the control rate (sample rate / 64).
+ * @code
+ * static const uint16_t melody[] __PROGMEM = {
+ *   Note::G4, Note::A4, Note::F4, Note::F3, Note::C4, Note::END
+ * };
+ * Synth synth;
+ * ...
+ * synth.begin(31250, 2);
+ * synth.play(0, melody, 500);
+ * synth.note_on(1, Note::C3);
+ * @endcode
+ *
+ * @section Circuit
+ * The same pins as Tone; the output is push/pull on the two Timer1
+ * compare output pins (Uno D9 and D10). Connect the speaker with an
+ * inline 100 ohm resistor or use a low-pass filter and amplifier.
+ *
+ * @section Limitations
+ * Uses Timer1 and may not be used together with other modules that
+ * use Timer1 (e.g. Tone, Servo, VWI and InputCapture). Not available
+ * on ATtiny. The interrupt handler time per voice limits the sample
+ * rate (see CosaSynth).
+ */
+class Synth {
+public:
+  /** Max number of voices. */
+  static const uint8_t VOICE_MAX = 4;
+
+  /** Samples per control (envelope and sequencer) update. */
+  static const uint8_t CONTROL_DIV = 64;
+
+  /** Sine wavetable (256 entries). */
+  static const int8_t SINE[] PROGMEM;
+
+  /**
+   * Construct synthesizer with the given wavetable (256 signed
+   * samples) in program memory.
+   * @param[in] wave wavetable (default SINE).
+   */
+  Synth(const int8_t* wave = SINE);
+
+  /**
+   * Start the sample interrupt handler with the given sample rate
+   * and number of mixed voices. The rate should be between 1 KHz and
+   * F_CPU / 256 (62.5 KHz at 16 MHz). Returns true(1) if successful otherwise
+   * false(0).
+   * @param[in] rate sample rate (Hz).
+   * @param[in] voices number of voices (1..VOICE_MAX).
+   * @return bool.
+   */
+  bool begin(uint16_t rate = 31250, uint8_t voices = VOICE_MAX);
+
+  /**
+   * Stop the synthesizer and silent the output.
+   */
+  void end();
+
+  /**
+   * Set wavetable. The table should be in program memory.
+   * @param[in] wave wavetable (256 signed samples).
+   */
+  void set_wave(const int8_t* wave)
+  {
+    m_wave = wave;
+  }
+
+  /**
+   * Set amplitude envelope for all voices; level change per control
+   * update (step 0..255) for attack, decay and release, and sustain
+   * level. A zero step is immediate.
+   * @param[in] attack level step.
+   * @param[in] decay level step.
+   * @param[in] sustain level (0..255).
+   * @param[in] release level step.
+   */
+  void set_envelope(uint8_t attack, uint8_t decay,
+		    uint8_t sustain, uint8_t release);
+
+  /**
+   * Start note with the given frequency on the given voice.
+   * @param[in] voice index.
+   * @param[in] freq frequency (Hz).
+   */
+  void note_on(uint8_t voice, uint16_t freq);
+
+  /**
+   * Release the note on the given voice.
+   * @param[in] voice index.
+   */
+  void note_off(uint8_t voice);
+
+  /**
+   * Play the given sequence of note frequencies in program memory
+   * on the given voice. The sequence is terminated with Note::END,
+   * Note::PAUSE is a rest. Each note is played the given duration;
+   * three quarters with gate and one quarter released.
+   * @param[in] voice index.
+   * @param[in] notes vector with note frequencies (program memory).
+   * @param[in] ms note duration in milli-seconds.
+   */
+  void play(uint8_t voice, const uint16_t* notes, uint16_t ms);
+
+  /**
+   * Return true(1) if the given voice is sounding or playing a
+   * sequence otherwise false(0).
+   * @param[in] voice index.
+   * @return bool.
+   */
+  bool is_active(uint8_t voice) const;
+
+protected:
+  /** Envelope states. */
+  enum {
+    IDLE,			//!< Silent.
+    ATTACK,			//!< Level increasing to max.
+    DECAY,			//!< Level decreasing to sustain.
+    SUSTAIN,			//!< Level at sustain.
+    RELEASE			//!< Level decreasing to zero.
+  } __attribute__((packed));
+
+  /** Voice state. */
+  struct voice_t {
+    uint16_t phase;		//!< Phase accumulator.
+    uint16_t step;		//!< Phase step per sample.
+    uint8_t level;		//!< Envelope level.
+    uint8_t state;		//!< Envelope state.
+    const uint16_t* notes;	//!< Note sequence (program memory).
+    uint16_t remaining;		//!< Control updates left of note.
+    uint16_t gate;		//!< Control updates when released.
+    uint16_t length;		//!< Control updates per note.
+  };
+
+  static Synth* s_synth;	//!< Active synthesizer.
+  const int8_t* m_wave;		//!< Wavetable (program memory).
+  voice_t m_voice[VOICE_MAX];	//!< Voices.
+  uint8_t m_voices;		//!< Number of mixed voices.
+  uint8_t m_tick;		//!< Samples to control update.
+  uint16_t m_mid;		//!< Output mid level.
+  uint8_t m_shift;		//!< Output scale.
+  uint16_t m_scale;		//!< Frequency to phase step (8.8).
+  uint16_t m_control_rate;	//!< Control updates per second.
+  uint8_t m_attack;		//!< Envelope attack step.
+  uint8_t m_decay;		//!< Envelope decay step.
+  uint8_t m_sustain;		//!< Envelope sustain level.
+  uint8_t m_release;		//!< Envelope release step.
+
+  /**
+   * Return phase step for the given frequency.
+   * @param[in] freq frequency (Hz).
+   * @return phase step.
+   */
+  uint16_t step(uint16_t freq) const
+  {
+    return ((((uint32_t) freq) * m_scale) >> 8);
+  }
+
+  /**
+   * Control update; step the note sequences and envelopes. Called
+   * from the sample interrupt handler.
+   */
+  void on_control();
+
+  /** Interrupt Service Routine is a friend. */
+  friend void TIMER1_OVF_vect(void);
+};
+
+#endif
@@ -47,13 +47,43 @@ TWI::begin(TWI::Driver* dev, Event::Handler* target)
   m_dev = dev;
   m_target = target;
   m_busy = true;
+  setup();
+  set_clock(dev);
+  unlock(key);
+}
+
+void
+TWI::setup()
+{
   // Enable internal pullup
   bit_mask_set(PORT, _BV(Board::SDA) | _BV(Board::SCL));
-  // Set clock prescale and bit rate
-  bit_mask_clear(TWSR, _BV(TWPS0) | _BV(TWPS1));
-  TWBR = m_freq;
   TWCR = IDLE_CMD;
-  unlock(key);
+}
+
+uint8_t
+TWI::prescale(uint32_t hz, uint8_t& twbr)
+{
+  // Bit rate scale; SCL = F_CPU / (16 + 2 * TWBR * 4^TWPS)
+  if (hz == 0) hz = 1;
+  uint32_t scale = (hz < MAX_FREQ) ? (F_CPU / hz - 16) : 0;
+  // Round up to frequency less than or equal to given
+  if (scale != 0 && (F_CPU / (16 + scale)) > hz) scale += 1;
+  scale = (scale + 1) / 2;
+  // Use the smallest prescaler for best resolution
+  uint8_t twps = 0;
+  while (scale > 255 && twps < 3) {
+    scale = (scale + 3) / 4;
+    twps += 1;
+  }
+  twbr = (scale > 255) ? 255 : scale;
+  return (twps);
+}
+
+uint32_t
+TWI::Driver::get_freq() const
+{
+  if (m_twps == BUS_PRESCALE) return (twi.get_freq());
+  return (TWI::freq(m_twbr, m_twps));
 }
 
 void
@@ -61,13 +91,67 @@ TWI::end()
 {
   // Check if an asynchronious read/write was issued
   if (m_target != NULL) await_completed();
-  // Put into idle state
+  // Put into idle state or start the next posted transaction
   synchronized {
     m_target = NULL;
     m_dev = NULL;
-    m_busy = false;
-    TWCR = 0;
+    if (m_head != NULL) {
+      setup();
+      start();
+    }
+    else {
+      m_busy = false;
+      TWCR = 0;
+    }
+  }
+}
+
+void
+TWI::start()
+{
+  // Dequeue the next transaction
+  Transaction* xfer = m_head;
+  m_head = xfer->m_next;
+  if (m_head == NULL) m_tail = NULL;
+  xfer->m_next = NULL;
+  m_xfer = xfer;
+  m_dev = xfer->m_dev;
+  m_target = xfer->m_target;
+  set_clock(m_dev);
+
+  // Issue (repeated) start with the write block or the read block
+  iovec_t* vp = m_vec;
+  if (xfer->m_write.size != 0 || xfer->m_read.size == 0) {
+    iovec_arg(vp, xfer->m_write.buf, xfer->m_write.size);
+    iovec_end(vp);
+    request(WRITE_OP);
+  }
+  else {
+    iovec_arg(vp, xfer->m_read.buf, xfer->m_read.size);
+    iovec_end(vp);
+    request(READ_OP);
+  }
+}
+
+bool
+TWI::post(Transaction* xfer)
+{
+  if (xfer->m_busy) return (false);
+  xfer->m_count = 0;
+  xfer->m_busy = true;
+  xfer->m_next = NULL;
+  synchronized {
+    // Append to queue and start if the bus is idle
+    if (m_tail == NULL) m_head = xfer;
+    else m_tail->m_next = xfer;
+    m_tail = xfer;
+    if (!m_busy) {
+      m_busy = true;
+      setup();
+      start();
+    }
   }
+  return (true);
 }
 
 bool
@@ -158,6 +242,53 @@ TWI::isr_stop(State state, uint8_t type)
     Event::push(type, m_target, m_count);
 }
 
+void
+TWI::isr_done(State state, uint8_t type)
+{
+  // Check for synchronous request
+  Transaction* xfer = m_xfer;
+  if (xfer == NULL) {
+    isr_stop(state, type);
+    return;
+  }
+
+  // Continue the transaction with the read block; repeated start
+  if (state != ERROR_STATE && m_state == MT_STATE && xfer->m_read.size != 0) {
+    iovec_t* vp = m_vec;
+    iovec_arg(vp, xfer->m_read.buf, xfer->m_read.size);
+    iovec_end(vp);
+    m_addr = (m_dev->m_addr | READ_OP);
+    isr_start(MR_STATE, 0);
+    TWCR = START_CMD;
+    return;
+  }
+
+  // Transaction completed; mark and signal the target
+  if (state == ERROR_STATE) {
+    m_count = -1;
+    type = Event::ERROR_TYPE;
+  }
+  xfer->m_count = m_count;
+  xfer->m_busy = false;
+  if (type != Event::NULL_TYPE && m_target != NULL)
+    Event::push(type, m_target, m_count);
+
+  // Chain the next transaction with a repeated start
+  if (m_head != NULL) {
+    if (state == ERROR_STATE) isr_stop(state);
+    start();
+    return;
+  }
+
+  // Stop and release the bus
+  isr_stop(state);
+  m_xfer = NULL;
+  m_target = NULL;
+  m_dev = NULL;
+  m_busy = false;
+  TWCR = 0;
+}
+
 bool
 TWI::isr_write(Command cmd)
 {
@@ -193,6 +324,10 @@ ISR(TWI_vect)
     break;
   case TWI::ARB_LOST:
     // Lost arbitration
+    if (twi.m_xfer != NULL) {
+      twi.isr_done(TWI::ERROR_STATE);
+      break;
+    }
     TWCR = TWI::IDLE_CMD;
     twi.m_state = TWI::ERROR_STATE;
     twi.m_count = -1;
@@ -206,10 +341,10 @@ ISR(TWI_vect)
     if (twi.m_next == twi.m_last) twi.isr_start(TWI::MT_STATE, TWI::NEXT_IX);
     if (twi.isr_write(TWI::DATA_CMD)) break;
   case TWI::MT_DATA_NACK:
-    twi.isr_stop(TWI::IDLE_STATE, Event::WRITE_COMPLETED_TYPE);
+    twi.isr_done(TWI::IDLE_STATE, Event::WRITE_COMPLETED_TYPE);
     break;
   case TWI::MT_SLA_NACK:
-    twi.isr_stop(TWI::ERROR_STATE, Event::ERROR_TYPE);
+    twi.isr_done(TWI::ERROR_STATE, Event::ERROR_TYPE);
     break;
 
     /**
@@ -222,10 +357,10 @@ ISR(TWI_vect)
     break;
   case TWI::MR_DATA_NACK:
     twi.isr_read();
-    twi.isr_stop(TWI::IDLE_STATE, Event::READ_COMPLETED_TYPE);
+    twi.isr_done(TWI::IDLE_STATE, Event::READ_COMPLETED_TYPE);
     break;
   case TWI::MR_SLA_NACK:
-    twi.isr_stop(TWI::ERROR_STATE, Event::ERROR_TYPE);
+    twi.isr_done(TWI::ERROR_STATE, Event::ERROR_TYPE);
     break;
 
     /**
@@ -270,7 +405,7 @@ ISR(TWI_vect)
     break;
 
   case TWI::BUS_ERROR:
-    twi.isr_stop(TWI::ERROR_STATE);
+    twi.isr_done(TWI::ERROR_STATE);
     break;
 
   default:
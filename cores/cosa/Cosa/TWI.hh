@@ -52,25 +52,65 @@ public:
   /** Default Two-Wire Interface clock: 100 KHz. */
   static const uint32_t DEFAULT_FREQ = 100000L;
 
-  /** Max Two-Wire Interface clock: 444.444 KHz @ 16 MHz. */
-  static const uint32_t MAX_FREQ = (F_CPU / (16 + 2*10));
+  /** Fast-mode Two-Wire Interface clock: 400 KHz. */
+  static const uint32_t FAST_FREQ = 400000L;
+
+  /** Fast-mode Plus Two-Wire Interface clock: 1 MHz. */
+  static const uint32_t FAST_PLUS_FREQ = 1000000L;
+
+  /** Max Two-Wire Interface clock: 1 MHz @ 16 MHz (TWBR = 0). */
+  static const uint32_t MAX_FREQ = (F_CPU / 16);
 
   /**
    * Device drivers are friends and may have callback/event handler
-   * for completion events.
+   * for completion events. The bus clock is a property of the
+   * driver and is set when the driver starts a device transaction
+   * block or a posted transaction.
    */
   class Driver : public Event::Handler {
   public:
     /**
-     * Construct TWI driver with given bus address.
+     * Construct TWI driver with given bus address. The driver uses
+     * the bus default frequency; TWI::set_freq().
      * @param[in] addr bus address (7-bit LSB).
      */
-   Driver(uint8_t addr) : Event::Handler(), m_addr(addr << 1) {}
+    Driver(uint8_t addr) :
+      Event::Handler(),
+      m_addr(addr << 1),
+      m_twbr(0),
+      m_twps(BUS_PRESCALE)
+    {}
+
+    /**
+     * Set bus frequency for the device. The highest frequency less
+     * than or equal to the given frequency is used. Does not adjust
+     * for cpu frequency scaling.
+     * @param[in] hz bus frequency.
+     */
+    void set_freq(uint32_t hz)
+    {
+      m_twps = TWI::prescale(hz, m_twbr);
+    }
+
+    /**
+     * Return bus frequency for the device.
+     * @return frequency (Hz).
+     */
+    uint32_t get_freq() const;
 
   protected:
     /** Device bus address. */
     uint8_t m_addr;
 
+    /** Bit rate register setting. */
+    uint8_t m_twbr;
+
+    /** Prescaler setting or bus default. */
+    uint8_t m_twps;
+
+    /** Prescaler marker for bus default frequency. */
+    static const uint8_t BUS_PRESCALE = 0xff;
+
     /** Allow access. */
     friend class TWI;
     friend void TWI_vect(void);
@@ -142,6 +182,93 @@ public:
     friend void TWI_vect(void);
   };
 
+  /**
+   * Transaction descriptor for queued requests. A transaction is a
+   * write block followed by a read block from the same device, with
+   * a repeated start between the blocks. Either block may be empty.
+   * Posted transactions are performed back to back by the interrupt
+   * handler; the next transaction is started with a repeated start
+   * instead of stop and start. An Event::READ_COMPLETED_TYPE (or
+   * WRITE_COMPLETED_TYPE if there is no read block) with the number
+   * of bytes read (written) is pushed to the target (if given) on
+   * completion, and Event::ERROR_TYPE if the device did not respond.
+   * The descriptor and buffers must be valid until the transaction
+   * is completed. The descriptor may be reused.
+   */
+  class Transaction {
+  public:
+    /**
+     * Construct an empty transaction descriptor.
+     */
+    Transaction() :
+      m_next(NULL),
+      m_dev(NULL),
+      m_target(NULL),
+      m_count(0),
+      m_busy(false)
+    {
+      m_write.buf = NULL;
+      m_write.size = 0;
+      m_read.buf = NULL;
+      m_read.size = 0;
+    }
+
+    /**
+     * Set transaction for given device driver; write given source
+     * buffer and read into given destination buffer.
+     * @param[in] dev device driver.
+     * @param[in] src buffer to write (or null).
+     * @param[in] count number of bytes to write.
+     * @param[in] dst buffer for read data (or null).
+     * @param[in] size number of bytes to read.
+     * @param[in] target completion event receiver (default null).
+     */
+    void set(Driver* dev,
+	     const void* src, size_t count,
+	     void* dst, size_t size,
+	     Event::Handler* target = NULL)
+    {
+      m_dev = dev;
+      m_target = target;
+      m_write.buf = (void*) src;
+      m_write.size = count;
+      m_read.buf = dst;
+      m_read.size = size;
+    }
+
+    /**
+     * Return true(1) if the transaction is completed (or not posted)
+     * otherwise false(0).
+     * @return bool.
+     */
+    bool is_completed() const
+    {
+      return (!m_busy);
+    }
+
+    /**
+     * Wait for the transaction to complete. Return number of bytes
+     * read (written) or negative error code.
+     * @return number of bytes or negative error code.
+     */
+    int await()
+    {
+      while (m_busy) yield();
+      return (m_count);
+    }
+
+  protected:
+    Transaction* m_next;	//!< Next transaction in queue.
+    Driver* m_dev;		//!< Device driver.
+    Event::Handler* m_target;	//!< Completion event receiver.
+    iovec_t m_write;		//!< Write block.
+    iovec_t m_read;		//!< Read block (after repeated start).
+    int m_count;		//!< Number of bytes or error code.
+    volatile bool m_busy;	//!< Queued or in progress.
+
+    friend class TWI;
+  };
+
   /**
    * Construct two-wire instance. This is actually a single-ton on
    * current supported hardware, i.e. there can only be one unit.
@@ -155,8 +282,12 @@ public:
     m_last(NULL),
     m_count(0),
     m_dev(NULL),
-    m_freq(((F_CPU / DEFAULT_FREQ) - 16) / 2),
-    m_busy(false)
+    m_twbr(((F_CPU / DEFAULT_FREQ) - 16) / 2),
+    m_twps(0),
+    m_busy(false),
+    m_head(NULL),
+    m_tail(NULL),
+    m_xfer(NULL)
   {
     for (uint8_t ix = 0; ix < VEC_MAX; ix++) {
       m_vec[ix].buf = 0;
@@ -174,10 +305,21 @@ public:
   void begin(TWI::Driver* dev, Event::Handler* target = NULL);
 
   /**
-   * Stop usage of the TWI bus logic.
+   * Stop usage of the TWI bus logic. Start posted transactions.
    */
   void end();
 
+  /**
+   * Post given transaction. The transaction is started directly if
+   * the bus is idle otherwise queued and started when the bus is
+   * released or the previous transaction is completed. Return true(1)
+   * if successful otherwise false(0) if the transaction is already
+   * posted.
+   * @param[in] xfer transaction descriptor.
+   * @return bool.
+   */
+  bool post(Transaction* xfer);
+
   /**
    * Issue a write data request to the current driver. Return
    * true(1) if successful otherwise(0).
@@ -281,15 +423,25 @@ public:
   int await_completed();
 
   /**
-   * Set bus frequency for device access. Does not adjust for
-   * cpu frequency scaling. Compile-time cpu frequency used.
-   * Should be called before starting the device driver; begin().
+   * Set bus default frequency for device access; used by drivers
+   * without frequency setting, see TWI::Driver::set_freq(). Does not
+   * adjust for cpu frequency scaling. Compile-time cpu frequency
+   * used. Should be called before starting the device driver;
+   * begin().
    * @param[in] hz bus frequency.
    */
   void set_freq(uint32_t hz)
-    __attribute__((always_inline))
   {
-    m_freq = (hz < MAX_FREQ) ? (((F_CPU / hz) - 16) / 2) : 10;
+    m_twps = prescale(hz, m_twbr);
+  }
+
+  /**
+   * Return bus default frequency.
+   * @return frequency (Hz).
+   */
+  uint32_t get_freq() const
+  {
+    return (freq(m_twbr, m_twps));
   }
 
 private:
@@ -397,8 +549,65 @@ private:
   volatile int m_count;
   uint8_t m_addr;
   Driver* m_dev;
-  uint8_t m_freq;
+  uint8_t m_twbr;
+  uint8_t m_twps;
   volatile bool m_busy;
+  Transaction* m_head;
+  Transaction* m_tail;
+  Transaction* volatile m_xfer;
+
+  /**
+   * Calculate bit rate register and prescaler settings for given
+   * frequency. Returns prescaler setting (TWPS) and bit rate setting
+   * (TWBR) in given reference.
+   * @param[in] hz bus frequency.
+   * @param[out] twbr bit rate register setting.
+   * @return prescaler setting.
+   */
+  static uint8_t prescale(uint32_t hz, uint8_t& twbr);
+
+  /**
+   * Return bus frequency for given bit rate register and prescaler
+   * settings.
+   * @param[in] twbr bit rate register setting.
+   * @param[in] twps prescaler setting.
+   * @return frequency (Hz).
+   */
+  static uint32_t freq(uint8_t twbr, uint8_t twps)
+  {
+    return (F_CPU / (16 + ((2 * (uint32_t) twbr) << (2 * twps))));
+  }
+
+  /**
+   * Enable the TWI hardware with bus pullup. Should be called with
+   * interrupts disabled.
+   */
+  void setup();
+
+  /**
+   * Set the bus frequency of the given device driver. Should be
+   * called with interrupts disabled and the bus idle (or between
+   * stop/repeated start).
+   * @param[in] dev device driver.
+   */
+  void set_clock(Driver* dev)
+  {
+    if (dev->m_twps == Driver::BUS_PRESCALE) {
+      TWSR = m_twps;
+      TWBR = m_twbr;
+    }
+    else {
+      TWSR = dev->m_twps;
+      TWBR = dev->m_twbr;
+    }
+  }
+
+  /**
+   * Dequeue the next posted transaction and issue start (or
+   * repeated start). Should be called with interrupts disabled and
+   * the bus acquired.
+   */
+  void start();
 
   /**
    * Start block transfer. Setup internal buffer pointers.
@@ -433,6 +642,16 @@ private:
    */
   void isr_stop(State state, uint8_t type = Event::NULL_TYPE);
 
+  /**
+   * Complete master request and step to given state. Continue a
+   * posted transaction with the read block or the next transaction
+   * with a repeated start, otherwise stop block transfer. Part of the
+   * TWI ISR state machine.
+   * @param[in] state to step to.
+   * @param[in] type of event to push (default no event).
+   */
+  void isr_done(State state, uint8_t type = Event::NULL_TYPE);
+
   /**
    * Initiate a request to the device. Return true(1) if successful
    * otherwise false(0).
@@ -48,6 +48,9 @@
  */
 class ADXL345 : private TWI::Driver {
 public:
+  /** Allow setting of device bus frequency. */
+  using TWI::Driver::set_freq;
+
   /**
    * Registers Map (See tab. 19, pp. 23).
    */
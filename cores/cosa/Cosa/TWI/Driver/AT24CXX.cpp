@@ -20,12 +20,15 @@
 
 #include "Cosa/TWI/Driver/AT24CXX.hh"
 #include "Cosa/Power.hh"
+#include "Cosa/Watchdog.hh"
 
 bool
 AT24CXX::poll(const void* addr, const void* buf, size_t size)
 {
+  // Addressing the device moves the address counter
   uint8_t i = POLL_MAX;
   int m;
+  m_sequential = false;
   do {
     twi.begin(this);
     if (buf == 0) {
@@ -38,7 +41,7 @@ AT24CXX::poll(const void* addr, const void* buf, size_t size)
       twi.end();
       if (m > 0) return (true);
     }
-    delay(16);
+    delay(POLL_DELAY);
   } while (--i);
   return (false);
 }
@@ -46,6 +49,8 @@ AT24CXX::poll(const void* addr, const void* buf, size_t size)
 bool
 AT24CXX::is_ready()
 {
+  if (m_size != 0) return (false);
+  m_sequential = false;
   twi.begin(this);
   uint16_t addr = 0;
   int m = twi.write(addr);
@@ -56,15 +61,40 @@ AT24CXX::is_ready()
 int
 AT24CXX::read(void* dest, const void* src, size_t size)
 {
-  if (!poll(src)) return (EIO);
-  int n = twi.read(dest, size);
-  twi.end();
+  // Check for asynchronous write in progress
+  if (m_size != 0) return (EBUSY);
+
+  // Use current address read when continuing the previous read
+  int n = EIO;
+  if (m_sequential && ((uint16_t) src == m_next)) {
+    twi.begin(this);
+    n = twi.read(dest, size);
+    twi.end();
+  }
+
+  // Otherwise (or on failure) address the device and read
+  if (n != (int) size) {
+    m_sequential = false;
+    if (!poll(src)) return (EIO);
+    n = twi.read(dest, size);
+    twi.end();
+    if (n < 0) return (n);
+  }
+
+  // Track the device address counter; rolls over at the end
+  m_next = ((uint16_t) src + n) & ((uint16_t) (SIZE - 1));
+  m_sequential = true;
   return (n);
 }
 
 int
 AT24CXX::write(void* dest, const void* src, size_t size)
 {
+  // Check for asynchronous write in progress
+  if (m_size != 0) return (EBUSY);
+  m_sequential = false;
+
+  // Write page aligned chunks; acknowledge polling between pages
   size_t s = size;
   uint8_t* q = (uint8_t*) dest;
   uint8_t* p = (uint8_t*) src;
@@ -82,3 +112,80 @@ AT24CXX::write(void* dest, const void* src, size_t size)
   return (size);
 }
 
+int
+AT24CXX::write_request(void* dest, const void* src, size_t size,
+		       Event::Handler* target)
+{
+  if (m_size != 0) return (EBUSY);
+  if (size == 0) return (EINVAL);
+  m_sequential = false;
+
+  // Start the page chunk chain; continued by on_event()
+  m_dest = (uint8_t*) dest;
+  m_src = (const uint8_t*) src;
+  m_target = target;
+  m_count = 0;
+  m_retry = 0;
+  m_size = size;
+  Watchdog::acquire(RETRY_PERIOD);
+  write_next();
+  return (0);
+}
+
+void
+AT24CXX::write_next()
+{
+  m_chunk = chunk();
+  twi.begin(this, this);
+  twi.write_request((uint16_t) m_dest, (void*) m_src, m_chunk);
+}
+
+void
+AT24CXX::on_event(uint8_t type, uint16_t value)
+{
+  if (m_size == 0) return;
+  if (type != Event::WRITE_COMPLETED_TYPE && type != Event::ERROR_TYPE)
+    return;
+  twi.end();
+
+  // Retry on timeout while the device is busy with the previous
+  // write cycle; bounded by time and not by bus frequency
+  if ((type == Event::ERROR_TYPE)
+      || (value != m_chunk + sizeof(uint16_t))) {
+    if (++m_retry < RETRY_MAX) {
+      Watchdog::attach(&m_poller, RETRY_PERIOD);
+      return;
+    }
+    write_completed(Event::ERROR_TYPE);
+    return;
+  }
+
+  // Step to the next page chunk or signal completion
+  m_retry = 0;
+  m_dest += m_chunk;
+  m_src += m_chunk;
+  m_count += m_chunk;
+  m_size -= m_chunk;
+  if (m_size != 0) {
+    write_next();
+    return;
+  }
+  write_completed(Event::WRITE_COMPLETED_TYPE);
+}
+
+void
+AT24CXX::write_completed(uint8_t type)
+{
+  m_size = 0;
+  Watchdog::release();
+  if (m_target != NULL) Event::push(type, m_target, m_count);
+}
+
+void
+AT24CXX::Poller::on_event(uint8_t type, uint16_t value)
+{
+  UNUSED(value);
+  if (type != Event::TIMEOUT_TYPE) return;
+  detach();
+  m_eeprom->write_next();
+}
@@ -24,12 +24,22 @@
 #include "Cosa/Types.h"
 #include "Cosa/TWI.hh"
 #include "Cosa/EEPROM.hh"
+#include "Cosa/Linkage.hh"
 
 /**
  * Driver for the AT24CXX 2-Wire Serial EEPROM. Allows page write and
  * block read. Supports device AT24C32 (8K) to AT24C512 (64K). Default
  * AT24CXX device is AT24C32.
  *
+ * Writes are split into maximum page aligned chunks. Completion of
+ * the write cycle is detected with acknowledge polling. The write
+ * cycle of the last page is not waited for; the next access will
+ * poll. Asynchronous writes are chained by the TWI completion event,
+ * see write_request(); acknowledge polls are rescheduled on watchdog
+ * timeout events. Reads that continue where the previous read
+ * ended are performed as current address reads, i.e., sequential
+ * reads may stream the whole device without addressing.
+ *
  * @section Circuit
  * The TinyRTC with DS1307 also contains a 24C32 EEPROM.
  * @code
@@ -47,6 +57,9 @@
  */
 class AT24CXX : private TWI::Driver, public EEPROM::Device {
 public:
+  /** Allow setting of device bus frequency. */
+  using TWI::Driver::set_freq;
+
   /**
    * Number of bytes on device.
    */
@@ -72,7 +85,17 @@ public:
     SIZE((size / CHARBITS) * 1024),
     PAGE_MAX(page_max),
     WRITE_MAX(page_max),
-    WRITE_MASK(page_max - 1)
+    WRITE_MASK(page_max - 1),
+    m_next(0),
+    m_sequential(false),
+    m_dest(NULL),
+    m_src(NULL),
+    m_size(0),
+    m_chunk(0),
+    m_count(0),
+    m_retry(0),
+    m_target(NULL),
+    m_poller(this)
   {}
 
   /**
@@ -105,17 +128,131 @@ public:
    */
   virtual int write(void* dest, const void* src, size_t size);
 
+  /**
+   * Start asynchronous write of rom block at given address with the
+   * contents from the buffer. The buffer must be valid until the
+   * write has completed. Page chunks are issued on the TWI completion
+   * event; Event::service() must be called. An Event::WRITE_COMPLETED_TYPE
+   * with the number of bytes written, or Event::ERROR_TYPE, is pushed
+   * to the given target when completed. Blocking read and write
+   * return EBUSY while the write is in progress. The watchdog is used
+   * for acknowledge polling (see Watchdog::acquire()). Return zero if
+   * successful otherwise negative error code; EBUSY if a write is in
+   * progress.
+   * @param[in] dest address in rom to read write to.
+   * @param[in] src buffer to write to rom.
+   * @param[in] size number of bytes to write.
+   * @param[in] target event handler (default NULL).
+   * @return zero or negative error code.
+   */
+  int write_request(void* dest, const void* src, size_t size,
+		    Event::Handler* target = NULL);
+
+protected:
+  /**
+   * @override Event::Handler
+   * Handle TWI completion events for asynchronous write; issue next
+   * page chunk or retry while the device is busy with write cycle.
+   * @param[in] type the event type.
+   * @param[in] value the event value.
+   */
+  virtual void on_event(uint8_t type, uint16_t value);
+
 private:
-  static const uint8_t POLL_MAX = 3;
+  /**
+   * Asynchronous write acknowledge poller; issues the page chunk
+   * again on watchdog timeout.
+   */
+  class Poller : public Link {
+  public:
+    Poller(AT24CXX* eeprom) : Link(), m_eeprom(eeprom) {}
+
+  protected:
+    /**
+     * @override Event::Handler
+     * Detach and issue the page chunk on timeout.
+     * @param[in] type the event type.
+     * @param[in] value the event value.
+     */
+    virtual void on_event(uint8_t type, uint16_t value);
+
+    AT24CXX* m_eeprom;		//!< Device driver.
+  };
+
+  /** Max number of acknowledge polls; write cycle is max 10 ms. */
+  static const uint8_t POLL_MAX = 64;
+
+  /** Delay between acknowledge polls (ms); sleeping delay. */
+  static const uint16_t POLL_DELAY = 1;
+
+  /** Max number of asynchronous acknowledge polls. */
+  static const uint8_t RETRY_MAX = 8;
+
+  /** Period of asynchronous acknowledge polls (ms). */
+  static const uint16_t RETRY_PERIOD = 16;
+
   const uint16_t WRITE_MAX;
   const uint16_t WRITE_MASK;
 
+  /** Device address counter after latest read. */
+  uint16_t m_next;
+
+  /** Device address counter is valid (no addressing since read). */
+  bool m_sequential;
+
+  /** Asynchronous write state; destination address. */
+  uint8_t* m_dest;
+
+  /** Source buffer. */
+  const uint8_t* m_src;
+
+  /** Remaining bytes. */
+  size_t m_size;
+
+  /** Size of current page chunk. */
+  uint16_t m_chunk;
+
+  /** Number of bytes written. */
+  uint16_t m_count;
+
+  /** Number of acknowledge polls of current chunk. */
+  uint8_t m_retry;
+
+  /** Receiver of completion event. */
+  Event::Handler* m_target;
+
+  /** Asynchronous acknowledge poller. */
+  Poller m_poller;
+
+  /**
+   * Return size of next page aligned chunk of asynchronous write.
+   * @return bytes.
+   */
+  uint16_t chunk() const
+  {
+    uint16_t n = WRITE_MAX - (((uint16_t) m_dest) & WRITE_MASK);
+    return (n < m_size ? n : m_size);
+  }
+
+  /**
+   * Issue next page chunk of asynchronous write.
+   */
+  void write_next();
+
+  /**
+   * Complete asynchronous write and notify the target with the
+   * given event type.
+   * @param[in] type event type.
+   */
+  void write_completed(uint8_t type);
+
   /**
    * Initiate TWI communication with memory device for access of
    * given memory address. If buffer is not null perform a write
-   * to page. The given size must not exceed the page. Return true(1)
-   * if the device is ready, write cycle is completed, otherwise
-   * false(0).
+   * to page. The given size must not exceed the page. Acknowledge
+   * polling is used while the device is busy with a write cycle.
+   * Return true(1) if the device is ready, write cycle is completed,
+   * otherwise false(0).
    * @param[in] addr address in rom.
    * @param[in] buf buffer to write rom (default null(0)).
    * @param[in] size number to write (default zero(0)).
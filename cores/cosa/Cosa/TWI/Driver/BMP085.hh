@@ -53,6 +53,9 @@
  */
 class BMP085 : private TWI::Driver {
 public:
+  /** Allow setting of device bus frequency. */
+  using TWI::Driver::set_freq;
+
   /**
    * Oversampling modes (table, pp. 10).
    */
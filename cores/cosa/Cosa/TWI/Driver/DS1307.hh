@@ -49,6 +49,9 @@
  */
 class DS1307 : private TWI::Driver {
 public:
+  /** Allow setting of device bus frequency. */
+  using TWI::Driver::set_freq;
+
   /**
    * The Timekeeper Control Register bitfields (pp. 9).
    */
@@ -49,6 +49,9 @@
  */
 class DS3231 : private TWI::Driver {
 public:
+  /** Allow setting of device bus frequency. */
+  using TWI::Driver::set_freq;
+
   /**
    * Alarm1 register sub-set type and mask bits (Table 2, pp. 12).
    */
@@ -54,6 +54,9 @@
  */
 class L3G4200D : private TWI::Driver {
 public:
+  /** Allow setting of device bus frequency. */
+  using TWI::Driver::set_freq;
+
   /**
    * Construct L3G4200D digital gyroscope driver with given
    * sub-address. Default is zero(0).
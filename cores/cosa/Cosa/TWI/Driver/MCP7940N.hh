@@ -36,6 +36,9 @@
  */
 class MCP7940N : private TWI::Driver {
 public:
+  /** Allow setting of device bus frequency. */
+  using TWI::Driver::set_freq;
+
   /**
    * The RTCC configuration/status bitfields. Embedded in day field (pp. 18).
    */
@@ -52,6 +52,9 @@
  */
 class MPU6050 : private TWI::Driver {
 public:
+  /** Allow setting of device bus frequency. */
+  using TWI::Driver::set_freq;
+
   /**
    * Construct MPU6050 digital gyroscope driver with given
    * sub-address. Default is zero(0).
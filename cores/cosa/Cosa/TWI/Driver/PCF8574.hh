@@ -48,6 +48,9 @@
  */
 class PCF8574 : private TWI::Driver {
 public:
+  /** Allow setting of device bus frequency. */
+  using TWI::Driver::set_freq;
+
   /**
    * Construct connection to PCF8574 Remote 8-bit I/O expander with
    * given sub-address.
@@ -47,6 +47,9 @@
  */
 class PCF8591 : private TWI::Driver {
 public:
+  /** Allow setting of device bus frequency. */
+  using TWI::Driver::set_freq;
+
   /**
    * Control byte; selection of input channel and mode of operation
    * Fig. 5 Control byte, pp. 6.
@@ -328,6 +328,27 @@ unlock(uint8_t key)
  */
 #define barrier() __asm__ __volatile__("nop" ::: "memory")
 
+/**
+ * Store value shared with an interrupt handler. The store is
+ * performed with interrupts disabled so that multi-byte values (e.g.
+ * pointers) are never read partially updated by the handler. Also a
+ * compiler barrier; preceding stores are completed before the value
+ * is stored.
+ * @param[in] T variable type.
+ * @param[in] V value type.
+ * @param[in] var shared variable.
+ * @param[in] value to store.
+ */
+template<class T, class V>
+inline void synchronized_store(volatile T& var, V value)
+  __attribute__((always_inline));
+template<class T, class V>
+inline void
+synchronized_store(volatile T& var, V value)
+{
+  synchronized var = value;
+}
+
 /**
  * Buffer structure for scatter/gather.
  */
@@ -33,6 +33,14 @@
  * Note: The internal pullup resistors on the USI pins are active.
  * External pullup resistors (4K7 ohm) are required for longer
  * wires and/or higher loads.
+ *
+ * @section Limitations
+ * The master is polled with delay loops unless USE_USI_TWI_ASYNC is
+ * defined (USI_TWI.cpp). The asynchronous master uses Timer1 as bit
+ * clock and the USI overflow interrupt for byte transfer; Timer1 may
+ * not be used by other modules (e.g. Servo, Tone and VWI). The bus
+ * clock is 100 kHz or less (F_CPU / 256). Clock stretching by slave
+ * devices is not supported by the asynchronous master.
  */
 class TWI {
 public:
@@ -48,6 +56,15 @@ public:
      */
     Driver(uint8_t addr) : Event::Handler(), m_addr(addr << 1) {}
 
+    /**
+     * Set bus frequency for the device (not implemented for USI).
+     * @param[in] hz bus frequency.
+     */
+    void set_freq(uint32_t hz)
+    {
+      UNUSED(hz);
+    }
+
   protected:
     /** Device bus address. */
     uint8_t m_addr;
@@ -56,6 +73,7 @@ public:
     friend class TWI;
     friend void ::USI_START_vect(void);
     friend void ::USI_OVF_vect(void);
+    friend void ::TIMER1_COMPA_vect(void);
   };
 
   /**
@@ -140,6 +158,53 @@ public:
    */
   void end();
 
+  /**
+   * Issue a write data request to the current driver. Return
+   * true(1) if successful otherwise(0). An Event::WRITE_COMPLETED_TYPE
+   * (or ERROR_TYPE) is pushed to the target on completion.
+   * @param[in] buf data to write.
+   * @param[in] size number of bytes to write.
+   * @return bool
+   */
+  bool write_request(void* buf, size_t size);
+
+  /**
+   * Issue a write data request to the current driver with given
+   * byte header/command. Return true(1) if successful otherwise(0).
+   * @param[in] header to write before buffer.
+   * @param[in] buf data to write.
+   * @param[in] size number of bytes to write.
+   * @return bool
+   */
+  bool write_request(uint8_t header, void* buf, size_t size);
+
+  /**
+   * Issue a write data request to the current driver with given
+   * header/command. Return true(1) if successful otherwise(0).
+   * @param[in] header to write before buffer.
+   * @param[in] buf data to write.
+   * @param[in] size number of bytes to write.
+   * @return bool
+   */
+  bool write_request(uint16_t header, void* buf, size_t size);
+
+  /**
+   * Issue a read data request to the current driver. Return true(1)
+   * if successful otherwise(0). An Event::READ_COMPLETED_TYPE (or
+   * ERROR_TYPE) is pushed to the target on completion.
+   * @param[in] buf data to read.
+   * @param[in] size number of bytes to read.
+   * @return bool
+   */
+  bool read_request(void* buf, size_t size);
+
+  /**
+   * Await issued request to complete. Returns number of bytes
+   * or negative error code.
+   * @return number of bytes or negative error code.
+   */
+  int await_completed();
+
   /**
    * Write data to the current driver. Returns number of bytes written
    * or negative error code.
@@ -204,7 +269,16 @@ private:
     WRITE_REQUEST,
     WRITE_COMPLETED,
     // Slave service state (Response to write)
-    SERVICE_REQUEST
+    SERVICE_REQUEST,
+    // Master transmitter states (asynchronous)
+    MT_DATA,
+    MT_ACK_CHECK,
+    // Master receiver states (asynchronous)
+    MR_DATA,
+    MR_ACK,
+    // Master stop condition states (asynchronous)
+    STOP_REQUEST,
+    STOP_COMPLETED
   } __attribute__((packed));
 
   /**
@@ -238,7 +312,12 @@ private:
     // Master initialization. Software clock strobe
     CR_INIT_MODE =  _BV(USIWM1) | _BV(USICS1) | _BV(USICLK),
     // Master data transfer. Software clock strobe
-    CR_DATA_MODE = _BV(USIWM1) | _BV(USICS1) | _BV(USICLK) | _BV(USITC)
+    CR_DATA_MODE = _BV(USIWM1) | _BV(USICS1) | _BV(USICLK) | _BV(USITC),
+    // Master asynchronous data transfer. Software clock strobe
+    CR_ASYNC_MODE = _BV(USIOIE) | _BV(USIWM1) | _BV(USICS1) | _BV(USICLK)
+                  | _BV(USITC),
+    // Master asynchronous idle. Software clock strobe
+    CR_ASYNC_IDLE = _BV(USIOIE) | _BV(USIWM1) | _BV(USICS1) | _BV(USICLK)
   } __attribute__((packed));
 
   /**
@@ -259,6 +338,8 @@ private:
   volatile int m_count;
   Driver* m_dev;
   volatile bool m_busy;
+  uint8_t m_op;
+  uint8_t m_ix;
 
   /**
    * Get current driver state.
@@ -367,9 +448,58 @@ private:
    */
   int request(uint8_t op);
 
+  /**
+   * Issue a request to the device; asynchronous if supported
+   * otherwise performed directly and completion signalled. Return
+   * true(1) if successful otherwise false(0).
+   * @param[in] op slave operation request.
+   * @return bool
+   */
+  bool issue(uint8_t op);
+
+  /**
+   * Initiate an asynchronous request to the device. The start
+   * condition and address are generated and the transfer is
+   * continued by the interrupt handlers. Return true(1) if
+   * successful otherwise false(0).
+   * @param[in] op slave operation request.
+   * @return bool
+   */
+  bool async_request(uint8_t op);
+
+  /**
+   * Step to the next byte in the io vector. Return true(1) if
+   * there is a byte otherwise false(0). Part of the asynchronous
+   * master state machine.
+   * @return bool
+   */
+  bool isr_next();
+
+  /**
+   * Handle USI overflow in asynchronous master mode; byte or
+   * acknowledge transfer completed. Part of the asynchronous master
+   * state machine.
+   */
+  void isr_master();
+
+  /**
+   * Handle bit clock (Timer1 compare match) in asynchronous master
+   * mode; toggle clock or generate stop condition. Part of the
+   * asynchronous master state machine.
+   */
+  void isr_clock();
+
+  /**
+   * Complete asynchronous request; stop bit clock and push
+   * completion event with the result (count). Part of the
+   * asynchronous master state machine.
+   */
+  void isr_completed();
+
   /** Allow access. */
   friend void ::USI_START_vect(void);
   friend void ::USI_OVF_vect(void);
+  friend void ::TIMER1_COMPA_vect(void);
 };
 #endif
 #endif
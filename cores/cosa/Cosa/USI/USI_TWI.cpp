@@ -32,6 +32,18 @@
 #define T4 ((((I_CPU * 4000) / 10000) + 1) / 4)
 #endif
 
+// Configuration: Interrupt-driven master; Timer1 bit clock
+// #define USE_USI_TWI_ASYNC
+
+#if defined(USE_USI_TWI_ASYNC)
+#if defined(BOARD_ATTINYX5) || defined(BOARD_ATTINYX4)
+// Bit clock half period (cpu cycles); room for the interrupt handlers
+#define ASYNC_CYCLES (F_CPU / 200000L < 128 ? 128 : F_CPU / 200000L)
+#else
+#undef USE_USI_TWI_ASYNC
+#endif
+#endif
+
 TWI twi  __attribute__ ((weak));
 
 void
@@ -143,6 +155,22 @@ ISR(USI_OVF_vect)
     }
     break;
 
+#if defined(USE_USI_TWI_ASYNC)
+    /**
+     * Master Transmitter/Receiver Mode (asynchronous)
+     */
+  case TWI::MT_DATA:
+  case TWI::MT_ACK_CHECK:
+  case TWI::MR_DATA:
+  case TWI::MR_ACK:
+    twi.isr_master();
+    break;
+
+  case TWI::STOP_REQUEST:
+  case TWI::STOP_COMPLETED:
+    break;
+#endif
+
   restart:
   default:
     twi.set_mode(IOPin::INPUT_MODE);
@@ -166,6 +194,183 @@ TWI::Slave::on_event(uint8_t type, uint16_t value)
   }
 }
 
+#if defined(USE_USI_TWI_ASYNC)
+static inline void
+timer_start()
+{
+#if defined(BOARD_ATTINYX5)
+  OCR1A = ASYNC_CYCLES - 1;
+  OCR1C = ASYNC_CYCLES - 1;
+  TCNT1 = 0;
+  TIFR = _BV(OCF1A);
+  TIMSK |= _BV(OCIE1A);
+  TCCR1 = _BV(CTC1) | _BV(CS10);
+#else
+  TCCR1A = 0;
+  OCR1A = ASYNC_CYCLES - 1;
+  TCNT1 = 0;
+  TIFR1 = _BV(OCF1A);
+  TIMSK1 |= _BV(OCIE1A);
+  TCCR1B = _BV(WGM12) | _BV(CS10);
+#endif
+}
+
+static inline void
+timer_stop()
+{
+#if defined(BOARD_ATTINYX5)
+  TCCR1 = 0;
+  TIMSK &= ~_BV(OCIE1A);
+#else
+  TCCR1B = 0;
+  TIMSK1 &= ~_BV(OCIE1A);
+#endif
+}
+
+bool
+TWI::async_request(uint8_t op)
+{
+  // Setup buffer pointers
+  m_op = op;
+  m_ix = 0;
+  m_next = (uint8_t*) m_vec[0].buf;
+  m_last = m_next + m_vec[0].size;
+  m_count = 0;
+
+  // Send start condition
+  if (!start()) return (false);
+
+  // Write address; the transfer is continued by the interrupt handlers
+  synchronized {
+    m_scl.clear();
+    USIDR = m_dev->m_addr | op;
+    USISR = SR_CLEAR_ALL;
+    USICR = CR_ASYNC_IDLE;
+    m_state = MT_DATA;
+    timer_start();
+  }
+  return (true);
+}
+
+bool
+TWI::isr_next()
+{
+  while (m_next == m_last) {
+    if (m_ix == VEC_MAX - 1) return (false);
+    m_ix += 1;
+    m_next = (uint8_t*) m_vec[m_ix].buf;
+    if (m_next == NULL) return (false);
+    m_last = m_next + m_vec[m_ix].size;
+  }
+  return (true);
+}
+
+void
+TWI::isr_master()
+{
+  switch (m_state) {
+  case MT_DATA:
+    // Byte written; release data line and clock in acknowledge
+    set_mode(IOPin::INPUT_MODE);
+    USIDR = 0;
+    USISR = SR_CLEAR_ALL | (0x0E << USICNT0);
+    m_state = MT_ACK_CHECK;
+    return;
+
+  case MT_ACK_CHECK:
+    // Check acknowledge; address not acknowledged is an error
+    if (USIDR != 0) {
+      if (m_count == 0) m_count = -1;
+      break;
+    }
+    // Receive first byte or write next byte
+    if (m_op == READ_OP) {
+      if (m_next == m_last) break;
+      USISR = SR_CLEAR_ALL;
+      m_state = MR_DATA;
+      return;
+    }
+    if (!isr_next()) break;
+    USIDR = *m_next++;
+    m_count += 1;
+    set_mode(IOPin::OUTPUT_MODE);
+    USISR = SR_CLEAR_ALL;
+    m_state = MT_DATA;
+    return;
+
+  case MR_DATA:
+    // Byte received; acknowledge all but the last byte
+    *m_next++ = USIDR;
+    m_count += 1;
+    USIDR = (m_next != m_last) ? 0x00 : 0xff;
+    set_mode(IOPin::OUTPUT_MODE);
+    USISR = SR_CLEAR_ALL | (0x0E << USICNT0);
+    m_state = MR_ACK;
+    return;
+
+  case MR_ACK:
+    // Receive next byte
+    if (m_next == m_last) break;
+    set_mode(IOPin::INPUT_MODE);
+    USISR = SR_CLEAR_ALL;
+    m_state = MR_DATA;
+    return;
+
+  default:
+    return;
+  }
+
+  // Pull data line low and generate stop condition on next clocks
+  USIDR = 0xff;
+  set_mode(IOPin::OUTPUT_MODE);
+  m_sda.clear();
+  m_state = STOP_REQUEST;
+}
+
+void
+TWI::isr_clock()
+{
+  switch (m_state) {
+  case STOP_REQUEST:
+    // Release clock line
+    m_scl.set();
+    m_state = STOP_COMPLETED;
+    break;
+  case STOP_COMPLETED:
+    // Release data line; stop condition
+    m_sda.set();
+    isr_completed();
+    break;
+  default:
+    // Toggle clock line; shift data and count edge
+    USICR = CR_ASYNC_MODE;
+  }
+}
+
+void
+TWI::isr_completed()
+{
+  timer_stop();
+  USICR = CR_INIT_MODE;
+  USISR = SR_CLEAR_ALL;
+  m_state = IDLE;
+  if (m_target == NULL) return;
+  uint8_t type;
+  if (m_count < 0)
+    type = Event::ERROR_TYPE;
+  else if (m_op == READ_OP)
+    type = Event::READ_COMPLETED_TYPE;
+  else
+    type = Event::WRITE_COMPLETED_TYPE;
+  Event::push(type, m_target, m_count);
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+  twi.isr_clock();
+}
+#endif
+
 TWI::TWI() :
   m_sda((Board::DigitalPin) Board::SDA, IOPin::INPUT_MODE, true),
   m_scl((Board::DigitalPin) Board::SCL, IOPin::OUTPUT_MODE, true),
@@ -175,7 +380,9 @@ TWI::TWI() :
   m_last(0),
   m_count(0),
   m_dev(0),
-  m_busy(false)
+  m_busy(false),
+  m_op(0),
+  m_ix(0)
 {
   for (uint8_t ix = 0; ix < VEC_MAX; ix++) {
     m_vec[ix].buf = 0;
@@ -285,6 +492,29 @@ TWI::request(uint8_t op)
   return (count);
 }
 
+bool
+TWI::issue(uint8_t op)
+{
+#if defined(USE_USI_TWI_ASYNC)
+  return (async_request(op));
+#else
+  // Perform the request and signal completion
+  m_op = op;
+  m_count = request(op);
+  if (m_target != NULL) {
+    uint8_t type;
+    if (m_count < 0)
+      type = Event::ERROR_TYPE;
+    else if (op == READ_OP)
+      type = Event::READ_COMPLETED_TYPE;
+    else
+      type = Event::WRITE_COMPLETED_TYPE;
+    Event::push(type, m_target, m_count);
+  }
+  return (true);
+#endif
+}
+
 void
 TWI::begin(TWI::Driver* dev, Event::Handler* target)
 {
@@ -310,6 +540,8 @@ TWI::begin(TWI::Driver* dev, Event::Handler* target)
 void
 TWI::end()
 {
+  // Wait for an asynchronous request to complete
+  await_completed();
   // Put into idle state
   synchronized {
     m_target = NULL;
@@ -318,28 +550,28 @@ TWI::end()
   }
 }
 
-int
-TWI::write(void* buf, size_t size)
+bool
+TWI::write_request(void* buf, size_t size)
 {
   iovec_t* vp = m_vec;
   iovec_arg(vp, buf, size);
   iovec_end(vp);
-  return (request(WRITE_OP));
+  return (issue(WRITE_OP));
 }
 
-int
-TWI::write(uint8_t header, void* buf, size_t size)
+bool
+TWI::write_request(uint8_t header, void* buf, size_t size)
 {
   iovec_t* vp = m_vec;
   m_header[0] = header;
   iovec_arg(vp, m_header, sizeof(header));
   iovec_arg(vp, buf, size);
   iovec_end(vp);
-  return (request(WRITE_OP));
+  return (issue(WRITE_OP));
 }
 
-int
-TWI::write(uint16_t header, void* buf, size_t size)
+bool
+TWI::write_request(uint16_t header, void* buf, size_t size)
 {
   iovec_t* vp = m_vec;
   m_header[0] = (header >> 8);
@@ -347,15 +579,50 @@ TWI::write(uint16_t header, void* buf, size_t size)
   iovec_arg(vp, m_header, sizeof(header));
   iovec_arg(vp, buf, size);
   iovec_end(vp);
-  return (request(WRITE_OP));
+  return (issue(WRITE_OP));
 }
 
-int
-TWI::read(void* buf, size_t size)
+bool
+TWI::read_request(void* buf, size_t size)
 {
   iovec_t* vp = m_vec;
   iovec_arg(vp, buf, size);
   iovec_end(vp);
-  return (request(READ_OP));
+  return (issue(READ_OP));
+}
+
+int
+TWI::await_completed()
+{
+  while (m_state > IDLE) yield();
+  return (m_count);
+}
+
+int
+TWI::write(void* buf, size_t size)
+{
+  if (!write_request(buf, size)) return (EIO);
+  return (await_completed());
+}
+
+int
+TWI::write(uint8_t header, void* buf, size_t size)
+{
+  if (!write_request(header, buf, size)) return (EIO);
+  return (await_completed());
+}
+
+int
+TWI::write(uint16_t header, void* buf, size_t size)
+{
+  if (!write_request(header, buf, size)) return (EIO);
+  return (await_completed());
+}
+
+int
+TWI::read(void* buf, size_t size)
+{
+  if (!read_request(buf, size)) return (EIO);
+  return (await_completed());
 }
 #endif
@@ -153,6 +153,25 @@ public:
     s_initiated = false;
   }
 
+  /**
+   * Request timeout events on demand. Starts the watchdog with the
+   * given period and timeout events if not running. Timeout events
+   * are installed if the watchdog is running without an interrupt
+   * handler (default begin()). The watchdog is stopped when all
+   * requests started on demand have been released.
+   * Should be balanced with release(). May be called from interrupt
+   * handlers. The watchdog clock (ticks and millis) does not advance
+   * while stopped.
+   * @param[in] ms timeout period in milli-seconds (default 16 ms).
+   */
+  static void acquire(uint16_t ms = 16);
+
+  /**
+   * Release request for timeout events. Stops the watchdog if it was
+   * started on demand and there are no more requests.
+   */
+  static void release();
+
   /**
    * Default interrupt handler for timeout queues; push timeout events
    * to all attached event handlers.
@@ -189,6 +208,10 @@ private:
   static uint8_t s_prescale;
   static bool s_initiated;
 
+  // Number of timeout event requests and watchdog started on demand.
+  static uint8_t s_requests;
+  static bool s_on_demand;
+
   /**
    * Calculate watchdog prescale given timeout period (in milli-seconds).
    * @param[in] ms timeout period.
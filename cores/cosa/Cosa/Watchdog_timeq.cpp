@@ -21,6 +21,8 @@
 #include "Cosa/Watchdog.hh"
 
 Head Watchdog::s_timeq[Watchdog::TIMEQ_MAX];
+uint8_t Watchdog::s_requests = 0;
+bool Watchdog::s_on_demand = false;
 
 void
 Watchdog::attach(Link* target, uint16_t ms)
@@ -42,3 +44,33 @@ Watchdog::push_timeout_events(void* env)
       Event::push(Event::TIMEOUT_TYPE, &s_timeq[i], i);
 }
 
+void
+Watchdog::acquire(uint16_t ms)
+{
+  synchronized {
+    s_requests += 1;
+    if (!s_initiated) {
+      // Keep the current delay function; the watchdog is temporary
+      void (*fn)(uint32_t) = ::delay;
+      begin(ms, push_timeout_events);
+      ::delay = fn;
+      s_on_demand = true;
+    }
+    else if (s_handler == NULL) {
+      // Running without handler; install timeout events
+      s_handler = push_timeout_events;
+      s_env = NULL;
+    }
+  }
+}
+
+void
+Watchdog::release()
+{
+  synchronized {
+    if (s_requests != 0 && --s_requests == 0 && s_on_demand) {
+      s_on_demand = false;
+      end();
+    }
+  }
+}
@@ -0,0 +1,161 @@
+/**
+ * @file CosaBenchmarkFS.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Benchmarking file system operations; count device operations per
+ * file system operation (create, append, seek and ls) for CFFS on
+ * flash memory and FAT16 on SD. The devices are wrapped with the
+ * counting devices Flash::Counter and IOBlock::Counter. The counts
+ * are independent of device timing and may be compared between
+ * versions to catch performance regressions.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// Select file system to benchmark (CFFS or FAT16)
+#define USE_CFFS
+//#define USE_FAT16
+
+#if defined(USE_CFFS)
+#include "Cosa/FS/CFFS.hh"
+#if defined(WICKEDDEVICE_WILDFIRE)
+#include "Cosa/Flash/Driver/W25X40CL.hh"
+W25X40CL flash;
+#else
+#include "Cosa/Flash/Driver/S25FL127S.hh"
+S25FL127S flash;
+#endif
+Flash::Counter flash_counter(&flash);
+#elif defined(USE_FAT16)
+#include "Cosa/FS/FAT16.hh"
+SD sd(Board::D4);
+IOBlock::Counter sd_counter(&sd);
+#endif
+
+// Number of append operations and size of record
+static const uint16_t APPEND_MAX = 100;
+static const size_t RECORD_MAX = 32;
+
+#if defined(USE_CFFS)
+void print(str_P op, uint16_t count)
+{
+  trace << op
+	<< PSTR(": reads = ") << flash_counter.reads / count
+	<< PSTR(", read_bytes = ") << flash_counter.read_bytes / count
+	<< PSTR(", programs = ") << flash_counter.programs / count
+	<< PSTR(", program_bytes = ") << flash_counter.program_bytes / count
+	<< PSTR(", erases = ") << flash_counter.erases
+	<< endl;
+  flash_counter.reset();
+}
+#elif defined(USE_FAT16)
+void print(str_P op, uint16_t count)
+{
+  trace << op
+	<< PSTR(": reads = ") << sd_counter.reads / count
+	<< PSTR(", writes = ") << sd_counter.writes / count
+	<< PSTR(", erases = ") << sd_counter.erases
+	<< endl;
+  sd_counter.reset();
+}
+#endif
+
+void setup()
+{
+  uart.begin(57600);
+  trace.begin(&uart, PSTR("CosaBenchmarkFS: started"));
+  TRACE(free_memory());
+  Watchdog::begin();
+  RTC::begin();
+
+#if defined(USE_CFFS)
+  ASSERT(flash_counter.begin());
+  ASSERT(CFFS::format(&flash_counter, "bench") == 0);
+  flash_counter.reset();
+  ASSERT(CFFS::begin(&flash_counter));
+  print(PSTR("mount"), 1);
+#elif defined(USE_FAT16)
+  ASSERT(sd.begin(SPI::DIV2_CLOCK));
+  ASSERT(FAT16::begin(&sd_counter));
+  print(PSTR("mount"), 1);
+#endif
+}
+
+void loop()
+{
+  char buf[RECORD_MAX];
+  memset(buf, '.', sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\n';
+
+#if defined(USE_CFFS)
+  CFFS::File file;
+
+  // Create, append, reopen for append and seek
+  ASSERT(file.open("bench", O_CREAT) == 0);
+  print(PSTR("create"), 1);
+  for (uint16_t i = 0; i < APPEND_MAX; i++)
+    ASSERT(file.write(buf, sizeof(buf)) == sizeof(buf));
+  print(PSTR("append"), APPEND_MAX);
+  ASSERT(file.close() == 0);
+  ASSERT(file.open("bench", O_WRITE) == 0);
+  print(PSTR("open(append)"), 1);
+  ASSERT(file.close() == 0);
+  ASSERT(file.open("bench", O_READ) == 0);
+  for (uint16_t i = 0; i < APPEND_MAX; i++)
+    ASSERT(file.seek(((i * 37) % APPEND_MAX) * sizeof(buf)) == 0);
+  print(PSTR("seek"), APPEND_MAX);
+  ASSERT(file.close() == 0);
+
+  // List directory and remove file
+  CFFS::ls(trace);
+  print(PSTR("ls"), 1);
+  ASSERT(CFFS::rm("bench") == 0);
+  print(PSTR("rm"), 1);
+#elif defined(USE_FAT16)
+  FAT16::File file;
+
+  // Create, append, reopen for append and seek
+  ASSERT(file.open("BENCH.TXT", O_WRITE | O_CREAT | O_TRUNC));
+  print(PSTR("create"), 1);
+  for (uint16_t i = 0; i < APPEND_MAX; i++)
+    ASSERT(file.write(buf, sizeof(buf)) == sizeof(buf));
+  ASSERT(file.close());
+  print(PSTR("append"), APPEND_MAX);
+  ASSERT(file.open("BENCH.TXT", O_WRITE | O_APPEND));
+  print(PSTR("open(append)"), 1);
+  ASSERT(file.close());
+  ASSERT(file.open("BENCH.TXT", O_READ));
+  for (uint16_t i = 0; i < APPEND_MAX; i++)
+    ASSERT(file.seek(((i * 37) % APPEND_MAX) * sizeof(buf)));
+  print(PSTR("seek"), APPEND_MAX);
+  ASSERT(file.close());
+
+  // List directory and remove file
+  FAT16::ls(trace);
+  print(PSTR("ls"), 1);
+  ASSERT(FAT16::rm("BENCH.TXT"));
+  print(PSTR("rm"), 1);
+#endif
+
+  sleep(5);
+}
@@ -32,6 +32,9 @@
  * operator syntax Cosa is between 2-10X faster allowing high speed
  * protocols.
  *
+ * The compile-time pins (GPIO<PIN> and PortGroup<PINS...>) hold no
+ * state and the pin operations are reduced to single instructions.
+ *
  * The digital pin object holds reference to special function register
  * (port), pin mask and pin number (total of 4 bytes). The analog pin
  * object holds the ADC channel number, latest sample, reference
@@ -39,7 +42,7 @@
  *
  * @section Circuit
  * This example requires no special circuit. Uses serial output,
- * and pins D7-D9 and A0.
+ * and pins D7-D10 and A0.
  *
  * This file is part of the Arduino Che Cosa project.
  */
@@ -48,6 +51,7 @@
 #include "Cosa/InputPin.hh"
 #include "Cosa/OutputPin.hh"
 #include "Cosa/AnalogPin.hh"
+#include "Cosa/GPIO.hh"
 #include "Cosa/RTC.hh"
 #include "Cosa/Memory.h"
 #include "Cosa/Watchdog.hh"
@@ -62,6 +66,14 @@ OutputPin dataPin(Board::D9);
 OutputPin clockPin(Board::D10);
 AnalogPin analogPin(Board::A0);
 
+// Compile-time pins; same pins as above. The port group requires
+// D8-D10 on the same port (ATmega328P)
+GPIO<Board::D7> inGPIO;
+GPIO<Board::D8> outGPIO;
+GPIO<Board::D9> dataGPIO;
+GPIO<Board::D10> clockGPIO;
+PortGroup<Board::D8, Board::D9, Board::D10> outGroup;
+
 // Simple adaptation of the Arduino/Wiring API but with strong
 // data typed pins
 inline void pinMode(Board::DigitalPin pin, uint8_t mode)
@@ -277,6 +289,24 @@ void loop()
     __asm__ __volatile__("nop");
   }
 
+  MEASURE_NS("outGPIO.set/clear()") {
+    outGPIO.set();
+    outGPIO.clear();
+    __asm__ __volatile__("nop");
+  }
+
+  MEASURE_NS("outGPIO.toggle()") {
+    outGPIO.toggle();
+    outGPIO.toggle();
+    __asm__ __volatile__("nop");
+  }
+
+  MEASURE_NS("outGroup.write(7/0)") {
+    outGroup.write(7);
+    outGroup.write(0);
+    __asm__ __volatile__("nop");
+  }
+
   MEASURE_SUITE("Measure the time to perform input pin read/output pin write");
 
   MEASURE_NS("outPin.write(!inPin.read())") {
@@ -330,6 +360,11 @@ void loop()
     __asm__ __volatile__("nop");
   }
 
+  MEASURE_NS("outGPIO.write(inGPIO.is_clear())") {
+    outGPIO.write(inGPIO.is_clear());
+    __asm__ __volatile__("nop");
+  }
+
   MEASURE_SUITE("Measure the time to perform 8-bit serial data transfer");
 
   MEASURE_US("pin.write(data,clk)") {
@@ -456,6 +491,15 @@ void loop()
     }
   }
 
+  MEASURE_US("GPIO write/toggle()") {
+    uint8_t data = 0x55;
+    for(uint8_t bit = 0x80; bit; bit >>= 1) {
+      dataGPIO.write(data & bit);
+      clockGPIO.toggle();
+      clockGPIO.toggle();
+    }
+  }
+
   MEASURE_SUITE("Measure the time to read analog pin");
 
   MEASURE_US("analogPin.sample()") {
@@ -0,0 +1,112 @@
+/**
+ * @file CosaBenchmarkSPI.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Benchmarking SPI bus; ILI9341 fill rectangle and SD block read.
+ * The same sketch is used for the SPI hardware module and USART in
+ * Master SPI Mode (MSPIM). Build the Cosa core with USE_SPI_USART
+ * defined (Cosa/SPI.hh) to benchmark the USART bus and compare with
+ * the results of the default build.
+ *
+ * @section Circuit
+ * ILI9341 and SD on the SPI bus; see CosaCanvasDemo and CosaFAT16.
+ * With USE_SPI_USART the bus signals are MOSI/TXDn, MISO/RXDn and
+ * SCK/XCKn. When USART0 is used for the bus the trace output is on
+ * D2 (Soft::UAT).
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+#include "Cosa/Canvas/Driver/ILI9341.hh"
+#include "Cosa/SPI/Driver/SD.hh"
+
+// The serial port is not available when USART0 is the SPI bus
+#if defined(USE_SPI_USART) && (USE_SPI_USART == 0)
+#include "Cosa/Soft/UART.hh"
+Soft::UAT console(Board::D2);
+#endif
+
+ILI9341 tft;
+
+#if defined(WICKEDDEVICE_WILDFIRE)
+SD sd(Board::D16);
+#else
+SD sd;
+#endif
+
+// Number of blocks to read in benchmark
+static const uint16_t BLOCK_MAX = 100;
+
+void setup()
+{
+  // Start trace output stream on the serial port
+#if defined(USE_SPI_USART) && (USE_SPI_USART == 0)
+  console.begin(9600);
+  trace.begin(&console, PSTR("CosaBenchmarkSPI: started"));
+#else
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaBenchmarkSPI: started"));
+#endif
+
+  // Print bus implementation and size of instances
+#if defined(USE_SPI_USART)
+  TRACE(USE_SPI_USART);
+#endif
+  TRACE(free_memory());
+  TRACE(sizeof(SPI));
+  TRACE(sizeof(SPI::Driver));
+
+  // Start the watchdog and real-time clock
+  Watchdog::begin();
+  RTC::begin();
+
+  // Initiate the devices
+  ASSERT(tft.begin());
+  ASSERT(sd.begin(SPI::DIV2_CLOCK));
+}
+
+void loop()
+{
+  // Fill the screen; 240x320 pixels, 16-bit color
+  uint32_t pixels = (uint32_t) tft.WIDTH * tft.HEIGHT;
+  MEASURE("ILI9341::fill_rect:", 1) {
+    tft.set_pen_color(Canvas::RED);
+    tft.fill_rect(0, 0, tft.WIDTH, tft.HEIGHT);
+  }
+  trace << pixels * 1000L / (trace.measure / 1000L)
+	<< PSTR(" pixels/s") << endl;
+
+  // Fill small rectangles; command overhead
+  MEASURE("ILI9341::fill_rect(10x10):", 100) {
+    tft.set_pen_color(Canvas::BLUE);
+    tft.fill_rect(10, 10, 10, 10);
+  }
+
+  // Read sequence of blocks
+  static uint8_t buf[SD::BLOCK_MAX];
+  MEASURE("SD::read:", BLOCK_MAX) sd.read(0, buf);
+  trace << SD::BLOCK_MAX * 1000000L / trace.measure
+	<< PSTR(" bytes/s") << endl;
+  trace << endl;
+
+  sleep(5);
+}
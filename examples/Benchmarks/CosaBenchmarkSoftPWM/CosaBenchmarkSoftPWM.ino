@@ -0,0 +1,137 @@
+/**
+ * @file CosaBenchmarkSoftPWM.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Benchmark the software PWM; 8-bit resolution at 200 Hz with up to
+ * SoftPWM::CHANNEL_MAX (16) channels. The interrupt load is measured
+ * with a counting loop that is calibrated against an idle period.
+ * The channels are given distinct duties (worst case; one edge per
+ * channel) and the same duty (one edge for all channels). The
+ * interrupt handler cycles per edge are calculated; these should be
+ * below SoftPWM::ISR_CYCLES.
+ *
+ * @section Circuit
+ * LEDs with current limiting resistors on D2-D17 (Arduino Uno;
+ * ports D, B and C). On boards where the pins are on more than
+ * SoftPWM::PORT_MAX ports the remaining pins are ignored.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/SoftPWM.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// PWM pins
+const Board::DigitalPin pins[] __PROGMEM = {
+  Board::D2, Board::D3, Board::D4, Board::D5,
+  Board::D6, Board::D7, Board::D8, Board::D9,
+  Board::D10, Board::D11, Board::D12, Board::D13,
+  Board::D14, Board::D15, Board::D16, Board::D17
+};
+SoftPWM pwm(pins, membersof(pins));
+
+// Frequency and measurement period (ms)
+static const uint16_t FREQ = 200;
+static const uint16_t PERIOD = 1000;
+
+// Counting loop iterations per milli-second (calibrated)
+uint32_t loops_per_ms;
+
+/**
+ * Measure interrupt load with the given number of channels with
+ * distinct or same duty and print the result.
+ */
+void measure(uint8_t channels, bool distinct)
+{
+  uint8_t duty[SoftPWM::CHANNEL_MAX];
+  for (uint8_t i = 0; i < pwm.get_count(); i++)
+    duty[i] = (i < channels) ? (distinct ? 8 + i * 15 : 128) : 0;
+  pwm.set(duty);
+
+  // Count loop iterations while running
+  uint32_t loops = 0;
+  uint32_t start = RTC::millis();
+  while (RTC::since(start) < PERIOD) loops++;
+
+  // Calculate interrupt load and cycles per edge
+  uint32_t available = loops / loops_per_ms;
+  if (available > PERIOD) available = PERIOD;
+  uint16_t load = ((PERIOD - available) * 1000) / PERIOD;
+  uint16_t edges = (distinct ? channels : 1) + 1;
+  uint32_t cycles =
+    ((PERIOD - available) * (F_CPU / 1000)) / ((uint32_t) edges * FREQ);
+  trace << PSTR("channels = ") << channels
+	<< (distinct ? PSTR(", distinct") : PSTR(", same"))
+	<< PSTR(", load = ") << load / 10 << '.' << load % 10
+	<< PSTR("%, isr = ") << cycles
+	<< PSTR(" cycles") << endl;
+}
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaBenchmarkSoftPWM: started"));
+
+  // Print some memory statistics
+  TRACE(free_memory());
+  TRACE(sizeof(SoftPWM));
+
+  // Start the watchdog and real-time clock
+  Watchdog::begin();
+  RTC::begin();
+
+  // Calibrate the counting loop
+  uint32_t count = 0;
+  uint32_t start = RTC::millis();
+  while (RTC::since(start) < 100) count++;
+  loops_per_ms = count / 100;
+  TRACE(loops_per_ms);
+
+  // Start the software PWM
+  ASSERT(pwm.begin(FREQ));
+  TRACE(pwm.get_count());
+  TRACE(SoftPWM::ISR_CYCLES);
+}
+
+void loop()
+{
+  static const uint8_t channels[] __PROGMEM = { 1, 4, 8, 12, 16 };
+
+  for (uint8_t i = 0; i < membersof(channels); i++) {
+    uint8_t n = pgm_read_byte(&channels[i]);
+    if (n > pwm.get_count()) break;
+    measure(n, true);
+    measure(n, false);
+  }
+  trace << endl;
+
+  // Fade all channels with a phase shift; single schedule update
+  uint8_t duty[SoftPWM::CHANNEL_MAX];
+  for (uint16_t step = 0; step < 512; step++) {
+    for (uint8_t i = 0; i < pwm.get_count(); i++) {
+      uint8_t phase = step + i * 16;
+      duty[i] = (phase < 128) ? phase * 2 : (255 - phase) * 2;
+    }
+    pwm.set(duty);
+    delay(10);
+  }
+}
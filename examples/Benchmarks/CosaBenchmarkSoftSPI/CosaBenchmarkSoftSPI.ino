@@ -0,0 +1,148 @@
+/**
+ * @file CosaBenchmarkSoftSPI.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Benchmarking soft SPI; measure bytes per second for block write
+ * and transfer with Soft::SPI (runtime pins), Soft::FastSPI (template
+ * pins) and the hardware SPI module at DIV2 and DIV4 clock.
+ *
+ * @section Circuit
+ * No devices are required. The soft SPI bus uses D5 (MOSI), D6
+ * (MISO) and D7 (SCK), and the chip select pins are D8-D10. Connect
+ * a logic analyzer to verify the bus signals.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/SPI.hh"
+#include "Cosa/Soft/SPI.hh"
+#include "Cosa/Soft/FastSPI.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// Soft SPI with runtime pins
+namespace Soft {
+  SPI spi(Board::D6, Board::D5, Board::D7);
+};
+Soft::SPI::Driver soft_dev(Board::D8);
+
+// Soft SPI with compile-time pins
+typedef Soft::FastSPI<Board::D5, Board::D6, Board::D7> FastSPI;
+FastSPI fast_spi;
+FastSPI::Driver fast_dev(Board::D9);
+
+// Hardware SPI; clock setting is changed per benchmark
+SPI::Driver hw_dev(Board::D10);
+
+// Block size for benchmark
+static const size_t BLOCK_MAX = 64;
+static uint8_t buf[BLOCK_MAX];
+
+void print_rate()
+{
+  trace << BLOCK_MAX * 1000000L / trace.measure
+	<< PSTR(" bytes/s") << endl;
+}
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaBenchmarkSoftSPI: started"));
+
+  // Print some memory statistics
+  TRACE(free_memory());
+  TRACE(sizeof(Soft::SPI));
+  TRACE(sizeof(Soft::SPI::Driver));
+  TRACE(sizeof(FastSPI));
+  TRACE(sizeof(FastSPI::Driver));
+
+  // Start the watchdog and real-time clock
+  Watchdog::begin();
+  RTC::begin();
+
+  for (size_t i = 0; i < BLOCK_MAX; i++) buf[i] = i;
+}
+
+void loop()
+{
+  // Soft SPI with runtime pins
+  MEASURE("Soft::SPI::write:", 10) {
+    Soft::spi.acquire(&soft_dev);
+    Soft::spi.begin();
+    Soft::spi.write(buf, sizeof(buf));
+    Soft::spi.end();
+    Soft::spi.release();
+  }
+  print_rate();
+  MEASURE("Soft::SPI::transfer:", 10) {
+    Soft::spi.acquire(&soft_dev);
+    Soft::spi.begin();
+    Soft::spi.transfer(buf, sizeof(buf));
+    Soft::spi.end();
+    Soft::spi.release();
+  }
+  print_rate();
+
+  // Soft SPI with compile-time pins
+  MEASURE("Soft::FastSPI::write:", 10) {
+    fast_spi.acquire(&fast_dev);
+    fast_spi.begin();
+    fast_spi.write(buf, sizeof(buf));
+    fast_spi.end();
+    fast_spi.release();
+  }
+  print_rate();
+  MEASURE("Soft::FastSPI::transfer:", 10) {
+    fast_spi.acquire(&fast_dev);
+    fast_spi.begin();
+    fast_spi.transfer(buf, sizeof(buf));
+    fast_spi.end();
+    fast_spi.release();
+  }
+  print_rate();
+
+  // Hardware SPI module at DIV2 and DIV4
+  static const SPI::Clock rate[] = { SPI::DIV2_CLOCK, SPI::DIV4_CLOCK };
+  for (uint8_t i = 0; i < membersof(rate); i++) {
+    hw_dev.set_clock(rate[i]);
+    trace << PSTR("clock = ") << (rate[i] == SPI::DIV2_CLOCK ? 2 : 4)
+	  << endl;
+    MEASURE("SPI::write:", 10) {
+      spi.acquire(&hw_dev);
+      spi.begin();
+      spi.write(buf, sizeof(buf));
+      spi.end();
+      spi.release();
+    }
+    print_rate();
+    MEASURE("SPI::transfer:", 10) {
+      spi.acquire(&hw_dev);
+      spi.begin();
+      spi.transfer(buf, sizeof(buf));
+      spi.end();
+      spi.release();
+    }
+    print_rate();
+  }
+  trace << endl;
+
+  sleep(5);
+}
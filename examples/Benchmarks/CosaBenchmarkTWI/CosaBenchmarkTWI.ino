@@ -0,0 +1,111 @@
+/**
+ * @file CosaBenchmarkTWI.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Benchmarking TWI bus clock; measure throughput of ADXL345 sample,
+ * DS3231 time read and AT24CXX block read for standard mode (100
+ * KHz), fast mode (400 KHz) and fast mode plus (1 MHz). The bus
+ * clock is set per device driver. The last round uses the highest
+ * frequency of each device on the same bus.
+ *
+ * @section Circuit
+ * ADXL345 (alternative address, 0x53) and a DS3231 RTC module with
+ * AT24C32 EEPROM (sub-address 0b000) on the TWI bus. See CosaADXL345
+ * and CosaAT24CXX.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/TWI/Driver/ADXL345.hh"
+#include "Cosa/TWI/Driver/DS3231.hh"
+#include "Cosa/TWI/Driver/AT24CXX.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+ADXL345 acceleratometer(1);
+DS3231 rtc;
+AT24C32 eeprom(0);
+
+// Block size for eeprom read
+static const size_t BLOCK_MAX = 32;
+
+void benchmark(uint32_t freq)
+{
+  if (freq != 0) {
+    acceleratometer.set_freq(freq);
+    rtc.set_freq(freq);
+    eeprom.set_freq(freq);
+    trace << PSTR("freq = ") << freq << endl;
+  }
+  else {
+    trace << PSTR("freq = mixed") << endl;
+  }
+
+  // Acceleratometer sample; register address and six data bytes
+  ADXL345::sample_t sample;
+  MEASURE("ADXL345::sample:", 100) acceleratometer.sample(sample);
+  trace << sizeof(sample) * 1000000L / trace.measure
+	<< PSTR(" bytes/s") << endl;
+
+  // Real-time clock time; register address and seven data bytes
+  time_t now;
+  MEASURE("DS3231::get_time:", 100) rtc.get_time(now);
+  trace << sizeof(now) * 1000000L / trace.measure
+	<< PSTR(" bytes/s") << endl;
+
+  // EEPROM block read; address and block data
+  uint8_t buf[BLOCK_MAX];
+  MEASURE("AT24CXX::read:", 100) eeprom.read(buf, (void*) 0, sizeof(buf));
+  trace << sizeof(buf) * 1000000L / trace.measure
+	<< PSTR(" bytes/s") << endl;
+  trace << endl;
+}
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaBenchmarkTWI: started"));
+
+  // Print some memory statistics
+  TRACE(free_memory());
+  TRACE(sizeof(TWI::Driver));
+  TRACE(TWI::MAX_FREQ);
+
+  // Start the watchdog, real-time clock and the acceleratometer
+  Watchdog::begin();
+  RTC::begin();
+  ASSERT(acceleratometer.begin());
+}
+
+void loop()
+{
+  benchmark(TWI::DEFAULT_FREQ);
+  benchmark(TWI::FAST_FREQ);
+  benchmark(TWI::FAST_PLUS_FREQ);
+
+  // Highest frequency per device; the devices share the bus
+  acceleratometer.set_freq(TWI::FAST_FREQ);
+  rtc.set_freq(TWI::FAST_FREQ);
+  eeprom.set_freq(TWI::FAST_PLUS_FREQ);
+  benchmark(0);
+
+  sleep(5);
+}
@@ -0,0 +1,123 @@
+/**
+ * @file CosaServoSequencer.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Demonstration of the Servo sequencer with 12 servos. The servos
+ * are stepped between angles with atomic updates of all positions.
+ * The pulse of the first servo is captured with InputCapture (sharing
+ * Timer1) and the pulse width and frame period jitter (max - min)
+ * is measured over a number of frames; the other servos are given
+ * close and equal pulse widths to stress the edge schedule. The
+ * timer tick is 0.5 us.
+ *
+ * @section Circuit
+ * Servo pulse inputs on D2-D7 and D9-D14 (Arduino Uno). Connect D2
+ * (first servo) to D8 (ICP1) for the jitter measurement.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/ServoSequencer.hh"
+#include "Cosa/InputCapture.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// Servo pins
+const Board::DigitalPin pins[] __PROGMEM = {
+  Board::D2, Board::D3, Board::D4, Board::D5,
+  Board::D6, Board::D7, Board::D9, Board::D10,
+  Board::D11, Board::D12, Board::D13, Board::D14
+};
+ServoSequencer servos(pins, membersof(pins));
+
+// Edge capture of the first servo pulse
+InputCapture::edge_t buffer[8];
+InputCapture capture(buffer, membersof(buffer),
+		     InputCapture::ON_CHANGE_MODE,
+		     InputCapture::PRESCALE_8);
+
+// Number of frames per measurement
+static const uint8_t FRAMES = 100;
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaServoSequencer: started"));
+
+  // Print some memory statistics
+  TRACE(free_memory());
+  TRACE(sizeof(ServoSequencer));
+
+  // Start the watchdog, capture and sequencer (in this order)
+  Watchdog::begin();
+  ASSERT(capture.begin());
+  ASSERT(servos.begin());
+  TRACE(servos.get_count());
+}
+
+void loop()
+{
+  static const uint8_t step[] __PROGMEM = { 10, 55, 100, 145, 170 };
+  uint8_t angle[ServoSequencer::CHANNEL_MAX];
+  uint8_t count = servos.get_count();
+
+  for (uint8_t i = 0; i < membersof(step); i++) {
+    // Set all servos with the same and close angles
+    uint8_t degree = pgm_read_byte(&step[i]);
+    for (uint8_t j = 0; j < count; j++)
+      angle[j] = degree + (j & 1) * (j >> 1);
+    servos.set_angle(angle);
+    delay(100);
+
+    // Capture the pulse of the first servo for a number of frames
+    InputCapture::edge_t edge;
+    uint32_t rising = 0;
+    uint16_t wmin = UINT16_MAX, wmax = 0;
+    uint16_t pmin = UINT16_MAX, pmax = 0;
+    uint8_t frames = 0;
+    while (capture.read(edge));
+    while (frames < FRAMES) {
+      if (!capture.read(edge)) continue;
+      if (edge.level) {
+	if (rising != 0) {
+	  uint16_t period = edge.time - rising;
+	  if (period < pmin) pmin = period;
+	  if (period > pmax) pmax = period;
+	  frames += 1;
+	}
+	rising = edge.time;
+      }
+      else if (rising != 0) {
+	uint16_t width = edge.time - rising;
+	if (width < wmin) wmin = width;
+	if (width > wmax) wmax = width;
+      }
+    }
+    trace << PSTR("angle = ") << degree
+	  << PSTR(", width = ") << capture.us(wmin)
+	  << PSTR(" us, jitter = ") << wmax - wmin
+	  << PSTR(" ticks, period = ") << capture.us(pmin)
+	  << PSTR(" us, jitter = ") << pmax - pmin
+	  << PSTR(" ticks") << endl;
+    delay(400);
+  }
+  TRACE(capture.get_overruns());
+  trace << endl;
+}
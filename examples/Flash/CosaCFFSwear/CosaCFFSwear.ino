@@ -0,0 +1,116 @@
+/**
+ * @file CosaCFFSwear.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Measure CFFS wear leveling and write amplification. A rolling
+ * configuration file is rewritten and a status file is appended to.
+ * Deleted sectors are reclaimed with a periodic function. The flash
+ * device is wrapped with a counting device (Flash::Counter) to
+ * measure number of programmed bytes and erased sectors. The sector
+ * erase count spread is printed at the end of the run.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/FS/CFFS.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+#include "Cosa/Trace.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/RTC.hh"
+
+//#define USE_FLASH_S25FL127S
+//#define USE_FLASH_W25X40CL
+
+#if defined(USE_FLASH_S25FL127S) || defined(ANARDUINO_MINIWIRELESS)
+#include "Cosa/Flash/Driver/S25FL127S.hh"
+S25FL127S flash;
+#endif
+
+#if defined(USE_FLASH_W25X40CL) || defined(WICKEDDEVICE_WILDFIRE)
+#include "Cosa/Flash/Driver/W25X40CL.hh"
+W25X40CL flash;
+#endif
+
+Flash::Counter device(&flash);
+CFFS::Reclaimer reclaimer(64);
+
+// Number of rounds and size of status record
+static const uint16_t ROUNDS = 100;
+static const size_t RECORD_MAX = 64;
+
+void setup()
+{
+  Watchdog::begin();
+  RTC::begin();
+  uart.begin(57600);
+  trace.begin(&uart, PSTR("CosaCFFSwear: started"));
+
+  // Format and mount the file system; start periodic reclaim
+  ASSERT(device.begin());
+  ASSERT(CFFS::format(&device, "wear") == 0);
+  ASSERT(CFFS::begin(&device));
+  reclaimer.begin();
+
+  // Rewrite configuration and append to status file
+  char buf[RECORD_MAX];
+  uint32_t written = 0L;
+  device.reset();
+  memset(buf, 'x', sizeof(buf) - 1);
+  buf[sizeof(buf) - 1] = '\n';
+  CFFS::File file;
+  MEASURE("Run workload:", 1) {
+    for (uint16_t i = 0; i < ROUNDS; i++) {
+      if (file.open("config", O_CREAT) != 0) break;
+      for (uint8_t j = 0; j < 16; j++) file.write(buf, sizeof(buf));
+      file.close();
+      written += 16 * sizeof(buf);
+      if (file.open("status", O_WRITE) != 0)
+	if (file.open("status", O_CREAT) != 0) break;
+      file.write(buf, sizeof(buf));
+      file.close();
+      written += sizeof(buf);
+      Event::service(128);
+    }
+  }
+  reclaimer.end();
+
+  // Print write amplification
+  TRACE(written);
+  TRACE(device.program_bytes);
+  TRACE(device.erases);
+  trace << PSTR("write amplification = ")
+	<< (device.program_bytes * 100) / written << PSTR("%") << endl;
+
+  // Print erase count spread
+  uint32_t min = 0xffffffffL;
+  uint32_t max = 0L;
+  uint32_t sum = 0L;
+  for (uint16_t i = 1; i < device.SECTOR_MAX; i++) {
+    uint32_t count = CFFS::erase_count(i);
+    if (count < min) min = count;
+    if (count > max) max = count;
+    sum += count;
+  }
+  TRACE(min);
+  TRACE(max);
+  trace << PSTR("mean = ") << sum / (device.SECTOR_MAX - 1) << endl;
+}
+
+void loop()
+{
+  ASSERT(true == false);
+}
@@ -130,6 +130,34 @@ void setup()
   ASSERT(flash.read(&data, last + 1, sizeof(data)) == sizeof(data));
   ASSERT(data == 0xff);
   sleep(5);
+
+  // Erase a 4 Kbyte sector asynchronously; measure erase rate
+  addr = 0xf000L;
+  start = RTC::micros();
+  ASSERT(!flash.erase_request(addr, 4));
+  while (!flash.is_ready()) yield();
+  us = RTC::micros() - start;
+  trace << PSTR("erase: dest = ") << hex << addr
+	<< PSTR(", bytes = ") << 4096
+	<< PSTR(", us = ") << us
+	<< PSTR(", Kbyte/s = ") << 1000.0 * 4096 / us
+	<< endl;
+
+  // Stream program the sector; fill next page during page program
+  start = RTC::micros();
+  for (uint16_t i = 0; i < 4096; i += S25FL127S::PAGE_MAX) {
+    memset(buf, i >> 8, S25FL127S::PAGE_MAX);
+    res = flash.program(addr + i, buf, S25FL127S::PAGE_MAX);
+    ASSERT(res == S25FL127S::PAGE_MAX);
+  }
+  ASSERT(!flash.await());
+  us = RTC::micros() - start;
+  trace << PSTR("program: dest = ") << hex << addr
+	<< PSTR(", bytes = ") << 4096
+	<< PSTR(", us = ") << us
+	<< PSTR(", Kbyte/s = ") << 1000.0 * 4096 / us
+	<< endl;
+  sleep(5);
 }
 
 void loop()
@@ -0,0 +1,120 @@
+/**
+ * @file CosaTimeSeries.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Demonstrate the time series store on flash memory. Samples are
+ * appended until the store has wrapped and the oldest blocks have
+ * been recycled. Range queries and tail reads are measured and the
+ * number of device reads per query is printed (Flash::Counter).
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/FS/TimeSeries.hh"
+#include "Cosa/AnalogPin.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+#include "Cosa/Trace.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/RTC.hh"
+
+//#define USE_FLASH_S25FL127S
+//#define USE_FLASH_W25X40CL
+
+#if defined(USE_FLASH_S25FL127S) || defined(ANARDUINO_MINIWIRELESS)
+#include "Cosa/Flash/Driver/S25FL127S.hh"
+S25FL127S flash;
+#endif
+
+#if defined(USE_FLASH_W25X40CL) || defined(WICKEDDEVICE_WILDFIRE)
+#include "Cosa/Flash/Driver/W25X40CL.hh"
+W25X40CL flash;
+#endif
+
+Flash::Counter device(&flash);
+
+// Sample record; must start with timestamp
+struct sample_t {
+  clock_t time;
+  uint16_t value[6];
+};
+
+// Time series store in sectors 16..23
+static const uint16_t SECTOR = 16;
+static const uint16_t COUNT = 8;
+TimeSeries ts(&device, SECTOR, COUNT, sizeof(sample_t));
+
+void setup()
+{
+  Watchdog::begin();
+  RTC::begin();
+  uart.begin(57600);
+  trace.begin(&uart, PSTR("CosaTimeSeries: started"));
+
+  // Start with an empty store
+  ASSERT(device.begin());
+  TRACE(ts.records());
+  MEASURE("erase:", 1) ASSERT(ts.erase() == 0);
+  ASSERT(ts.begin() == 0);
+
+  // Append samples until the oldest blocks have been recycled
+  uint32_t samples = (COUNT + 2) * ts.records();
+  sample_t sample;
+  MEASURE("append:", 1) {
+    for (uint32_t i = 0; i < samples; i++) {
+      sample.time = i * 10;
+      for (uint8_t j = 0; j < membersof(sample.value); j++)
+	sample.value[j] = AnalogPin::sample(Board::A0);
+      ASSERT(ts.append(&sample) == 0);
+    }
+  }
+  TRACE(device.erases);
+  TRACE(device.programs);
+
+  // Remount; scan the block headers
+  device.reset();
+  MEASURE("begin:", 1) TRACE(ts.begin());
+  TRACE(device.reads);
+
+  // Tail read
+  device.reset();
+  MEASURE("last:", 1) ts.last(&sample);
+  TRACE(sample.time);
+  TRACE(device.reads);
+
+  // Range queries
+  TimeSeries::pos_t pos;
+  clock_t t1 = ts.last_time() / 2;
+  clock_t t2 = t1 + 100;
+  device.reset();
+  MEASURE("find:", 1) pos = ts.find(t1);
+  TRACE(device.reads);
+  while (ts.read(pos, &sample) > 0 && sample.time <= t2)
+    trace << sample.time << ':' << sample.value[0] << endl;
+
+  // Query before the oldest and after the latest sample
+  device.reset();
+  pos = ts.find(0);
+  ASSERT(ts.read(pos, &sample) > 0);
+  TRACE(sample.time);
+  ASSERT(ts.find(ts.last_time() + 1) == ts.end());
+  TRACE(device.reads);
+}
+
+void loop()
+{
+  ASSERT(true == false);
+}
@@ -0,0 +1,103 @@
+/**
+ * @file CosaDS18B20group.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Cosa demonstration of the DS18B20 group; measure the refresh
+ * period for up to 16 thermometers on the 1-Wire bus. A refresh with
+ * a convert request and scratchpad read per device is compared with
+ * the group broadcast conversion and scratchpad reads, and with
+ * the group alarm search.
+ *
+ * @section Circuit
+ * Up to 16 DS18B20 on the 1-Wire bus on D7 with 4K7 pullup resistor.
+ * See CosaDS18B20. The devices may be in parasite power mode.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/OWI/Driver/DS18B20.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// One-wire bus and thermometers
+OWI owi(Board::D7);
+
+static const uint8_t SENSOR_MAX = 16;
+DS18B20 sensor[SENSOR_MAX] = {
+  &owi, &owi, &owi, &owi, &owi, &owi, &owi, &owi,
+  &owi, &owi, &owi, &owi, &owi, &owi, &owi, &owi
+};
+DS18B20* dev[SENSOR_MAX];
+uint8_t count = 0;
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaDS18B20group: started"));
+
+  // Check amount of free memory
+  TRACE(free_memory());
+  TRACE(sizeof(DS18B20));
+  TRACE(sizeof(DS18B20::Group));
+
+  // Start the watchdog and real-time clock
+  Watchdog::begin();
+  RTC::begin();
+
+  // Connect to the devices and set alarm thresholds
+  for (uint8_t i = 0; i < SENSOR_MAX; i++) {
+    DS18B20* t = &sensor[i];
+    if (!t->connect(i)) break;
+    t->set_resolution(12);
+    t->set_trigger(18, 22);
+    t->write_scratchpad();
+    dev[count++] = t;
+  }
+  TRACE(count);
+}
+
+void loop()
+{
+  DS18B20::Group group(&owi, dev, count);
+  uint8_t res;
+
+  // Convert request and scratchpad read per device
+  MEASURE("device refresh:", 1) {
+    res = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      if (dev[i]->convert_request() && dev[i]->read_scratchpad())
+	res += 1;
+    }
+  }
+  TRACE(res);
+
+  // Broadcast conversion and scratchpad read of all devices
+  MEASURE("group refresh:", 1) res = group.refresh();
+  TRACE(res);
+  for (uint8_t i = 0; i < count; i++) trace << *dev[i] << endl;
+
+  // Broadcast conversion and read of devices with alarm
+  MEASURE("group alarm refresh:", 1) res = group.refresh(true);
+  TRACE(res);
+  trace << endl;
+
+  sleep(5);
+}
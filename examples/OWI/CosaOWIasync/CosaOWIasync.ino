@@ -0,0 +1,130 @@
+/**
+ * @file CosaOWIasync.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Measure CPU time per 1-Wire transaction; reset, skip rom, read
+ * scratchpad command and scratchpad read (9 bytes with CRC). The
+ * blocking transaction is compared with the asynchronous timer driven
+ * engine. The CPU time available to the application during the
+ * transaction is measured with a counting loop that is calibrated
+ * against an idle period.
+ *
+ * @section Circuit
+ * A single DS18B20 on the 1-Wire bus on D7 (D1 on ATtiny) with 4K7
+ * pullup resistor. See CosaDS18B20. Powered (not parasite mode).
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/OWI.hh"
+#include "Cosa/Event.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+#if defined(BOARD_ATTINY)
+Soft::UAT uart(Board::D2);
+OWI owi(Board::D1);
+#else
+OWI owi(Board::D7);
+#endif
+
+// Scratchpad read command; skip rom and read scratchpad
+static const uint8_t READ_SCRATCHPAD = 0xBE;
+static const uint8_t command[] = { OWI::SKIP_ROM, READ_SCRATCHPAD };
+static const uint8_t SCRATCHPAD_MAX = 9;
+
+// Event handler for completion events
+class Completion : public Event::Handler {
+} completion;
+
+// Counting loop iterations per milli-second (calibrated)
+uint32_t loops_per_ms;
+
+/**
+ * Count loop iterations until an event is available or the given
+ * time has passed. Used both for calibration and measurement so that
+ * the loop body is the same.
+ * @param[in] start time (RTC::millis).
+ * @param[in] ms max time.
+ * @return loop iterations.
+ */
+uint32_t count_until_event(uint32_t start, uint16_t ms)
+{
+  uint32_t count = 0;
+  while (!Event::queue.available() && RTC::since(start) < ms) count++;
+  return (count);
+}
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaOWIasync: started"));
+
+  // Print some memory statistics
+  TRACE(free_memory());
+  TRACE(sizeof(OWI));
+
+  // Start the watchdog and real-time clock
+  Watchdog::begin();
+  RTC::begin();
+
+  // Calibrate the counting loop; no events are pending
+  loops_per_ms = count_until_event(RTC::millis(), 100) / 100;
+  TRACE(loops_per_ms);
+}
+
+void loop()
+{
+  uint8_t scratchpad[SCRATCHPAD_MAX];
+  bool valid;
+
+  // Blocking transaction; elapsed time
+  MEASURE("blocking:", 1) {
+    owi.reset();
+    owi.write(OWI::SKIP_ROM);
+    owi.write(READ_SCRATCHPAD);
+    valid = owi.read(scratchpad, sizeof(scratchpad));
+  }
+  TRACE(valid);
+
+  // Asynchronous transaction; elapsed and available CPU time
+  uint32_t start = RTC::micros();
+  owi.request(&completion, true,
+	      command, sizeof(command),
+	      scratchpad, sizeof(scratchpad));
+  uint32_t loops = count_until_event(RTC::millis(), 1000);
+  uint32_t elapsed = RTC::micros() - start;
+  Event event;
+  Event::queue.dequeue(&event);
+  int res = owi.await_completed();
+  uint32_t available = (loops * 1000) / loops_per_ms;
+  if (available > elapsed) available = elapsed;
+  trace << PSTR("asynchronous: elapsed = ") << elapsed
+	<< PSTR(" us, cpu = ") << elapsed - available
+	<< PSTR(" us") << endl;
+  TRACE(event.get_type());
+  TRACE(res);
+  TRACE(owi.is_crc_valid());
+  trace.print(scratchpad, sizeof(scratchpad), IOStream::hex);
+  trace << endl;
+
+  sleep(2);
+}
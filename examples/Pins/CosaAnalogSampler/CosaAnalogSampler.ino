@@ -0,0 +1,145 @@
+/**
+ * @file CosaAnalogSampler.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Cosa free-running analog pin set sampler; three channels with 16X
+ * oversampling (12-bit) and IIR filter. The sampler is run at
+ * increasing conversion rates. The CPU load of the interrupt handler
+ * is measured with a counting loop that is calibrated with the same
+ * loop body while the sampler is stopped, and the interrupt handler
+ * cycles per conversion are calculated. The copying of frames is
+ * included in the load; a few cycles per conversion. The maximum sustainable rate is reached when frames
+ * are dropped (overruns) or the load approaches 100%.
+ *
+ * @section Circuit
+ * Potentiometers or other analog sources on A0-A2.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/AnalogSampler.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// Analog pins in sampled set
+const Board::AnalogPin pins[] __PROGMEM = {
+  Board::A0, Board::A1, Board::A2
+};
+static const uint8_t PIN_MAX = membersof(pins);
+
+// Ring buffer for frames
+uint16_t buffer[32];
+
+AnalogSampler sampler(pins, PIN_MAX, buffer, membersof(buffer));
+
+// Counting loop iterations per milli-second (calibrated)
+uint32_t loops_per_ms;
+
+// Measurement period (ms)
+static const uint16_t PERIOD = 1000;
+
+/**
+ * Count loop iterations while reading frames for the given time.
+ * Used both for calibration (sampler stopped) and measurement so that
+ * the loop body is the same.
+ * @param[in] ms time period.
+ * @param[in] frame buffer for values.
+ * @param[out] frames number of frames read.
+ * @return loop iterations.
+ */
+uint32_t count_reading(uint16_t ms, uint16_t* frame, uint16_t &frames)
+{
+  uint32_t loops = 0;
+  uint32_t start = RTC::millis();
+  frames = 0;
+  while (RTC::since(start) < ms) {
+    if (sampler.read(frame)) frames++;
+    loops++;
+  }
+  return (loops);
+}
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaAnalogSampler: started"));
+
+  // Print some memory statistics
+  TRACE(free_memory());
+  TRACE(sizeof(AnalogSampler));
+
+  // Start the watchdog and real-time clock
+  Watchdog::begin();
+  RTC::begin();
+
+  // Calibrate the counting loop with the sampler stopped
+  uint16_t frame[PIN_MAX];
+  uint16_t frames;
+  loops_per_ms = count_reading(100, frame, frames) / 100;
+  TRACE(loops_per_ms);
+
+  // Oversampling 16X (12-bit) and filter coefficient 1/4
+  sampler.set_oversampling(2);
+  sampler.set_filter(2);
+}
+
+void loop()
+{
+  static const uint16_t rate[] __PROGMEM = {
+    1000, 5000, 10000, 20000, 40000, 60000
+  };
+  uint16_t frame[PIN_MAX];
+
+  for (uint8_t i = 0; i < membersof(rate); i++) {
+    // Select ADC clock prescale; conversion time (13 cycles) within
+    // the sample period. ADC clock above 200 KHz reduces accuracy
+    uint16_t hz = pgm_read_word(&rate[i]);
+    uint8_t factor = 7;
+    while ((factor > 2) && ((13UL << factor) * hz > F_CPU)) factor--;
+    AnalogPin::prescale(factor);
+
+    // Run the sampler and count loop iterations while reading frames
+    uint16_t frames;
+    ASSERT(sampler.begin(hz));
+    uint32_t loops = count_reading(PERIOD, frame, frames);
+    sampler.end();
+
+    // Calculate interrupt load and cycles per conversion
+    uint32_t available = loops / loops_per_ms;
+    if (available > PERIOD) available = PERIOD;
+    uint16_t load = ((PERIOD - available) * 100) / PERIOD;
+    uint32_t cycles = ((PERIOD - available) * (F_CPU / 1000)) / hz;
+    trace << PSTR("rate = ") << hz
+	  << PSTR(", prescale = ") << _BV(factor)
+	  << PSTR(", frames = ") << frames
+	  << PSTR(", overruns = ") << sampler.get_overruns()
+	  << PSTR(", load = ") << load
+	  << PSTR("%, isr = ") << cycles
+	  << PSTR(" cycles") << endl;
+  }
+
+  // Print the latest frame
+  for (uint8_t i = 0; i < PIN_MAX; i++)
+    trace << PSTR("A") << i << PSTR(" = ") << frame[i] << endl;
+  trace << endl;
+
+  sleep(5);
+}
@@ -0,0 +1,90 @@
+/**
+ * @file CosaInputCapture.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Cosa demonstration of timestamped edge capture. Pulses with given
+ * width are generated on an output pin and captured on the input
+ * capture pin. The captured pulse width is calculated from the edge
+ * timestamps in the main loop and compared with the generated pulse
+ * width.
+ *
+ * @section Circuit
+ * Connect D7 to the input capture pin; Arduino Uno D8, Arduino
+ * Leonardo D4.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/InputCapture.hh"
+#include "Cosa/OutputPin.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// Pulse generator pin
+OutputPin pulse(Board::D7);
+
+// Ring buffer for edges and input capture on both edges
+InputCapture::edge_t buffer[16];
+InputCapture capture(buffer, membersof(buffer));
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaInputCapture: started"));
+
+  // Print some memory statistics
+  TRACE(sizeof(InputCapture));
+  TRACE(sizeof(InputCapture::edge_t));
+
+  // Start the watchdog and input capture
+  Watchdog::begin();
+  ASSERT(capture.begin());
+}
+
+void loop()
+{
+  static const uint16_t width[] __PROGMEM = {
+    5, 10, 50, 100, 500, 1000
+  };
+  InputCapture::edge_t rising;
+  InputCapture::edge_t falling;
+
+  for (uint8_t i = 0; i < membersof(width); i++) {
+    // Generate a pulse with the given width
+    uint16_t us = pgm_read_word(&width[i]);
+    pulse.set();
+    DELAY(us);
+    pulse.clear();
+
+    // Read the edges and calculate the pulse width
+    while (capture.available() < 2) yield();
+    capture.read(rising);
+    capture.read(falling);
+    uint32_t ticks = falling.time - rising.time;
+    trace << PSTR("pulse = ") << us
+	  << PSTR(" us, level = ") << rising.level << falling.level
+	  << PSTR(", ticks = ") << ticks
+	  << PSTR(", width = ") << capture.us(ticks)
+	  << PSTR(" us") << endl;
+  }
+  TRACE(capture.get_overruns());
+  trace << endl;
+
+  sleep(2);
+}
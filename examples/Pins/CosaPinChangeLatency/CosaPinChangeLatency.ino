@@ -0,0 +1,180 @@
+/**
+ * @file CosaPinChangeLatency.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Cosa Pin Change Interrupt latency benchmark. The pins on a port are
+ * set to output mode (pin change interrupts are also triggered by
+ * output changes) and toggled with a single write to the PIN register.
+ * Timer1 is used as a free-running cycle counter. The number of cycles
+ * to the first handler call (entry) and to the return from the
+ * interrupt (total) are measured with 1, 4 and all pins changing;
+ * with one interrupt pin handler per pin and with a single port
+ * handler. The minimum of several runs is reported.
+ *
+ * @section Circuit
+ * Arduino Mega: PCI16-PCI23 (A8-A15, 8 pins). Arduino Uno: PCI8-PCI13
+ * (D8-D13, 6 pins). The pins should be left open; they are driven
+ * by the benchmark.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/PinChangeInterrupt.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// Cycle counter at first handler call and number of handler calls
+volatile uint16_t stamp = 0;
+volatile uint8_t calls = 0;
+
+class Probe : public PinChangeInterrupt {
+public:
+  Probe(Board::InterruptPin pin) : PinChangeInterrupt(pin) {}
+
+  virtual void on_interrupt(uint16_t arg)
+  {
+    UNUSED(arg);
+    if (stamp == 0) stamp = TCNT1;
+    calls += 1;
+  }
+};
+
+class PortProbe : public PinChangeInterrupt::Port {
+public:
+  PortProbe(Board::InterruptPin pin) : Port(pin, 0) {}
+
+  void set_mask(uint8_t mask)
+  {
+    m_mask = mask;
+  }
+
+  virtual void on_change(uint8_t previous, uint8_t current,
+			 uint8_t changed)
+  {
+    UNUSED(previous);
+    UNUSED(current);
+    UNUSED(changed);
+    if (stamp == 0) stamp = TCNT1;
+    calls += 1;
+  }
+};
+
+// Pins on the same port; bit 0 and up
+#if defined(BOARD_ATMEGA2560)
+static const Board::InterruptPin FIRST = Board::PCI16;
+Probe probe[] = {
+  Board::PCI16, Board::PCI17, Board::PCI18, Board::PCI19,
+  Board::PCI20, Board::PCI21, Board::PCI22, Board::PCI23
+};
+PortProbe port(FIRST);
+#else
+static const Board::InterruptPin FIRST = Board::PCI8;
+Probe probe[] = {
+  Board::PCI8, Board::PCI9, Board::PCI10,
+  Board::PCI11, Board::PCI12, Board::PCI13
+};
+PortProbe port(FIRST);
+#endif
+static const uint8_t PIN_MAX = membersof(probe);
+
+// Number of runs per measurement
+static const uint8_t RUNS = 16;
+
+/**
+ * Toggle the pins in the given mask and measure the interrupt
+ * handler entry and total cycles. Returns the minimum of a number of
+ * runs.
+ */
+void measure(uint8_t mask, uint16_t &entry, uint16_t &total)
+{
+  volatile uint8_t* pin = Pin::PIN(FIRST);
+  entry = UINT16_MAX;
+  total = UINT16_MAX;
+  for (uint8_t i = 0; i < RUNS; i++) {
+    uint16_t start, stop;
+    stamp = 0;
+    synchronized {
+      start = TCNT1;
+      *pin = mask;
+    }
+    stop = TCNT1;
+    if ((uint16_t) (stamp - start) < entry) entry = stamp - start;
+    if ((uint16_t) (stop - start) < total) total = stop - start;
+  }
+}
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaPinChangeLatency: started"));
+
+  // Print some memory statistics
+  TRACE(sizeof(Probe));
+  TRACE(sizeof(PortProbe));
+  TRACE(PIN_MAX);
+
+  // Start the watchdog
+  Watchdog::begin();
+
+  // Drive the pins and start pin change interrupt handling
+  for (uint8_t i = 0; i < PIN_MAX; i++)
+    probe[i].set_mode(IOPin::OUTPUT_MODE);
+  PinChangeInterrupt::begin();
+
+  // Use Timer1 as a free-running cycle counter
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+}
+
+void loop()
+{
+  const uint8_t active[] = { 1, 4, PIN_MAX };
+  uint16_t entry, total;
+
+  for (uint8_t i = 0; i < membersof(active); i++) {
+    uint8_t n = active[i];
+    uint8_t mask = (1 << n) - 1;
+
+    // Interrupt pin handler per pin
+    for (uint8_t j = 0; j < n; j++) probe[j].enable();
+    calls = 0;
+    measure(mask, entry, total);
+    for (uint8_t j = 0; j < n; j++) probe[j].disable();
+    trace << PSTR("pins = ") << n
+	  << PSTR(", pin handler: entry = ") << entry
+	  << PSTR(", total = ") << total
+	  << PSTR(" cycles, calls = ") << calls / RUNS
+	  << endl;
+
+    // Port handler for all pins
+    port.set_mask(mask);
+    port.enable();
+    calls = 0;
+    measure(mask, entry, total);
+    port.disable();
+    trace << PSTR("pins = ") << n
+	  << PSTR(", port handler: entry = ") << entry
+	  << PSTR(", total = ") << total
+	  << PSTR(" cycles, calls = ") << calls / RUNS
+	  << endl;
+  }
+  trace << endl;
+
+  sleep(5);
+}
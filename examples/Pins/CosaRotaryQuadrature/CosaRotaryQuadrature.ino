@@ -0,0 +1,186 @@
+/**
+ * @file CosaRotaryQuadrature.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Cosa demonstration of the Rotary quadrature decoder and velocity
+ * dial. The decoder is first verified by driving the signal pins as
+ * outputs (pin change interrupts are also triggered by output
+ * changes) with a quadrature sequence of detents in both directions
+ * at increasing edge rates. The events are not dispatched while the
+ * sequence is generated; the counts are accumulated by the interrupt
+ * handler and coalesced into a single event. The dial value and the
+ * number of change calls are checked. The pins are then set to input
+ * mode and the dial value is printed on change. Turn fast to
+ * accelerate.
+ *
+ * @section Circuit
+ * KY-040 Rotary Encoder Module. Connect the module after the self
+ * test has completed (or press the reset button while turning).
+ * @code
+ *                      Velocity Dial
+ *                       +------------+
+ * (PCI6)--------------1-|CLK         |
+ * (PCI7)--------------2-|DT          |
+ *                     3-|SW   (/)    |
+ * (VCC)---------------4-|VCC         |
+ * (GND)---------------5-|GND         |
+ *                       +------------+
+ * @endcode
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/Rotary.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// Rotary Dial is connected to D6/D1 and D7/D2 (as interrupt pins)
+#if defined(BOARD_ATTINY)
+#define CLK Board::PCI1
+#define DT Board::PCI2
+#else
+#define CLK Board::PCI6
+#define DT Board::PCI7
+#endif
+
+// Velocity Dial that counts the number of changes
+// Mode: full cycle, Initial: 500, Min: 0, Max: 1000, Step: 1
+class Dial : public Rotary::VelocityDial<int16_t> {
+public:
+  Dial() :
+    Rotary::VelocityDial<int16_t>(CLK, DT, Rotary::Encoder::FULL_CYCLE,
+				  500, 0, 1000, 1),
+    m_changes(0)
+  {}
+
+  virtual void on_change(int16_t value)
+  {
+    UNUSED(value);
+    m_changes += 1;
+  }
+
+  uint16_t m_changes;
+};
+
+Dial dial;
+
+// Number of detents per direction and edge rates (Hz) in self test
+static const int16_t DETENTS = 500;
+static const uint16_t rate[] __PROGMEM = {
+  1000, 2000, 5000, 10000, 20000
+};
+
+/**
+ * Generate the given number of detents (four edges each) on the
+ * signal pins with the given edge period. Positive for clock-wise and
+ * negative for anti-clock-wise direction.
+ * @param[in] detents number of detents.
+ * @param[in] us edge period.
+ */
+void generate(int16_t detents, uint16_t us)
+{
+  volatile uint8_t* pin = Pin::PIN(CLK);
+  uint8_t first = Pin::MASK(CLK);
+  uint8_t second = Pin::MASK(DT);
+  if (detents < 0) {
+    detents = -detents;
+    first = Pin::MASK(DT);
+    second = Pin::MASK(CLK);
+  }
+  while (detents--) {
+    *pin = first;
+    DELAY(us);
+    *pin = second;
+    DELAY(us);
+    *pin = first;
+    DELAY(us);
+    *pin = second;
+    DELAY(us);
+  }
+}
+
+/**
+ * Dispatch pending events. Returns number of events.
+ * @return events.
+ */
+uint8_t dispatch()
+{
+  Event event;
+  uint8_t events = 0;
+  while (Event::queue.dequeue(&event)) {
+    event.dispatch();
+    events += 1;
+  }
+  return (events);
+}
+
+void setup()
+{
+  // Use the UART as output stream
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaRotaryQuadrature: started"));
+  TRACE(sizeof(Rotary::Quadrature));
+  TRACE(sizeof(Dial));
+
+  // Start the watchdog, real-time clock and interrupt pin handler
+  Watchdog::begin();
+  RTC::begin();
+  PinChangeInterrupt::begin();
+
+  // Self test; drive the signal pins without acceleration
+  IOPin::set_mode((Board::DigitalPin) CLK, IOPin::OUTPUT_MODE);
+  IOPin::set_mode((Board::DigitalPin) DT, IOPin::OUTPUT_MODE);
+  dial.set_acceleration(0, 1);
+  dial.enable();
+  for (uint8_t i = 0; i < membersof(rate); i++) {
+    uint16_t hz = pgm_read_word(&rate[i]);
+    uint16_t us = 1000000UL / hz;
+    dial.m_changes = 0;
+    dial.set_value(0);
+    generate(DETENTS, us);
+    uint8_t events = dispatch();
+    int16_t cw = dial.get_value();
+    generate(-DETENTS, us);
+    events += dispatch();
+    int16_t ccw = cw - dial.get_value();
+    trace << PSTR("rate = ") << hz
+	  << PSTR(" Hz, cw = ") << cw
+	  << PSTR(", ccw = ") << ccw
+	  << PSTR(", events = ") << events
+	  << PSTR(", changes = ") << dial.m_changes
+	  << ((cw == DETENTS && ccw == DETENTS) ?
+	      PSTR(": ok") : PSTR(": lost steps"))
+	  << endl;
+  }
+
+  // Release the signal pins and enable acceleration
+  IOPin::set_mode((Board::DigitalPin) CLK, IOPin::INPUT_MODE);
+  IOPin::set_mode((Board::DigitalPin) DT, IOPin::INPUT_MODE);
+  dial.set_acceleration(10, 10);
+  dial.set_value(500);
+  dial.enable();
+}
+
+void loop()
+{
+  // Wait for turn and print the new value
+  Event event;
+  Event::queue.await(&event);
+  event.dispatch();
+  trace << dial.get_value() << endl;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file CosaSleepKeys.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Cosa demonstration of the interrupt driven button and matrix
+ * keypad. The watchdog is not started; the processor is in power
+ * down mode while the inputs are idle and is only woken by a key
+ * press. The watchdog is started on demand for the debounce burst
+ * and stopped when the inputs are idle again. The number of wakeups
+ * while the inputs are idle is printed with each key event; it
+ * should be one (the key press itself). For comparison the periodic
+ * sampling of Button and Keypad requires the watchdog (16 ms) which
+ * gives 225,000 wakeups per hour without any key presses. The serial
+ * output is completed within the debounce burst.
+ *
+ * @section Circuit
+ * Button from D3 to ground. Keypad 4x3 matrix with rows on D4-D7
+ * and columns on D8-D10 (Arduino Uno; PCI8-PCI10 on port B).
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/InterruptButton.hh"
+#include "Cosa/MatrixKeypad.hh"
+#include "Cosa/Event.hh"
+#include "Cosa/Power.hh"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// Wakeups while the inputs are idle (armed)
+volatile uint16_t wakeups = 0;
+
+class Key : public InterruptButton {
+public:
+  Key(Board::InterruptPin pin) : InterruptButton(pin, ON_FALLING_MODE) {}
+
+  virtual void on_change(uint8_t type)
+  {
+    UNUSED(type);
+    trace << PSTR("button: wakeups = ") << wakeups << endl;
+    wakeups = 0;
+  }
+};
+
+const Board::DigitalPin rows[] __PROGMEM = {
+  Board::D4, Board::D5, Board::D6, Board::D7
+};
+const Board::InterruptPin columns[] __PROGMEM = {
+  Board::PCI8, Board::PCI9, Board::PCI10
+};
+
+class Keys : public MatrixKeypad {
+public:
+  Keys() : MatrixKeypad(rows, membersof(rows), columns, membersof(columns)) {}
+
+  virtual void on_key_down(uint8_t nr)
+  {
+    static const char map[] __PROGMEM = "123456789*0#";
+    trace << PSTR("key: ") << (char) pgm_read_byte(&map[nr - 1])
+	  << PSTR(", wakeups = ") << wakeups << endl;
+    wakeups = 0;
+  }
+};
+
+Key button(Board::PCI3);
+Keys keypad;
+
+// Sleep in power down mode while the inputs are idle
+void sleep_yield()
+{
+  if (button.is_idle() && keypad.is_idle()) {
+    wakeups += 1;
+    Power::sleep(SLEEP_MODE_PWR_DOWN);
+  }
+  else {
+    Power::sleep(SLEEP_MODE_IDLE);
+  }
+}
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(57600);
+  trace.begin(&uart, PSTR("CosaSleepKeys: started"));
+  trace.flush();
+
+  // Arm the button and keypad; no watchdog
+  PinChangeInterrupt::begin();
+  button.begin();
+  keypad.begin();
+  yield = sleep_yield;
+}
+
+void loop()
+{
+  Event event;
+  Event::queue.await(&event);
+  event.dispatch();
+}
@@ -0,0 +1,104 @@
+/**
+ * @file CosaKVS.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Demonstrate Cosa Key/Value Store on internal EEPROM or AT24CXX.
+ * Measures write latency of blocking EEPROM writes compared to
+ * queued store writes. Keeps a boot counter and some settings in the
+ * store.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/KVS.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// Select EEPROM device
+//#define USE_AT24CXX
+
+#if defined(USE_AT24CXX)
+#include "Cosa/TWI/Driver/AT24CXX.hh"
+AT24C32 at24c32(0);
+EEPROM::Device* device = &at24c32;
+#else
+EEPROM::Device* device = &EEPROM::Device::eeprom;
+#endif
+
+// Region of EEPROM for the store and fixed address setting
+uint8_t region[512] EEMEM;
+uint32_t fixed EEMEM;
+
+KVS kvs(device, region, sizeof(region));
+EEPROM eeprom(device);
+
+// Keys for the settings
+enum {
+  BOOTS,
+  THRESHOLD,
+  NAME
+};
+
+void setup()
+{
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaKVS: started"));
+  Watchdog::begin();
+  RTC::begin();
+
+  TRACE(free_memory());
+  TRACE(sizeof(kvs));
+  TRACE(kvs.slots());
+
+  // Build the index and update boot counter
+  MEASURE("begin:", 1) TRACE(kvs.begin());
+  TRACE(kvs.sequence());
+  uint32_t boots = 0;
+  kvs.read(BOOTS, &boots);
+  boots += 1;
+  ASSERT(kvs.write(BOOTS, &boots));
+  TRACE(boots);
+  kvs.await();
+}
+
+void loop()
+{
+  static uint32_t value = 0;
+  value += 1;
+
+  // Compare blocking write with queued write
+  MEASURE("eeprom.write:", 1) eeprom.write(&fixed, value);
+  eeprom.write_await();
+  MEASURE("kvs.write:", 1) kvs.write(THRESHOLD, &value);
+  MEASURE("kvs.await:", 1) kvs.await();
+
+  // Check the value and store a string
+  uint32_t res = 0;
+  ASSERT(kvs.read(THRESHOLD, &res) && res == value);
+  char name[KVS::VALUE_MAX];
+  memset(name, 0, sizeof(name));
+  kvs.read(NAME, name, sizeof(name));
+  trace << PSTR("name = ") << name << endl;
+  ASSERT(kvs.write(NAME, "cosa", 5) == 5);
+  TRACE(kvs.sequence());
+  trace << endl;
+
+  sleep(2);
+}
@@ -0,0 +1,123 @@
+/**
+ * @file CosaSPIasync.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Demonstration of asynchronous SPI transfer. A block is shifted out
+ * from the SPI interrupt handler while the main loop samples an
+ * analog pin. The number of samples taken during the transfer and
+ * the transfer time are compared with synchronous block write for
+ * a range of SPI clock rates. A batch of register write segments is
+ * run under one acquire and compared with an acquire per register.
+ * The driver acquire count and bus time are printed.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/SPI.hh"
+#include "Cosa/AnalogPin.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+SPI::Driver dev(Board::D2);
+SPI::Transfer xfer;
+
+// Block to transfer and io vector with command header
+static const size_t BLOCK_MAX = 512;
+uint8_t block[BLOCK_MAX];
+uint8_t header[4] = { 0x02, 0x00, 0x10, 0x00 };
+
+void setup()
+{
+  uart.begin(57600);
+  trace.begin(&uart, PSTR("CosaSPIasync: started"));
+  Watchdog::begin();
+  RTC::begin();
+  for (size_t i = 0; i < sizeof(block); i++) block[i] = i;
+}
+
+void loop()
+{
+  static const SPI::Clock rate[] = {
+    SPI::DIV2_CLOCK, SPI::DIV8_CLOCK, SPI::DIV32_CLOCK
+  };
+
+  for (uint8_t i = 0; i < membersof(rate); i++) {
+    dev.set_clock(rate[i]);
+    trace << rate[i] << endl;
+
+    // Synchronous block write
+    MEASURE("spi.write:", 1) {
+      spi.acquire(&dev);
+        spi.begin();
+          spi.write(block, sizeof(block));
+        spi.end();
+      spi.release();
+    }
+
+    // Asynchronous block write; sample while transfer is in progress
+    uint16_t samples = 0;
+    xfer.set(&dev, NULL, block, sizeof(block));
+    MEASURE("spi.post:", 1) {
+      spi.post(&xfer);
+      while (!xfer.is_completed()) {
+	AnalogPin::sample(Board::A0);
+	samples += 1;
+      }
+    }
+    TRACE(samples);
+
+    // Asynchronous io vector write
+    iovec_t vec[3];
+    iovec_t* vp = vec;
+    iovec_arg(vp, header, sizeof(header));
+    iovec_arg(vp, block, sizeof(block));
+    iovec_end(vp);
+    xfer.set(&dev, vec);
+    ASSERT(spi.post(&xfer));
+    TRACE(xfer.await());
+  }
+
+  // Register writes; one acquire per register
+  static const uint8_t REG_MAX = 3;
+  uint8_t reg[REG_MAX][2] = { { 0x20, 0x0e }, { 0x25, 0x4c }, { 0x26, 0x0f } };
+  dev.reset_counters();
+  MEASURE("register write:", 1) {
+    for (uint8_t i = 0; i < REG_MAX; i++) {
+      spi.acquire(&dev);
+        spi.begin();
+          spi.write(reg[i], sizeof(reg[i]));
+        spi.end();
+      spi.release();
+    }
+  }
+  TRACE(dev.acquires());
+  TRACE(dev.bus_time());
+
+  // Register writes; batch of segments under one acquire
+  SPI::Transfer seg[REG_MAX];
+  for (uint8_t i = 0; i < REG_MAX; i++) {
+    seg[i].set(&dev, NULL, reg[i], sizeof(reg[i]));
+    if (i != 0) seg[i - 1].link(&seg[i]);
+  }
+  dev.reset_counters();
+  MEASURE("register batch:", 1) spi.run(seg);
+  TRACE(dev.acquires());
+  TRACE(dev.bus_time());
+  sleep(5);
+}
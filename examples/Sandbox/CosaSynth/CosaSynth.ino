@@ -0,0 +1,119 @@
+/**
+ * @file CosaSynth.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Demonstrate the Cosa wavetable synthesizer. The interrupt load is
+ * measured for sample rates and number of voices with a counting
+ * loop that is calibrated against an idle period, and the interrupt
+ * handler cycles per sample are calculated. A two voice melody with
+ * bass is then played.
+ *
+ * @section Circuit
+ * Speaker with 100 ohm inline resistor on the Tone pins (Uno D9 and
+ * D10).
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/Synth.hh"
+#include "Cosa/Note.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+#if defined(BOARD_ATTINY)
+#error "CosaSynth: board not supported"
+#endif
+
+Synth synth;
+
+// Measurement period (ms)
+static const uint16_t PERIOD = 500;
+
+// Counting loop iterations per milli-second (calibrated)
+uint32_t loops_per_ms;
+
+// When they arrive at the tower and are attempting communication,
+// the notes they play are B flat, C, A flat, (octave lower) A flat,
+// E flat.
+static const uint16_t melody[] __PROGMEM = {
+  Note::Bes4, Note::C5, Note::As4, Note::As3, Note::Es4, Note::PAUSE,
+  Note::END
+};
+static const uint16_t bass[] __PROGMEM = {
+  Note::Bes2, Note::Bes2, Note::As2, Note::As2, Note::Es2, Note::PAUSE,
+  Note::END
+};
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaSynth: started"));
+  TRACE(sizeof(Synth));
+
+  // Start the watchdog and real-time clock
+  Watchdog::begin();
+  RTC::begin();
+
+  // Calibrate the counting loop
+  uint32_t count = 0;
+  uint32_t start = RTC::millis();
+  while (RTC::since(start) < 100) count++;
+  loops_per_ms = count / 100;
+  TRACE(loops_per_ms);
+
+  // Measure interrupt load for sample rate and number of voices
+  static const uint16_t rate[] __PROGMEM = { 8000, 16000, 31250, 40000 };
+  for (uint8_t i = 0; i < membersof(rate); i++) {
+    uint16_t hz = pgm_read_word(&rate[i]);
+    for (uint8_t voices = 1; voices <= Synth::VOICE_MAX; voices++) {
+      ASSERT(synth.begin(hz, voices));
+      for (uint8_t j = 0; j < voices; j++) synth.note_on(j, Note::A4);
+      uint32_t loops = 0;
+      start = RTC::millis();
+      while (RTC::since(start) < PERIOD) loops++;
+      for (uint8_t j = 0; j < voices; j++) synth.note_off(j);
+      synth.end();
+
+      // Calculate interrupt load and cycles per sample
+      uint32_t available = loops / loops_per_ms;
+      if (available > PERIOD) available = PERIOD;
+      uint16_t load = ((PERIOD - available) * 100) / PERIOD;
+      uint32_t cycles = ((PERIOD - available) * (F_CPU / 1000)) / PERIOD;
+      cycles = (cycles * 1000) / hz;
+      trace << PSTR("rate = ") << hz
+	    << PSTR(", voices = ") << voices
+	    << PSTR(", load = ") << load
+	    << PSTR("%, isr = ") << cycles
+	    << PSTR(" cycles") << endl;
+    }
+  }
+
+  // Start the synthesizer with two voices and a soft envelope
+  ASSERT(synth.begin(31250, 2));
+  synth.set_envelope(16, 2, 160, 4);
+}
+
+void loop()
+{
+  synth.play(0, melody, 600);
+  synth.play(1, bass, 600);
+  while (synth.is_active(0) || synth.is_active(1)) yield();
+  sleep(2);
+}
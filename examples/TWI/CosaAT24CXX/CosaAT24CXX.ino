@@ -17,7 +17,10 @@
  *
  * @section Description
  * Cosa demonstration of the AT24CXX 2-Wire (TWI) Serial EEPROM
- * driver.
+ * driver. Measures bytes per second for large sequential reads,
+ * and blocking and asynchronous writes. Checks that a read that
+ * continues a sequential read after is_ready() returns the correct
+ * data.
  *
  * @section Circuit
  * The TinyRTC with DS1307 also contains a 24C32 EEPROM.
@@ -42,6 +45,7 @@
 #include "Cosa/Trace.hh"
 #include "Cosa/IOStream/Driver/UART.hh"
 #include "Cosa/Watchdog.hh"
+#include "Cosa/RTC.hh"
 
 // Use the builtin led as a heartbeat
 OutputPin ledPin(Board::LED);
@@ -69,14 +73,99 @@ void init_eeprom()
   eeprom.write(&z, z0);
 }
 
+// Region for benchmark and completion flag for asynchronous write
+uint8_t bench[1024] EEMEM;
+
+class Completion : public Event::Handler {
+public:
+  Completion() : Event::Handler(), m_done(false), m_errors(0) {}
+  virtual void on_event(uint8_t type, uint16_t value)
+  {
+    UNUSED(value);
+    if (type == Event::ERROR_TYPE) m_errors += 1;
+    m_done = true;
+  }
+  volatile bool m_done;
+  uint8_t m_errors;
+};
+
+void benchmark()
+{
+  static const size_t BLOCK_MAX = 256;
+  uint8_t buf[BLOCK_MAX];
+  uint32_t us;
+
+  // Blocking write; page aligned chunks with acknowledge polling
+  memset(buf, 0xa5, sizeof(buf));
+  MEASURE("write:", 1) {
+    for (size_t i = 0; i < sizeof(bench); i += BLOCK_MAX)
+      eeprom.write(&bench[i], buf, sizeof(buf));
+    eeprom.write_await();
+  }
+  us = trace.measure;
+  trace << PSTR("write: ") << (sizeof(bench) * 1000000UL) / us
+	<< PSTR(" bytes/s") << endl;
+
+  // Sequential read; current address reads after the first block
+  MEASURE("read:", 1) {
+    for (size_t i = 0; i < sizeof(bench); i += BLOCK_MAX)
+      eeprom.read(buf, &bench[i], sizeof(buf));
+  }
+  us = trace.measure;
+  trace << PSTR("read: ") << (sizeof(bench) * 1000000UL) / us
+	<< PSTR(" bytes/s") << endl;
+
+  // Asynchronous write; chained by TWI completion events
+  Completion completion;
+  memset(buf, 0x5a, sizeof(buf));
+  MEASURE("write_request:", 1) {
+    for (size_t i = 0; i < sizeof(bench); i += BLOCK_MAX) {
+      completion.m_done = false;
+      at24c32.write_request(&bench[i], buf, sizeof(buf), &completion);
+      while (!completion.m_done) Event::service();
+    }
+  }
+  us = trace.measure;
+  trace << PSTR("write_request: ") << (sizeof(bench) * 1000000UL) / us
+	<< PSTR(" bytes/s") << endl;
+  TRACE(completion.m_errors);
+}
+
+void check()
+{
+  static const size_t BLOCK_MAX = 64;
+  uint8_t buf[2 * BLOCK_MAX];
+  bool ok = true;
+
+  // Write a pattern, read the first block and probe the device
+  for (size_t i = 0; i < sizeof(buf); i++) buf[i] = i ^ 0x5a;
+  eeprom.write(bench, buf, sizeof(buf));
+  eeprom.read(buf, bench, BLOCK_MAX);
+  TRACE(eeprom.is_ready());
+
+  // Read the next block; should not continue from the probe address
+  memset(buf, 0, sizeof(buf));
+  eeprom.read(buf, &bench[BLOCK_MAX], BLOCK_MAX);
+  for (size_t i = 0; i < BLOCK_MAX; i++)
+    if (buf[i] != ((BLOCK_MAX + i) ^ 0x5a)) ok = false;
+  TRACE(ok);
+}
+
 void setup()
 {
   // Start trace output stream
   uart.begin(9600);
   trace.begin(&uart, PSTR("CosaAT24CXX: started"));
 
-  // Start the watchdog with default timeout (16 ms)
+  // Start the watchdog with default timeout (16 ms) and timers
   Watchdog::begin();
+  RTC::begin();
+
+  // Measure read and write throughput
+  benchmark();
+
+  // Check sequential read after device probe
+  check();
 
   // Initiate EEPROM variables
   init_eeprom();
@@ -0,0 +1,136 @@
+/**
+ * @file CosaTWIasync.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Measure CPU time per TWI transaction; register address write and
+ * data burst read with asynchronous requests. The CPU time available
+ * to the application during the transaction is measured with a
+ * counting loop that is calibrated against an idle period. On
+ * ATtiny compare the results with and without USE_USI_TWI_ASYNC
+ * (Cosa/USI/USI_TWI.cpp); the polled master uses the CPU for the
+ * whole transaction.
+ *
+ * @section Circuit
+ * ADXL345 (alternative address, 0x53) on the TWI bus. See
+ * CosaADXL345. On ATtiny the trace output is on D1.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/TWI.hh"
+#include "Cosa/Event.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+#if defined(BOARD_ATTINY)
+Soft::UAT uart(Board::D1);
+#endif
+
+// The device; data register and size of burst
+TWI::Driver acceleratometer(0x53);
+static const uint8_t DATA_REG = 0x32;
+static const uint8_t DATA_MAX = 6;
+
+// Event handler for completion events
+class Completion : public Event::Handler {
+} completion;
+
+// Counting loop iterations per milli-second (calibrated)
+uint32_t loops_per_ms;
+
+/**
+ * Count loop iterations until an event is available or the given
+ * time has passed. Used both for calibration and measurement so that
+ * the loop body is the same.
+ * @param[in] start time (RTC::millis).
+ * @param[in] ms max time.
+ * @return loop iterations.
+ */
+uint32_t count_until_event(uint32_t start, uint16_t ms)
+{
+  uint32_t count = 0;
+  while (!Event::queue.available() && RTC::since(start) < ms) count++;
+  return (count);
+}
+
+/**
+ * Wait for completion event and count loop iterations while waiting.
+ * @return loop iterations.
+ */
+uint32_t count_until_completed()
+{
+  uint32_t count = count_until_event(RTC::millis(), 1000);
+  Event event;
+  Event::queue.dequeue(&event);
+  return (count);
+}
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaTWIasync: started"));
+
+  // Print some memory statistics
+  TRACE(free_memory());
+  TRACE(sizeof(TWI));
+
+  // Start the watchdog and real-time clock
+  Watchdog::begin();
+  RTC::begin();
+
+  // Calibrate the counting loop; no events are pending
+  loops_per_ms = count_until_event(RTC::millis(), 100) / 100;
+  TRACE(loops_per_ms);
+}
+
+void loop()
+{
+  uint8_t buf[DATA_MAX];
+  uint8_t reg = DATA_REG;
+
+  // Blocking transaction; elapsed time
+  MEASURE("blocking:", 1) {
+    twi.begin(&acceleratometer);
+    twi.write(reg);
+    twi.read(buf, sizeof(buf));
+    twi.end();
+  }
+
+  // Asynchronous transaction; elapsed and available CPU time
+  uint32_t loops = 0;
+  uint32_t start = RTC::micros();
+  twi.begin(&acceleratometer, &completion);
+  twi.write_request(&reg, sizeof(reg));
+  loops += count_until_completed();
+  twi.read_request(buf, sizeof(buf));
+  loops += count_until_completed();
+  twi.end();
+  uint32_t elapsed = RTC::micros() - start;
+  uint32_t available = (loops * 1000) / loops_per_ms;
+  if (available > elapsed) available = elapsed;
+  trace << PSTR("asynchronous: elapsed = ") << elapsed
+	<< PSTR(" us, cpu = ") << elapsed - available
+	<< PSTR(" us") << endl;
+  trace.print(buf, sizeof(buf), IOStream::hex);
+  trace << endl;
+
+  sleep(2);
+}
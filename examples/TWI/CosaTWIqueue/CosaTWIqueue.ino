@@ -0,0 +1,133 @@
+/**
+ * @file CosaTWIqueue.ino
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2015, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * @section Description
+ * Cosa TWI transaction queue benchmark. Read the data registers of
+ * the sensors on a 10 DOF module (GY-80); ADXL345, BMP085, HMC5883L
+ * and L3G4200D. A round of reads is performed with synchronous
+ * write-read requests and with posted transactions that are chained
+ * with repeated start by the interrupt handler. The bus utilization
+ * is the minimum bus time (9 clock cycles per byte including address
+ * bytes) in relation to the measured time for the round.
+ *
+ * @section Circuit
+ * See Cosa10DOF.ino.
+ *
+ * This file is part of the Arduino Che Cosa project.
+ */
+
+#include "Cosa/TWI.hh"
+#include "Cosa/RTC.hh"
+#include "Cosa/Watchdog.hh"
+#include "Cosa/Memory.h"
+#include "Cosa/Trace.hh"
+#include "Cosa/IOStream/Driver/UART.hh"
+
+// The sensors on the module (alternative addresses)
+TWI::Driver acceleratometer(0x53);
+TWI::Driver bmp(0x77);
+TWI::Driver compass(0x1e);
+TWI::Driver gyroscope(0x69);
+
+// Sensor data register and number of bytes to read
+struct sensor_t {
+  TWI::Driver* dev;
+  uint8_t reg;
+  uint8_t size;
+};
+
+static const uint8_t SENSOR_MAX = 4;
+static const sensor_t sensor[SENSOR_MAX] = {
+  { &acceleratometer, 0x32, 6 },
+  { &bmp, 0xf6, 3 },
+  { &compass, 0x03, 6 },
+  { &gyroscope, 0xa8, 6 }
+};
+
+// Transaction descriptors and data buffers
+TWI::Transaction xfer[SENSOR_MAX];
+uint8_t data[SENSOR_MAX][6];
+
+// Minimum bus time for a round of reads (us)
+uint32_t bus_time;
+
+void print_utilization()
+{
+  trace << PSTR("bus utilization = ")
+	<< (bus_time * 100) / trace.measure
+	<< '%' << endl;
+}
+
+void setup()
+{
+  // Start trace output stream on the serial port
+  uart.begin(9600);
+  trace.begin(&uart, PSTR("CosaTWIqueue: started"));
+
+  // Print some memory statistics
+  TRACE(free_memory());
+  TRACE(sizeof(TWI));
+  TRACE(sizeof(TWI::Transaction));
+
+  // Start the watchdog and real-time clock
+  Watchdog::begin();
+  RTC::begin();
+
+  // Setup the transactions and calculate the minimum bus time; two
+  // address bytes, register address and data bytes
+  uint16_t bytes = 0;
+  for (uint8_t i = 0; i < SENSOR_MAX; i++) {
+    const sensor_t* sp = &sensor[i];
+    xfer[i].set(sp->dev, &sp->reg, 1, data[i], sp->size);
+    bytes += 3 + sp->size;
+  }
+  bus_time = (bytes * 9 * 1000000L) / TWI::DEFAULT_FREQ;
+  TRACE(bytes);
+  TRACE(bus_time);
+}
+
+void loop()
+{
+  // Synchronous requests; one device transaction block per sensor
+  MEASURE("synchronous:", 1) {
+    for (uint8_t i = 0; i < SENSOR_MAX; i++) {
+      const sensor_t* sp = &sensor[i];
+      twi.begin(sp->dev);
+      twi.write((uint8_t) sp->reg);
+      twi.read(data[i], sp->size);
+      twi.end();
+    }
+  }
+  print_utilization();
+
+  // Posted transactions; chained with repeated start
+  MEASURE("queue:", 1) {
+    for (uint8_t i = 0; i < SENSOR_MAX; i++) twi.post(&xfer[i]);
+    xfer[SENSOR_MAX - 1].await();
+  }
+  print_utilization();
+
+  // Check the result of the transactions
+  for (uint8_t i = 0; i < SENSOR_MAX; i++) {
+    int res = xfer[i].await();
+    trace << i << PSTR(": res = ") << res << endl;
+    if (res > 0) trace.print(data[i], res, IOStream::hex);
+  }
+  trace << endl;
+
+  sleep(2);
+}